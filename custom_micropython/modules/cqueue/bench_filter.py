@@ -0,0 +1,159 @@
+"""!
+@file bench_filter.py
+This file compares filtering and decimating samples in C with a
+@c FilteredQueue against doing the same job in Python and, if it's available,
+with ulab. Each method runs the same FIR filter, then the same biquad low pass
+filter, then keeps one sample of every @c DECIMATE, and the results are
+checked against each other.
+
+This program is meant to be run on the MicroPython unix port, but it also runs
+on a board; use a smaller @c NUM_SAMPLES there.
+
+@date   2026-Oct-16 Original file
+"""
+import array
+import cqueue
+import utime
+from micropython import const
+
+## The number of samples filtered by each method
+NUM_SAMPLES = const (20000)
+
+## One output sample is kept for every this many inputs
+DECIMATE = const (4)
+
+## Taps of an FIR filter which averages the last eight samples
+FIR_TAPS = [0.125] * 8
+
+## A second order Butterworth low pass filter with its corner at a tenth of the
+#  sample rate, as @c (b0, b1, b2, a0, a1, a2)
+IIR_SOS = [0.0674553, 0.1349105, 0.0674553, 1.0, -1.1429805, 0.4128016]
+
+
+def make_samples():
+    """!
+    Make a test signal: a slow ramp plus a fast square wave which the filters
+    should mostly remove.
+    @returns An @c array.array of floats
+    """
+    return array.array ('f', (n * 0.01 + (1.0 if n & 2 else -1.0)
+                              for n in range (NUM_SAMPLES)))
+
+
+def filter_c(samples, one_at_a_time):
+    """!
+    Filter and decimate the samples in C with a @c FilteredQueue.
+    @param samples The samples to be filtered
+    @param one_at_a_time If @c True, call @c put() for each sample as an
+           interrupt callback would; otherwise call @c put_many() once
+    @returns A tuple of the time taken in microseconds and an array of the
+             filtered samples
+    """
+    queue = cqueue.FilteredQueue (NUM_SAMPLES // DECIMATE, fir=FIR_TAPS,
+                                  iir=IIR_SOS, decimate=DECIMATE)
+    begin = utime.ticks_us ()
+    if one_at_a_time:
+        put = queue.put
+        for sample in samples:
+            put (sample)
+    else:
+        queue.put_many (samples)
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+
+    results = array.array ('f', range (queue.available ()))
+    queue.get_into (results)
+    return duration, results
+
+
+def filter_python(samples):
+    """!
+    Filter and decimate the samples in Python, one at a time, putting the
+    results into a @c FloatQueue as a Python task would.
+    @param samples The samples to be filtered
+    @returns A tuple of the time taken in microseconds and an array of the
+             filtered samples
+    """
+    queue = cqueue.FloatQueue (NUM_SAMPLES // DECIMATE)
+    taps = FIR_TAPS
+    num_taps = len (taps)
+    history = [0.0] * num_taps
+    b0, b1, b2, a0, a1, a2 = IIR_SOS
+    b0, b1, b2, a1, a2 = b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0
+    state0 = state1 = 0.0
+    phase = 0
+
+    begin = utime.ticks_us ()
+    for sample in samples:
+        history.pop ()
+        history.insert (0, sample)
+        value = 0.0
+        for tap in range (num_taps):
+            value += taps[tap] * history[tap]
+        out = b0 * value + state0
+        state0 = b1 * value - a1 * out + state1
+        state1 = b2 * value - a2 * out
+        phase += 1
+        if phase == DECIMATE:
+            phase = 0
+            queue.put (out)
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+
+    results = array.array ('f', range (queue.available ()))
+    queue.get_into (results)
+    return duration, results
+
+
+def filter_ulab(samples):
+    """!
+    Filter and decimate all the samples at once with ulab.
+    @param samples The samples to be filtered
+    @returns A tuple of the time taken in microseconds and an array of the
+             filtered samples, or @c None if ulab isn't available
+    """
+    try:
+        from ulab import numpy as np
+        from ulab import scipy as spy
+    except ImportError:
+        return None
+
+    taps = np.array (FIR_TAPS)
+    sos = np.array ([IIR_SOS])
+    begin = utime.ticks_us ()
+    data = np.array (samples)
+    data = np.convolve (data, taps)[:len (samples)]
+    data = spy.signal.sosfilt (sos, data)[DECIMATE - 1::DECIMATE]
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+
+    return duration, array.array ('f', data)
+
+
+def max_difference(first, second):
+    """!
+    Find the largest difference between corresponding items of two arrays.
+    @param first One array of results
+    @param second Another array of results, which should be the same length
+    @returns The largest difference, or @c None if the lengths differ
+    """
+    if len (first) != len (second):
+        return None
+    return max (abs (a - b) for a, b in zip (first, second))
+
+
+samples = make_samples ()
+c_put_us, c_results = filter_c (samples, True)
+c_many_us, c_many_results = filter_c (samples, False)
+py_us, py_results = filter_python (samples)
+ulab_run = filter_ulab (samples)
+
+print (f"{NUM_SAMPLES} samples, {len (FIR_TAPS)} taps, one biquad, "
+       + f"decimated by {DECIMATE}")
+print (f"C put():       {c_put_us:8d} us")
+print (f"C put_many():  {c_many_us:8d} us, "
+       + f"max difference {max_difference (c_many_results, c_results)}")
+print (f"Python:        {py_us:8d} us, "
+       + f"max difference {max_difference (py_results, c_results)}")
+if ulab_run is None:
+    print ("ulab:          not available")
+else:
+    print (f"ulab:          {ulab_run[0]:8d} us, "
+           + f"max difference {max_difference (ulab_run[1], c_results)}")
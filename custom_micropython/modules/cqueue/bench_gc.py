@@ -0,0 +1,123 @@
+"""!
+@file bench_gc.py
+This file measures how long @c gc.collect() takes while large amounts of
+sample data are kept in memory, first in the heap, as queue data used to be,
+and then in cqueue's data arena, which the garbage collector doesn't scan. It
+also shows that data which happens to look like a pointer into the heap keeps
+garbage from being freed when it's in the heap, but not when it's in a queue.
+
+This program is meant to be run on the MicroPython unix port, but it also runs
+on a board. There's no arena unless MicroPython was built with one, for
+example with
+@code
+make USER_C_MODULES=... CFLAGS_EXTRA=-DMICROPY_CQUEUE_DATA_ARENA_SIZE=1048576
+@endcode
+and bigger amounts of data show the difference more clearly.
+
+@date   2026-Oct-16 Original file
+"""
+import array
+import gc
+import cqueue
+import utime
+from micropython import const
+
+## The number of collections timed for each measurement
+NUM_COLLECTS = const (50)
+
+## The number of queues or arrays among which the data is split
+NUM_BUFFERS = const (8)
+
+## The size of a block of garbage whose freeing is checked
+GARBAGE_SIZE = const (20000)
+
+
+def time_collects():
+    """!
+    Time a number of garbage collections.
+    @returns A tuple of the average and the longest times in microseconds
+    """
+    total = 0
+    longest = 0
+    for _ in range (NUM_COLLECTS):
+        begin = utime.ticks_us ()
+        gc.collect ()
+        duration = utime.ticks_diff (utime.ticks_us (), begin)
+        total += duration
+        longest = max (longest, duration)
+    return total / NUM_COLLECTS, longest
+
+
+def fill(buffer_put, num_items):
+    """!
+    Fill a buffer with a ramp of numbers, like slowly changing samples.
+    @param buffer_put A function which puts one item into the buffer
+    @param num_items The number of items to put
+    """
+    for index in range (num_items):
+        buffer_put (index * 7919)
+
+
+def retained(keep):
+    """!
+    Check whether garbage is kept alive by a number equal to its address.
+    @param keep A function which stores one number where the collector may or
+           may not scan it
+    @returns The number of bytes which weren't freed when the garbage was
+    """
+    gc.collect ()
+    before = gc.mem_free ()
+    garbage = bytearray (GARBAGE_SIZE)
+    keep (id (garbage))
+    garbage = None
+    gc.collect ()
+    return max (0, before - gc.mem_free ())
+
+
+arena_size, arena_used, arena_free = cqueue.data_arena ()
+if arena_size == 0:
+    print ("This cqueue has no data arena; queue data is in the heap")
+    arena_free = 64 * 1024
+
+# Size the queues so they all fit in the arena, with room for block headers
+num_items = (arena_free - 16 * NUM_BUFFERS) // (4 * NUM_BUFFERS)
+num_bytes = 4 * num_items * NUM_BUFFERS
+
+# Nothing much in memory: the time to scan the interpreter's own objects
+gc.collect ()
+empty_avg, empty_max = time_collects ()
+
+# The data in the heap, as queues used to keep it
+arrays = [array.array ('i') for _ in range (NUM_BUFFERS)]
+for buffer in arrays:
+    fill (buffer.append, num_items)
+heap_avg, heap_max = time_collects ()
+arrays = None
+gc.collect ()
+
+# The same data in queues whose data is in the arena
+queues = [cqueue.IntQueue (num_items) for _ in range (NUM_BUFFERS)]
+for queue in queues:
+    fill (queue.put, num_items)
+arena_avg, arena_max = time_collects ()
+in_arena = cqueue.data_arena ()[1] - arena_used
+queues = None
+gc.collect ()
+
+# A number which looks like the address of garbage keeps it from being freed
+# if the number is in the heap, but not if it's in a queue
+keeper = array.array ('q')
+heap_kept = retained (keeper.append)
+holder = cqueue.TypedQueue ('q', 1)
+queue_kept = retained (holder.put)
+
+print (f"{num_bytes} bytes of data in {NUM_BUFFERS} buffers, "
+       + f"{in_arena} bytes of queue data in the arena of {arena_size}")
+print (f"gc.collect(), no data:       avg {empty_avg:8.1f} us, "
+       + f"max {empty_max} us")
+print (f"gc.collect(), data in heap:  avg {heap_avg:8.1f} us, "
+       + f"max {heap_max} us")
+print (f"gc.collect(), data in arena: avg {arena_avg:8.1f} us, "
+       + f"max {arena_max} us")
+print (f"Garbage kept by a lookalike pointer: in heap {heap_kept} bytes, "
+       + f"in queue {queue_kept} bytes")
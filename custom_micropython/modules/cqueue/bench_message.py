@@ -0,0 +1,72 @@
+"""!
+@file bench_message.py
+This file compares two ways of passing messages of different lengths between
+tasks: framing them in Python on a @c cqueue.ByteQueue, with a length byte in
+front of each message, and putting them whole into a @c cqueue.MessageQueue.
+It prints the time per message for each and how much memory was allocated
+while the messages went through.
+
+This program runs on a board or on the MicroPython unix port.
+
+@date   2026-Oct-16 Original file
+"""
+import gc
+import cqueue
+import utime
+from micropython import const
+
+## The number of messages put into and taken from each queue
+NUM_MESSAGES = const (5000)
+
+## The number of bytes of memory in each queue
+CAPACITY = const (512)
+
+## Messages like those sent between tasks, of several lengths
+MESSAGES = (b"GO", b"SPEED 1500", b"POS -2048 STEP 16", b"",
+            b"KP 0.125 KI 0.002 KD 0.05")
+
+
+def framed_bytes(num_messages):
+    """!
+    Pass messages through a ByteQueue, each behind a byte holding its length.
+    @param num_messages The number of messages to pass
+    @returns A tuple of the time in microseconds and the bytes allocated
+    """
+    queue = cqueue.ByteQueue (CAPACITY)
+    into = bytearray (64)
+    gc.collect ()
+    free = gc.mem_free ()
+    begin = utime.ticks_us ()
+    for index in range (num_messages):
+        message = MESSAGES[index % len (MESSAGES)]
+        queue.put (bytes ((len (message),)))
+        queue.put (message)
+        length = queue.get ()[0]
+        queue.readinto (into, length)
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+    return duration, free - gc.mem_free ()
+
+
+def whole_messages(num_messages):
+    """!
+    Pass messages through a MessageQueue, which keeps each one whole.
+    @param num_messages The number of messages to pass
+    @returns A tuple of the time in microseconds and the bytes allocated
+    """
+    queue = cqueue.MessageQueue (CAPACITY)
+    into = bytearray (64)
+    gc.collect ()
+    free = gc.mem_free ()
+    begin = utime.ticks_us ()
+    for index in range (num_messages):
+        queue.put (MESSAGES[index % len (MESSAGES)])
+        queue.get_into (into)
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+    return duration, free - gc.mem_free ()
+
+
+for name, test in (("ByteQueue, framed in Python", framed_bytes),
+                   ("MessageQueue", whole_messages)):
+    duration, allocated = test (NUM_MESSAGES)
+    print (f"{name:28s}: {duration / NUM_MESSAGES:6.2f} us/message, "
+           + f"{allocated} bytes allocated")
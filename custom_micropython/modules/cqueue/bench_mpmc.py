@@ -0,0 +1,127 @@
+"""!
+@file bench_mpmc.py
+This file measures the throughput and latency of a @c cqueue.ThreadQueue
+shared by several producer threads and as many consumer threads. Each producer
+puts time stamps from @c utime.ticks_us() into the queue, and each consumer
+takes them out and records how long each one waited. The test is run with 1,
+2, 4 and 8 threads of each kind, and for each it prints the items moved per
+second and the median, 99th and 99.9th percentile and largest latencies.
+
+This program is meant to be run on the MicroPython unix port, which has the
+@c _thread module, for example with
+@code
+make USER_C_MODULES=... && ./build-standard/micropython bench_mpmc.py
+@endcode
+
+@date   2026-Oct-16 Original file
+"""
+import array
+import gc
+import _thread
+import cqueue
+import utime
+from micropython import const
+
+## The number of items each producer thread puts into the queue
+ITEMS_PER_PRODUCER = const (20000)
+
+## The number of items the shared queue can hold
+QUEUE_SIZE = const (256)
+
+## The numbers of producer threads, and of consumer threads, to be tested
+THREAD_COUNTS = (1, 2, 4, 8)
+
+
+def producer(queue, done):
+    """!
+    Put time stamps into the queue, then say so through another queue.
+    @param queue The queue being measured
+    @param done A queue into which a 1 is put when this thread is finished
+    """
+    for _ in range (ITEMS_PER_PRODUCER):
+        queue.put (utime.ticks_us ())
+    done.put (1)
+
+
+def consumer(queue, done, latencies, counts, index):
+    """!
+    Take time stamps from the queue and record how long each one waited,
+    until a negative number says that there are no more.
+    @param queue The queue being measured
+    @param done A queue into which a 2 is put when this thread is finished
+    @param latencies An array which receives the waiting times in microseconds
+    @param counts A list in which this thread's number of items is saved
+    @param index The number of this consumer, from zero
+    """
+    count = 0
+    while True:
+        stamp = queue.get ()
+        if stamp < 0:
+            break
+        latencies[count] = utime.ticks_diff (utime.ticks_us (), stamp)
+        count += 1
+    counts[index] = count
+    done.put (2)
+
+
+def percentile(ordered, fraction):
+    """!
+    Find a percentile of some sorted numbers.
+    @param ordered A sorted list of the numbers
+    @param fraction The fraction of numbers below the percentile, such as 0.99
+    @returns The number at that percentile
+    """
+    return ordered[min (len (ordered) - 1, int (fraction * len (ordered)))]
+
+
+def run(num_threads):
+    """!
+    Move items through a queue with some number of producers and consumers,
+    and print how fast and how promptly they went.
+    @param num_threads The number of producer threads, which is also the
+           number of consumer threads
+    """
+    queue = cqueue.ThreadQueue ('q', QUEUE_SIZE)
+    done = cqueue.ThreadQueue ('b', 2 * num_threads)
+    total = num_threads * ITEMS_PER_PRODUCER
+
+    # Each consumer may get all the items, so each has room for them all
+    latencies = [array.array ('i', bytes (4 * total))
+                 for _ in range (num_threads)]
+    counts = [0] * num_threads
+    gc.collect ()
+
+    for index in range (num_threads):
+        _thread.start_new_thread (consumer, (queue, done, latencies[index],
+                                             counts, index))
+    begin = utime.ticks_us ()
+    for _ in range (num_threads):
+        _thread.start_new_thread (producer, (queue, done))
+
+    # When the producers have finished, tell each consumer to stop once it
+    # has emptied the queue
+    for _ in range (num_threads):
+        done.get ()
+    for _ in range (num_threads):
+        queue.put (-1)
+    for _ in range (num_threads):
+        done.get ()
+    duration = utime.ticks_diff (utime.ticks_us (), begin)
+
+    ordered = []
+    for index in range (num_threads):
+        ordered.extend (latencies[index][:counts[index]])
+    ordered.sort ()
+    if len (ordered) != total:
+        print (f"Error: {len (ordered)} items got out of {total}")
+
+    print (f"{num_threads} x {num_threads} threads: "
+           + f"{total * 1000000 // duration:8d} items/s, latency "
+           + f"p50 {percentile (ordered, 0.5)} us, "
+           + f"p99 {percentile (ordered, 0.99)} us, "
+           + f"p99.9 {percentile (ordered, 0.999)} us, "
+           + f"max {ordered[-1]} us")
+
+
+for num_threads in THREAD_COUNTS:
+    run (num_threads)
@@ -0,0 +1,87 @@
+"""!
+@file bench_packed.py
+This file compares a @c PackedIntQueue with a plain @c IntQueue holding the
+same encoder-like data. It reports how many bytes each item takes in each
+queue and how long it takes to put and get each item, in nanoseconds.
+
+This program is meant to be run on the MicroPython unix port, but it also runs
+on a board; use a smaller @c NUM_SAMPLES there.
+
+@date   2026-Oct-16 Original file
+"""
+import array
+import random
+import cqueue
+import utime
+from micropython import const
+
+## The number of samples put into and taken out of each queue
+NUM_SAMPLES = const (20000)
+
+## The largest change in the count from one sample to the next
+MAX_STEP = const (40)
+
+
+def make_samples():
+    """!
+    Make encoder-like test data: a count which starts at a large value and
+    changes by a small random amount from each sample to the next.
+    @returns An @c array.array of 32-bit integers
+    """
+    samples = array.array ('i', range (NUM_SAMPLES))
+    count = 1_000_000
+    for index in range (NUM_SAMPLES):
+        count += random.randint (-MAX_STEP, MAX_STEP)
+        samples[index] = count
+    return samples
+
+
+def time_queue(queue, samples):
+    """!
+    Put all the samples into a queue one at a time, then take them all out,
+    as a timer callback and a task would.
+    @param queue The queue to be timed, which must be big enough for the data
+    @param samples The samples to put into the queue
+    @returns A tuple of the nanoseconds per put, the nanoseconds per get, and
+             whether the items taken out matched the samples
+    """
+    put = queue.put
+    begin = utime.ticks_us ()
+    for sample in samples:
+        put (sample)
+    put_us = utime.ticks_diff (utime.ticks_us (), begin)
+
+    get = queue.get
+    results = []
+    begin = utime.ticks_us ()
+    for index in range (NUM_SAMPLES):
+        results.append (get ())
+    get_us = utime.ticks_diff (utime.ticks_us (), begin)
+
+    return (put_us * 1000 // NUM_SAMPLES, get_us * 1000 // NUM_SAMPLES,
+            results == list (samples))
+
+
+samples = make_samples ()
+
+plain = cqueue.IntQueue (NUM_SAMPLES)
+plain_put_ns, plain_get_ns, plain_ok = time_queue (plain, samples)
+plain_bytes = 4 * NUM_SAMPLES
+
+# Size the packed queue for the worst case so nothing is overwritten, then
+# measure how much of it the data actually used
+packed = cqueue.PackedIntQueue (5 * NUM_SAMPLES)
+for sample in samples:
+    packed.put (sample)
+packed_bytes = packed.bytes_used ()
+packed.clear ()
+packed_put_ns, packed_get_ns, packed_ok = time_queue (packed, samples)
+
+print (f"{NUM_SAMPLES} samples changing by up to {MAX_STEP} each")
+print (f"IntQueue:        {plain_bytes / NUM_SAMPLES:5.2f} bytes/item, "
+       + f"put {plain_put_ns:6d} ns, get {plain_get_ns:6d} ns, "
+       + f"{'OK' if plain_ok else 'MISMATCH'}")
+print (f"PackedIntQueue:  {packed_bytes / NUM_SAMPLES:5.2f} bytes/item, "
+       + f"put {packed_put_ns:6d} ns, get {packed_get_ns:6d} ns, "
+       + f"{'OK' if packed_ok else 'MISMATCH'}")
+print (f"Compression ratio: {plain_bytes / packed_bytes:.2f}")
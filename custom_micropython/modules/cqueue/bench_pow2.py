@@ -0,0 +1,73 @@
+"""!
+@file bench_pow2.py
+This file compares the speed of queues whose sizes are powers of two, which
+find array indices with a mask, against queues of nearby sizes, which wrap
+their indices with comparisons. It is meant to be run on the MicroPython unix
+port, but it also runs on a board.
+
+Each measurement includes the interpreter's cost of calling the method, which
+is the same for both kinds of queue, so it's the differences which matter.
+
+@date   2026-Oct-16 Original file
+"""
+import array
+import cqueue
+import utime
+from micropython import const
+
+## The number of operations timed in each measurement
+NUM_OPS = const (200000)
+
+## Pairs of sizes to compare: a power of two and a nearby size which isn't one
+SIZE_PAIRS = ((16, 15), (1024, 1000), (4096, 4000))
+
+
+def time_loop(method, arg=None):
+    """!
+    Time calls to a bound method in a loop.
+    @param method The bound method to be called
+    @param arg An argument to pass to the method, or @c None for no argument
+    @returns The time taken for @c NUM_OPS calls in microseconds
+    """
+    if arg is None:
+        begin = utime.ticks_us ()
+        for _ in range (NUM_OPS):
+            method ()
+    else:
+        begin = utime.ticks_us ()
+        for _ in range (NUM_OPS):
+            method (arg)
+    return utime.ticks_diff (utime.ticks_us (), begin)
+
+
+def ns_per_op(size):
+    """!
+    Measure the time per @c put(), @c get() and bulk transferred item for an
+    @c IntQueue of the given size.
+    @param size The number of items the queue can hold
+    @returns A tuple of nanoseconds per put, per get and per item in bulk
+    """
+    queue = cqueue.IntQueue (size)
+    put_us = time_loop (queue.put, 12345)
+    get_us = time_loop (queue.get)
+
+    # Bulk copies which wrap around the end of the array most of the time
+    buf = array.array ('i', range (size * 3 // 4))
+    num_loops = NUM_OPS // len (buf) + 1
+    begin = utime.ticks_us ()
+    for _ in range (num_loops):
+        queue.put_many (buf)
+        queue.get_into (buf)
+    bulk_us = utime.ticks_diff (utime.ticks_us (), begin)
+
+    return (1000.0 * put_us / NUM_OPS, 1000.0 * get_us / NUM_OPS,
+            1000.0 * bulk_us / (2 * len (buf) * num_loops))
+
+
+print (f"{NUM_OPS} operations per measurement, times in ns")
+print ("   Size     put     get    bulk")
+for pow2_size, other_size in SIZE_PAIRS:
+    for size in (pow2_size, other_size):
+        put_ns, get_ns, bulk_ns = ns_per_op (size)
+        print (f"{size:7d} {put_ns:7.1f} {get_ns:7.1f} {bulk_ns:7.2f}"
+               + ("  (masked)" if size == pow2_size else "  (compare)"))
@@ -0,0 +1,81 @@
+"""!
+@file bench_spsc.py
+This file contains a stress test and benchmark for the lock-free single
+producer, single consumer (SPSC) mode of the queues in the cqueue C module.
+A producer thread and a consumer thread pass a sequence of numbers through a
+small queue as fast as they can; the consumer checks that every number arrives
+exactly once and in order.
+
+This program is meant to be run on the MicroPython unix port, where threads
+really do run at the same time, but it also works on boards with @c _thread.
+
+@date   2026-Oct-16 Original file
+"""
+import _thread
+import cqueue
+import utime
+from micropython import const
+
+## The number of items passed from the producer to the consumer in each run
+NUM_ITEMS = const (200000)
+
+## The sizes of the queues tested; small queues are full or empty more often
+QUEUE_SIZES = (4, 64, 1000)
+
+## Results from the producer thread, which sets the flag when it has finished
+producer_done = [False, 0]
+
+
+def producer(queue, num_items):
+    """!
+    Put a sequence of integers into the queue, waiting while it's full.
+    @param queue The queue into which the numbers are put
+    @param num_items How many numbers to put into the queue
+    """
+    waits = 0
+    for count in range (num_items):
+        while queue.full ():
+            waits += 1
+        queue.put (count)
+    producer_done[1] = waits
+    producer_done[0] = True
+
+
+def run(queue_size):
+    """!
+    Pass numbers through one queue and check that they all come out in order.
+    @param queue_size The number of items the queue can hold
+    @returns @c True if all the numbers arrived correctly
+    """
+    queue = cqueue.IntQueue (queue_size, spsc=True)
+    producer_done[0] = False
+
+    begin = utime.ticks_us ()
+    _thread.start_new_thread (producer, (queue, NUM_ITEMS))
+
+    expected = 0
+    errors = 0
+    while expected < NUM_ITEMS:
+        got = queue.get ()
+        if got is not None:
+            if got != expected:
+                errors += 1
+                expected = got
+            expected += 1
+    dur = utime.ticks_diff (utime.ticks_us (), begin)
+
+    while not producer_done[0]:
+        utime.sleep_ms (1)
+
+    print (f"Size {queue_size:5d}: {NUM_ITEMS} items in {dur} us, "
+           + f"{1000.0 * dur / NUM_ITEMS:.0f} ns/item, "
+           + f"{producer_done[1]} full waits, {errors} errors, "
+           + f"max full {queue.max_full ()}")
+    return errors == 0
+
+
+all_ok = True
+for size in QUEUE_SIZES:
+    all_ok = run (size) and all_ok
+
+print ("SPSC stress test " + ("passed." if all_ok else "FAILED."))
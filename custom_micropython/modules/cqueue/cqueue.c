@@ -11,6 +11,53 @@
  *          as well as code in MicroPython's objarray.c.
  *  @date   2022-Oct-29 JRR Added updated object type definition because uPy
  *          has a new model for this. See @c MP_DEFINE_CONST_OBJ_TYPE in here
+ *  @date   2026-Oct-16 Moved ring buffer bookkeeping into a structure shared by
+ *          all the queue classes; added bulk @c put_many() and @c get_into()
+ *  @date   2026-Oct-16 Replaced the item count with separate write and read
+ *          positions; added lock-free single producer, single consumer mode
+ *  @date   2026-Oct-16 Queues whose size is a power of two use masked indices
+ *  @date   2026-Oct-16 Added @c TypedQueue for all the @c array type codes; the
+ *          other classes are now TypedQueues of one type
+ *  @date   2026-Oct-16 Added @c TimedQueue, which stamps each item with the
+ *          time in microseconds at which it was put
+ *  @date   2026-Oct-16 Added @c StructQueue for records of several fields
+ *  @date   2026-Oct-16 Queues support the buffer protocol; added @c views()
+ *          and @c linearize() so ulab can use queue data without copying
+ *  @date   2026-Oct-16 @c get_into() can get one item into a given index, and
+ *          converts types in C so it never allocates memory
+ *  @date   2026-Oct-16 Each queue has an overflow policy, and counts the items
+ *          put, got, dropped and overwritten; see @c counters()
+ *  @date   2026-Oct-16 TypedQueues can keep running statistics of the items put
+ *          into them; see @c stats()
+ *  @date   2026-Oct-16 Added @c FilteredQueue, which runs FIR and IIR filters
+ *          and decimates samples in C as they're put
+ *  @date   2026-Oct-16 Added @c WindowQueue, which keeps the mean, minimum and
+ *          maximum of the last items put, updating them in constant time
+ *  @date   2026-Oct-16 Added @c MedianQueue, which finds the median and other
+ *          percentiles of the last items put in O(log N) time
+ *  @date   2026-Oct-16 Added @c PackedIntQueue, which stores integers as
+ *          varint differences so slowly changing data takes less memory
+ *  @date   2026-Oct-16 Added @c CompactQueue, which stores floats as Q15 or Q31
+ *          fixed point numbers or as half precision floats
+ *  @date   2026-Oct-16 Added @c Share, a value or record shared with interrupt
+ *          callbacks through a sequence lock instead of disabling interrupts
+ *  @date   2026-Oct-16 Added @c TaskQueue, a C version of @c task_share.Queue
+ *  @date   2026-Oct-16 Queue data is kept in a static arena which the garbage
+ *          collector doesn't scan; see @c MICROPY_CQUEUE_DATA_ARENA_SIZE
+ *  @date   2026-Oct-16 Added @c Arena, a buddy allocator from which queues can
+ *          be made and to which @c close() gives their memory back
+ *  @date   2026-Oct-16 @c ByteQueue.put() copies with @c memcpy(), and added
+ *          @c get(n), @c peek() and @c readinto() to ByteQueue
+ *  @date   2026-Oct-16 ByteQueue is a stream which can be polled, written by
+ *          @c print() and read by @c asyncio
+ *  @date   2026-Oct-16 Queues can schedule callbacks when they fill to a high
+ *          watermark or empty to a low one
+ *  @date   2026-Oct-16 Added @c BroadcastQueue, which has one writer and
+ *          several readers, each of which gets every item
+ *  @date   2026-Oct-16 Added @c ThreadQueue, which many threads can use at
+ *          once, with blocking @c put() and @c get() which take timeouts
+ *  @date   2026-Oct-16 Added @c MessageQueue, which keeps messages of any
+ *          length whole, without allocating memory for each one
  *
  *  @copyright (c) 2019-2020 Zoltán Vörös
  *  @copyright (c) 2022 by JR Ridgely, released under the MIT License (MIT)
@@ -39,750 +86,7742 @@
 #include <string.h>
 #include "py/obj.h"
 #include "py/objstr.h"
+#include "py/objint.h"
+#include "py/objarray.h"
 #include "py/runtime.h"
+#include "py/binary.h"
+#include "py/smallint.h"
+#include "py/mphal.h"
+#include "py/stream.h"
+#include "py/mpthread.h"
+
+
+// When a queue carries data from an interrupt callback or another thread to a
+// task, the writer of each index must make its changes visible to the other
+// side in the right order. These are the C11 memory model's acquire and release
+// operations; GCC's builtins are used because MicroPython compiles as gnu99
+#define CQUEUE_LOAD_RELAXED(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CQUEUE_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CQUEUE_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// Time stamps wrap around with the same period as those from time.ticks_us(),
+// so that they can be compared with time.ticks_diff(). The period is set by
+// the port, in the same way as extmod's utime functions set it: 2 ** 30 on
+// 32-bit ports and 2 ** 62 on 64-bit ones such as the unix port. A stamp is
+// kept in a machine word, which holds either, and read into a buffer of this
+// array type code without being converted
+#if defined(MICROPY_PY_UTIME_TICKS_PERIOD)
+#define CQUEUE_TICKS_PERIOD         (MICROPY_PY_UTIME_TICKS_PERIOD)
+#else
+#define CQUEUE_TICKS_PERIOD         (MP_SMALL_INT_POSITIVE_MASK + 1)
+#endif
+#define CQUEUE_TICKS_MASK           ((mp_uint_t)CQUEUE_TICKS_PERIOD - 1)
+#define CQUEUE_TICKS_TYPECODE       (sizeof(mp_uint_t) == 8 ? 'Q' : 'I')
+
+// What a queue does when an item is put into it while it's full: overwrite the
+// oldest item, drop the new one, or raise an exception. These are also the
+// values of the constants cqueue.OVERWRITE, cqueue.REJECT and cqueue.RAISE
+#define CQUEUE_OVERWRITE            (0)
+#define CQUEUE_REJECT               (1)
+#define CQUEUE_RAISE                (2)
+
+// The array type code of MicroPython's float type, used to convert items to
+// floats for statistics
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+#define CQUEUE_FLOAT_TYPECODE       'd'
+#else
+#define CQUEUE_FLOAT_TYPECODE       'f'
+#endif
+
+// The number of bytes of RAM set aside for the data of queues. The garbage
+// collector conservatively scans every block in its heap which can be reached,
+// so samples kept in the heap lengthen each collection and may look like
+// pointers which keep garbage alive. Data in this arena isn't scanned. Queues
+// which don't fit in it keep their data in the heap as before. The arena is
+// static memory which the heap can never use, even in programs which make no
+// queues, and finding a block in it takes time proportional to the number of
+// blocks, so there's none unless a board or build asks for it, such as with
+// CFLAGS_EXTRA=-DMICROPY_CQUEUE_DATA_ARENA_SIZE=16384 or a line in the
+// board's mpconfigboard.h. Freeing data when a queue is collected needs
+// finalisers, so without them the arena isn't used
+#ifndef MICROPY_CQUEUE_DATA_ARENA_SIZE
+#define MICROPY_CQUEUE_DATA_ARENA_SIZE  (0)
+#endif
+#if MICROPY_ENABLE_FINALISER && MICROPY_CQUEUE_DATA_ARENA_SIZE > 0
+#define CQUEUE_USE_ARENA            (1)
+#else
+#define CQUEUE_USE_ARENA            (0)
+#endif
 
 
-/** This structure holds the data of the IntQueue class.
+/** This structure holds the ring buffer in which a queue keeps its data and the
+ *  positions used to get at that data. Every queue class contains one of these
+ *  so that the code which moves data in and out can be shared between classes.
+ *
+ *  The write and read positions count from 0 to twice the size of the array and
+ *  then wrap, so a full queue can be told from an empty one without a separate
+ *  count of items. If the size is a power of two, the positions are free
+ *  running counters instead; array indices are found with a mask and the
+ *  number of items is just the difference between the positions. Only a
+ *  writer changes @c head and only a reader changes @c tail, unless an
+ *  overwriting put must throw away the oldest item. In single producer, single
+ *  consumer (SPSC) mode that never happens, and one interrupt callback or
+ *  thread can put while another gets without locking.
+ *
+ *  The counters of items put, got, dropped and overwritten are each changed
+ *  by only the writer or only the reader, so they need no locking either.
+ *  Likewise only the writer checks the high watermark and only the reader
+ *  checks the low one.
  */
-typedef struct _cqueue_IntQueue_obj_t
+typedef struct _cqueue_ring_t
 {
-    mp_obj_base_t base;
+    byte* p_data;                  // Pointer to array of data
+    mp_obj_t arena;                // Arena the data came from, or None
+    size_t itemsize;               // Number of bytes in each item
+    char typecode;                 // Array type code of the items, as 'i'
+    bool spsc;                     // True if the reader owns the tail alone
+    uint8_t overflow;              // What to do when full, CQUEUE_OVERWRITE...
     size_t size;                   // Size of the array
-    size_t write_idx;              // Array index of write pointer
-    size_t read_idx;               // Array index of read pointer
-    int32_t* p_data;               // Pointer to array of data
-    size_t num_items;              // Number of items currently in the queue
+    size_t wrap;                   // Where positions wrap, twice the size
+    size_t mask;                   // Size - 1 if size is a power of 2, else 0
+    size_t head;                   // Write position, changed only by writer
+    size_t tail;                   // Read position, changed only by reader
     size_t max_full;               // Maximum number of items in the queue
-} cqueue_IntQueue_obj_t;
+    size_t num_puts;               // Number of items put into the queue
+    size_t num_gets;               // Number of items taken from the queue
+    size_t num_drops;              // New items refused because it was full
+    size_t num_overwrites;         // Old items overwritten before being read
+    size_t put_before;             // Items in the ring when a put began
+    size_t high_mark;              // Count at which on_high is scheduled
+    size_t low_mark;               // Count at which on_low is scheduled
+    mp_obj_t on_high;              // Callback for the high mark, or None
+    mp_obj_t on_low;               // Callback for the low mark, or None
+    mp_obj_t mark_arg;             // Argument of the callbacks, or None
+} cqueue_ring_t;
+
+
+/** This structure is the beginning of every queue object, so functions which
+ *  only need the ring buffer can work with any class of queue.
+ */
+typedef struct _cqueue_obj_t
+{
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // The data and indices of the queue
+} cqueue_obj_t;
 
 
-STATIC const mp_obj_type_t cqueue_IntQueue_type;
+/** Convert a write or read position into an index in the array of data.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param pos A position from @c head or @c tail
+ *  @returns The array index at which the item at that position is stored
+ */
+STATIC inline size_t cqueue_ring_index(const cqueue_ring_t* p_ring, size_t pos)
+{
+    if (p_ring->mask)
+    {
+        return pos & p_ring->mask;
+    }
+    return (pos < p_ring->size) ? pos : pos - p_ring->size;
+}
 
 
-/** A way to print an IntQueue object; it's used for debugging.
-*/
-STATIC void IntQueue_print(const mp_print_t *print,
-                        mp_obj_t self_in,
-                        mp_print_kind_t kind)
+/** Move a write or read position forward by some number of items.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param pos The position from which to start
+ *  @param count The number of items to move forward, not more than the size
+ *  @returns The new position
+ */
+STATIC inline size_t cqueue_ring_advance(const cqueue_ring_t* p_ring,
+                                         size_t pos, size_t count)
 {
-    (void)kind;
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_print_str(print, "IntQueue[");
-    mp_obj_print_helper(print, mp_obj_new_int(self->size), PRINT_REPR);
-    mp_print_str(print, "]:");
-    for (size_t index = 0; index < self->size; index++)
+    pos += count;
+    if (!p_ring->mask && pos >= p_ring->wrap)
     {
-        mp_obj_print_helper(print, mp_obj_new_int(self->p_data[index]),
-                            PRINT_REPR);
-        mp_print_str(print, ",");
+        pos -= p_ring->wrap;
     }
-    mp_print_str(print, "W:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->write_idx), PRINT_REPR);
-    mp_print_str(print, ",R:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->read_idx), PRINT_REPR);
+    return pos;
 }
 
 
-/** Set internal variables to indicate an empty queue.
+/** Find the number of items between a read position and a write position.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param head The write position
+ *  @param tail The read position
+ *  @returns The number of items stored in the queue
+ */
+STATIC inline size_t cqueue_ring_span(const cqueue_ring_t* p_ring,
+                                      size_t head, size_t tail)
+{
+    if (p_ring->mask)
+    {
+        return head - tail;
+    }
+    return (head >= tail) ? head - tail : head + p_ring->wrap - tail;
+}
+
+
+/** Find the number of items in a ring. This may be called by either the reader
+ *  or the writer.
+ *  @param p_ring A pointer to the ring buffer
+ *  @returns The number of items in the queue
  */
-STATIC mp_obj_t IntQueue_clear(mp_obj_t self_in)
+STATIC inline size_t cqueue_ring_count(const cqueue_ring_t* p_ring)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&p_ring->tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+    return cqueue_ring_span(p_ring, head, tail);
+}
 
-    self->write_idx = 0;
-    self->read_idx = 0;
-    self->num_items = 0;
-    self->max_full = 0;
 
-    return mp_const_none;
+/** Set a ring's positions to indicate an empty queue. This isn't safe while
+ *  another thread or interrupt is putting or getting.
+ *  @param p_ring A pointer to the ring buffer to be emptied
+ */
+STATIC void cqueue_ring_clear(cqueue_ring_t* p_ring)
+{
+    p_ring->head = 0;
+    p_ring->tail = 0;
+    p_ring->max_full = 0;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_clear_obj, IntQueue_clear);
 
 
-/** Create a new queue, allocating memory in which to store the data.
- *  Preallocating the memory is important when we need to pass information from
- *  an interrupt callback, as interrupt code isn't allowed to allocate memory.
+#if CQUEUE_USE_ARENA
+
+/** The header of each block in the data arena. Blocks follow one another from
+ *  the start of the arena to its end, so the next block is found by adding
+ *  the size. Sizes are multiples of 8 bytes so that data of any type is
+ *  aligned.
  */
-STATIC mp_obj_t IntQueue_make_new(const mp_obj_type_t *type,
-                                  size_t n_args,
-                                  size_t n_kw,
-                                  const mp_obj_t *args)
+typedef struct _cqueue_arena_block_t
+{
+    uint32_t size;                 // Bytes in the block, with this header
+    uint32_t used;                 // Nonzero if the block holds a queue's data
+} cqueue_arena_block_t;
+
+
+/** The arena from which queue data is allocated. It's static memory rather
+ *  than part of the heap, so the garbage collector never scans it. Being
+ *  zeroed at startup, its first header has a size of zero until the first
+ *  allocation makes the whole arena one free block.
+ */
+STATIC uint64_t cqueue_arena[(MICROPY_CQUEUE_DATA_ARENA_SIZE + 7) / 8];
+
+#define CQUEUE_ARENA_END    ((byte*)cqueue_arena + sizeof(cqueue_arena))
+
+
+/** Allocate memory for a queue's data, first fit, from the data arena. Queues
+ *  are usually created once and kept, so a simple search is quick enough.
+ *  @param num_bytes The number of bytes needed
+ *  @returns A pointer to the memory, or @c NULL if no free block is big enough
+ */
+STATIC byte* cqueue_arena_alloc(size_t num_bytes)
+{
+    cqueue_arena_block_t* p_first = (cqueue_arena_block_t*)cqueue_arena;
+    if (p_first->size == 0)
+    {
+        p_first->size = sizeof(cqueue_arena);
+        p_first->used = 0;
+    }
+    if (num_bytes > sizeof(cqueue_arena) - sizeof(cqueue_arena_block_t))
+    {
+        return NULL;
+    }
+    size_t needed = sizeof(cqueue_arena_block_t) + ((num_bytes + 7) & ~7);
+
+    for (byte* p_at = (byte*)cqueue_arena; p_at < CQUEUE_ARENA_END; )
+    {
+        cqueue_arena_block_t* p_block = (cqueue_arena_block_t*)p_at;
+        if (!p_block->used && p_block->size >= needed)
+        {
+            // Split off the rest of the block unless it's too small to use
+            if (p_block->size - needed >= 2 * sizeof(cqueue_arena_block_t))
+            {
+                cqueue_arena_block_t* p_rest =
+                    (cqueue_arena_block_t*)(p_at + needed);
+                p_rest->size = p_block->size - needed;
+                p_rest->used = 0;
+                p_block->size = needed;
+            }
+            p_block->used = 1;
+            return p_at + sizeof(cqueue_arena_block_t);
+        }
+        p_at += p_block->size;
+    }
+    return NULL;
+}
+
+
+/** Return a queue's data to the arena, joining free blocks which are next to
+ *  each other so that the space can hold a big queue again.
+ *  @param p_data A pointer from @c cqueue_arena_alloc()
+ */
+STATIC void cqueue_arena_free(byte* p_data)
 {
-    mp_arg_check_num(n_args, n_kw, 1, 1, true);
-    cqueue_IntQueue_obj_t *self = m_new_obj(cqueue_IntQueue_obj_t);
-    self->base.type = &cqueue_IntQueue_type;
-    self->size = mp_obj_get_int(args[0]);
+    ((cqueue_arena_block_t*)(p_data - sizeof(cqueue_arena_block_t)))->used = 0;
+
+    for (byte* p_at = (byte*)cqueue_arena; p_at < CQUEUE_ARENA_END; )
+    {
+        cqueue_arena_block_t* p_block = (cqueue_arena_block_t*)p_at;
+        cqueue_arena_block_t* p_next =
+            (cqueue_arena_block_t*)(p_at + p_block->size);
+        if (!p_block->used && (byte*)p_next < CQUEUE_ARENA_END
+            && !p_next->used)
+        {
+            p_block->size += p_next->size;
+        }
+        else
+        {
+            p_at += p_block->size;
+        }
+    }
+}
+
+#endif // CQUEUE_USE_ARENA
 
-    IntQueue_clear (self);
+
+/** Allocate memory for the data of a queue, from the data arena if there's
+ *  room in it or else from the heap.
+ *  @param num_bytes The number of bytes needed
+ *  @returns A pointer to the memory
+ */
+STATIC byte* cqueue_data_alloc(size_t num_bytes)
+{
+    #if CQUEUE_USE_ARENA
+    // Threads may create and free queues at once if there's no global lock
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    byte* p_data = cqueue_arena_alloc(num_bytes);
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+    if (p_data != NULL)
+    {
+        return p_data;
+    }
+    #endif
 
     // Tried using malloc(); it usually works but occasionally crashes an ESP32
     // apparently when the memory is accessed some time after allocation.
     // After that, tried using n_new() as in objarray.c's array_new()
-    // self->p_data = malloc (self->size * sizeof (int32_t));
-    self->p_data = (int32_t*)(m_new(byte, sizeof(int32_t) * self->size));
+    return m_new(byte, num_bytes);
+}
 
-    return MP_OBJ_FROM_PTR(self);
+
+/** Free the data of a queue if it's in the data arena. Data in the heap is
+ *  left for the garbage collector, which frees it along with the queue.
+ *  @param p_data A pointer from @c cqueue_data_alloc(), or @c NULL
+ */
+STATIC void cqueue_data_free(byte* p_data)
+{
+    #if CQUEUE_USE_ARENA
+    if (p_data >= (byte*)cqueue_arena && p_data < CQUEUE_ARENA_END)
+    {
+        mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        cqueue_arena_free(p_data);
+        MICROPY_END_ATOMIC_SECTION(irq_state);
+    }
+    #else
+    (void)p_data;
+    #endif
 }
 
 
-/** Return @c True if there are any items in the queue, @c False if it's empty.
+// Blocks in an Arena are powers of two in size, from 32 bytes up. Each begins
+// with a header of 8 bytes, so the data after it is aligned for any type
+#define CQUEUE_POOL_MIN_LOG2        (5)
+#define CQUEUE_POOL_NUM_CLASSES     (31)
+#define CQUEUE_POOL_HEADER          (8)
+
+
+/** The header of a block in an Arena. While the block is free, it's linked
+ *  into the list of free blocks of its size; those links are in what would
+ *  otherwise be the block's data.
+ */
+typedef struct _cqueue_pool_block_t
+{
+    uint32_t log2;                 // The block holds 1 << log2 bytes
+    uint32_t free;                 // Nonzero if the block is in a free list
+    struct _cqueue_pool_block_t* p_next; // Next free block of the same size
+    struct _cqueue_pool_block_t* p_prev; // Previous free block, or NULL
+} cqueue_pool_block_t;
+
+
+/** This structure holds the data of the Arena class, a buddy allocator from
+ *  which queues get their data. A block is split in halves until it's the
+ *  smallest power of two which fits, and when a block is freed it is joined
+ *  with its buddy, the other half of the block from which it was split, if
+ *  that's free too. The number of steps either way is at most the number of
+ *  block sizes, and a bit map of the sizes with free blocks finds a block to
+ *  split without searching, so queues are created and destroyed in a bounded
+ *  time and the arena doesn't fragment as the heap does.
+ */
+typedef struct _cqueue_Arena_obj_t
+{
+    mp_obj_base_t base;
+    byte* p_mem;                   // Memory from which blocks are made
+    size_t size;                   // Number of bytes of it in blocks
+    uint32_t free_sizes;           // Bit n set if there's a free block 2^n
+    size_t used;                   // Bytes in blocks holding queue data
+    size_t max_used;               // Greatest number of bytes ever used
+    size_t num_blocks;             // Number of blocks holding queue data
+    size_t num_fails;              // Number of requests which didn't fit
+    cqueue_pool_block_t* p_free[CQUEUE_POOL_NUM_CLASSES]; // Free blocks
+} cqueue_Arena_obj_t;
+
+
+/** Add a block to the list of free blocks of its size.
+ *  @param self The arena
+ *  @param p_block The block, whose @c log2 has been set
  */
-STATIC mp_obj_t IntQueue_any(mp_obj_t self_in)
+STATIC void cqueue_pool_push(cqueue_Arena_obj_t* self,
+                             cqueue_pool_block_t* p_block)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t log2 = p_block->log2;
+    p_block->free = 1;
+    p_block->p_prev = NULL;
+    p_block->p_next = self->p_free[log2];
+    if (p_block->p_next != NULL)
+    {
+        p_block->p_next->p_prev = p_block;
+    }
+    self->p_free[log2] = p_block;
+    self->free_sizes |= (uint32_t)1 << log2;
+}
+
+
+/** Take a block out of the list of free blocks of its size.
+ *  @param self The arena
+ *  @param p_block The free block
+ */
+STATIC void cqueue_pool_unlink(cqueue_Arena_obj_t* self,
+                               cqueue_pool_block_t* p_block)
+{
+    uint32_t log2 = p_block->log2;
+    if (p_block->p_prev != NULL)
+    {
+        p_block->p_prev->p_next = p_block->p_next;
+    }
+    else
+    {
+        self->p_free[log2] = p_block->p_next;
+    }
+    if (p_block->p_next != NULL)
+    {
+        p_block->p_next->p_prev = p_block->p_prev;
+    }
+    if (self->p_free[log2] == NULL)
+    {
+        self->free_sizes &= ~((uint32_t)1 << log2);
+    }
+    p_block->free = 0;
+}
 
-    return mp_obj_new_bool (self->num_items > 0);
+
+/** Set up an arena's memory as free blocks. If the size isn't a power of two,
+ *  it's covered by several blocks, each as big as its position allows.
+ *  @param self The arena, whose @c p_mem and @c size have been set
+ */
+STATIC void cqueue_pool_init(cqueue_Arena_obj_t* self)
+{
+    memset(self->p_free, 0, sizeof(self->p_free));
+    self->free_sizes = 0;
+    self->used = 0;
+    self->max_used = 0;
+    self->num_blocks = 0;
+    self->num_fails = 0;
+
+    size_t offset = 0;
+    while (self->size - offset >= ((size_t)1 << CQUEUE_POOL_MIN_LOG2))
+    {
+        uint32_t log2 = CQUEUE_POOL_NUM_CLASSES - 1;
+        while ((offset & (((size_t)1 << log2) - 1))
+               || ((size_t)1 << log2) > self->size - offset)
+        {
+            log2--;
+        }
+        cqueue_pool_block_t* p_block =
+            (cqueue_pool_block_t*)(self->p_mem + offset);
+        p_block->log2 = log2;
+        cqueue_pool_push(self, p_block);
+        offset += (size_t)1 << log2;
+    }
+    self->size = offset;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_any_obj, IntQueue_any);
 
 
-/** Return @c True if the queue is full or @c False if there's still room for
- *  more items.
+/** Allocate memory from an arena, splitting the smallest free block which is
+ *  big enough until it's no more than twice as big as needed.
+ *  @param self The arena
+ *  @param num_bytes The number of bytes needed
+ *  @returns A pointer to the memory, or @c NULL if no free block is big enough
  */
-STATIC mp_obj_t IntQueue_full(mp_obj_t self_in)
+STATIC byte* cqueue_pool_alloc(cqueue_Arena_obj_t* self, size_t num_bytes)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    uint32_t log2 = CQUEUE_POOL_MIN_LOG2;
+    while (log2 < CQUEUE_POOL_NUM_CLASSES
+           && ((size_t)1 << log2) < num_bytes + CQUEUE_POOL_HEADER)
+    {
+        log2++;
+    }
+    uint32_t big_enough = (log2 < CQUEUE_POOL_NUM_CLASSES)
+                          ? self->free_sizes & ~(((uint32_t)1 << log2) - 1)
+                          : 0;
+    if (big_enough == 0)
+    {
+        self->num_fails++;
+        return NULL;
+    }
 
-    return mp_obj_new_bool (self->num_items >= self->size);
+    cqueue_pool_block_t* p_block = self->p_free[__builtin_ctz(big_enough)];
+    cqueue_pool_unlink(self, p_block);
+    while (p_block->log2 > log2)
+    {
+        p_block->log2--;
+        cqueue_pool_block_t* p_half = (cqueue_pool_block_t*)
+            ((byte*)p_block + ((size_t)1 << p_block->log2));
+        p_half->log2 = p_block->log2;
+        cqueue_pool_push(self, p_half);
+    }
+
+    self->used += (size_t)1 << log2;
+    self->num_blocks++;
+    if (self->used > self->max_used)
+    {
+        self->max_used = self->used;
+    }
+    return (byte*)p_block + CQUEUE_POOL_HEADER;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_full_obj, IntQueue_full);
 
 
-/** Put an item into the queue. Overwrite old data if the queue is full.
- *  @param to_put An integer to be put into the queue
+/** Give memory back to an arena, joining its block with the block's buddy as
+ *  long as the buddy is free and whole.
+ *  @param self The arena
+ *  @param p_data A pointer from @c cqueue_pool_alloc()
  */
-STATIC mp_obj_t IntQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+STATIC void cqueue_pool_free(cqueue_Arena_obj_t* self, byte* p_data)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    int32_t putted = mp_obj_get_int(to_put);
+    cqueue_pool_block_t* p_block =
+        (cqueue_pool_block_t*)(p_data - CQUEUE_POOL_HEADER);
+    self->used -= (size_t)1 << p_block->log2;
+    self->num_blocks--;
 
-    self->p_data[self->write_idx] = putted;
-    self->write_idx++;
-    if (self->write_idx >= self->size)
+    while (p_block->log2 < CQUEUE_POOL_NUM_CLASSES - 1)
     {
-        self->write_idx = 0;
+        size_t block_size = (size_t)1 << p_block->log2;
+        size_t buddy_at = ((byte*)p_block - self->p_mem) ^ block_size;
+        if (buddy_at + block_size > self->size)
+        {
+            break;
+        }
+        cqueue_pool_block_t* p_buddy =
+            (cqueue_pool_block_t*)(self->p_mem + buddy_at);
+        if (!p_buddy->free || p_buddy->log2 != p_block->log2)
+        {
+            break;
+        }
+        cqueue_pool_unlink(self, p_buddy);
+        if (p_buddy < p_block)
+        {
+            p_block = p_buddy;
+        }
+        p_block->log2++;
     }
+    cqueue_pool_push(self, p_block);
+}
 
-    // If the queue is full before writing, move the read pointer so we'll read
-    // old data, not new data
-    if (self->num_items >= self->size)
+
+STATIC const mp_obj_type_t cqueue_Arena_type;
+
+
+/** Allocate a queue object whose data will be freed when the object is. The
+ *  object has a finaliser, which is @c cqueue_del(), and its data pointer and
+ *  arena are cleared so that the finaliser can run even if the constructor
+ *  fails before the data is allocated.
+ *  @param num_bytes The size of the queue object, whose first part must be a
+ *         @c cqueue_obj_t
+ *  @returns A pointer to the object
+ */
+STATIC void* cqueue_obj_new(size_t num_bytes)
+{
+    #if MICROPY_ENABLE_FINALISER
+    cqueue_obj_t* self = m_malloc_with_finaliser(num_bytes);
+    #else
+    cqueue_obj_t* self = m_malloc(num_bytes);
+    #endif
+    self->ring.p_data = NULL;
+    self->ring.arena = mp_const_none;
+    return self;
+}
+
+
+/** Allocate memory for a ring buffer which holds items of the given type.
+ *  @param p_ring A pointer to the ring buffer being set up
+ *  @param size The number of items the ring can hold
+ *  @param typecode The array type code of the items, such as @c 'f'
+ *  @param itemsize The number of bytes in each item; this is the size of the
+ *         type code's items unless each item is a record holding more data
+ *  @param spsc @c true for single producer, single consumer mode, in which
+ *         the writer never moves the read position, so old items can't be
+ *         overwritten
+ *  @param overflow_in What to do when an item is put into a full queue, one
+ *         of @c CQUEUE_OVERWRITE, @c CQUEUE_REJECT, or @c CQUEUE_RAISE; or
+ *         @c None to overwrite except in SPSC mode, where new items are
+ *         rejected
+ *  @param arena_in An Arena from which the data is taken, or @c None to take
+ *         it from the data arena or the heap
+ */
+STATIC void cqueue_ring_init(cqueue_ring_t* p_ring, mp_int_t size,
+                             char typecode, size_t itemsize, bool spsc,
+                             mp_obj_t overflow_in, mp_obj_t arena_in)
+{
+    if (size < 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Queue size must be positive");
+    }
+    mp_int_t overflow = spsc ? CQUEUE_REJECT : CQUEUE_OVERWRITE;
+    if (overflow_in != mp_const_none)
     {
-        self->read_idx++;
-        if (self->read_idx >= self->size)
+        overflow = mp_obj_get_int(overflow_in);
+        if (overflow < CQUEUE_OVERWRITE || overflow > CQUEUE_RAISE
+            || (spsc && overflow == CQUEUE_OVERWRITE))
         {
-            self->read_idx = 0;
+            mp_raise_ValueError((mp_rom_error_text_t)"Invalid overflow policy");
         }
     }
+    p_ring->typecode = typecode;
+    p_ring->itemsize = itemsize;
+    p_ring->spsc = spsc;
+    p_ring->overflow = (uint8_t)overflow;
+    p_ring->num_puts = 0;
+    p_ring->num_gets = 0;
+    p_ring->num_drops = 0;
+    p_ring->num_overwrites = 0;
+    p_ring->size = (size_t)size;
+    p_ring->wrap = 2 * p_ring->size;
+    p_ring->mask = ((p_ring->size & (p_ring->size - 1)) == 0)
+                   ? p_ring->size - 1 : 0;
+    p_ring->put_before = 0;
+    p_ring->high_mark = p_ring->size;
+    p_ring->low_mark = 0;
+    p_ring->on_high = mp_const_none;
+    p_ring->on_low = mp_const_none;
+    p_ring->mark_arg = mp_const_none;
+
+    cqueue_ring_clear(p_ring);
+
+    p_ring->arena = mp_const_none;
+    if (arena_in == mp_const_none)
+    {
+        p_ring->p_data = cqueue_data_alloc(p_ring->itemsize * p_ring->size);
+        return;
+    }
+    if (!mp_obj_is_type(arena_in, &cqueue_Arena_type))
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"arena must be an Arena");
+    }
 
-    // Now increase the fillage and check again if the queue is full
-    self->num_items++;
-    if (self->num_items >= self->size)
+    // A queue which doesn't fit is an error rather than going to the heap, as
+    // the point of an arena is to know where the memory is
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    p_ring->p_data = cqueue_pool_alloc(MP_OBJ_TO_PTR(arena_in),
+                                       p_ring->itemsize * p_ring->size);
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+    if (p_ring->p_data == NULL)
     {
-        self->num_items = self->size;
+        mp_raise_msg(&mp_type_MemoryError,
+                     (mp_rom_error_text_t)"Arena has no room for queue");
     }
-    if (self->num_items > self->max_full)
+    p_ring->arena = arena_in;
+}
+
+
+/** Free the data of a ring and leave it closed: it has no room, so putting
+ *  items into it raises an exception, and it has nothing to get. Data from an
+ *  Arena or the data arena is given back; data in the heap is left for the
+ *  garbage collector, as views of it may still be held. If the ring's Arena
+ *  has already been finalised, which happens when the garbage collector frees
+ *  it in the same sweep as the queue, its memory is gone and nothing is given
+ *  back to it.
+ *  @param p_ring A pointer to the ring buffer to be closed
+ */
+STATIC void cqueue_ring_free(cqueue_ring_t* p_ring)
+{
+    if (p_ring->p_data != NULL && p_ring->arena != mp_const_none)
+    {
+        cqueue_Arena_obj_t* p_arena = MP_OBJ_TO_PTR(p_ring->arena);
+        mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        if (p_arena->p_mem != NULL)
+        {
+            cqueue_pool_free(p_arena, p_ring->p_data);
+        }
+        MICROPY_END_ATOMIC_SECTION(irq_state);
+    }
+    else
     {
-        self->max_full = self->num_items;
+        cqueue_data_free(p_ring->p_data);
     }
+    p_ring->p_data = NULL;
+    p_ring->arena = mp_const_none;
+    p_ring->size = 0;
+    p_ring->wrap = 0;
+    p_ring->mask = 0;
+    p_ring->overflow = CQUEUE_RAISE;
+    p_ring->on_high = mp_const_none;
+    p_ring->on_low = mp_const_none;
+    p_ring->mark_arg = mp_const_none;
+    cqueue_ring_clear(p_ring);
+}
 
-    return mp_const_none;
+
+/** Raise the exception for an item which doesn't fit in a ring whose overflow
+ *  policy is to raise one. A closed ring never has room, so putting anything
+ *  into one ends up here too.
+ *  @param p_ring A pointer to the ring buffer which is full
+ */
+STATIC NORETURN void cqueue_ring_raise_full(const cqueue_ring_t* p_ring)
+{
+    if (p_ring->p_data == NULL)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Queue is closed");
+    }
+    mp_raise_msg(&mp_type_OverflowError, (mp_rom_error_text_t)"Queue is full");
 }
-MP_DEFINE_CONST_FUN_OBJ_2(IntQueue_put_obj, IntQueue_put);
 
 
-/** Get an item from the queue.
- *  @returns The oldest data in the queue, or @c None if the queue is empty.
+/** The arguments accepted by the constructors of queues built on a ring.
  */
-STATIC mp_obj_t IntQueue_get(mp_obj_t self_in)
+STATIC const mp_arg_t cqueue_ring_make_new_args[] =
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
 
-    // Make sure there's something to get
-    if (self->num_items == 0)
+
+/** Schedule a watermark callback to be run soon by MicroPython, with the
+ *  argument given to @c watermarks() or, if there wasn't one, the queue which
+ *  holds the ring. This is safe in an interrupt callback, as the callback
+ *  itself runs later, between bytecodes. If MicroPython's list of scheduled
+ *  callbacks is full, this one is missed.
+ *  @param p_ring A pointer to the ring buffer, which begins a queue object
+ *  @param callback The function to be scheduled
+ */
+STATIC void cqueue_ring_schedule(cqueue_ring_t* p_ring, mp_obj_t callback)
+{
+    #if MICROPY_ENABLE_SCHEDULER
+    mp_obj_t arg = p_ring->mark_arg;
+    if (arg == mp_const_none)
     {
-        return mp_const_none;
+        arg = MP_OBJ_FROM_PTR((byte*)p_ring - offsetof(cqueue_obj_t, ring));
     }
+    mp_sched_schedule(callback, arg);
+    #else
+    (void)p_ring;
+    (void)callback;
+    #endif
+}
 
-    int32_t to_return = self->p_data[self->read_idx];
 
-    // If we get here, the queue has some data in it
-    self->read_idx++;
-    if (self->read_idx >= self->size)
+/** Schedule the high watermark callback if a put has just taken the number of
+ *  items from below the high mark to or above it. The writer calls this only
+ *  when there's a callback, so queues without one lose no time.
+ *  @param p_ring A pointer to the ring buffer into which items were put
+ *  @param before The number of items before the put
+ *  @param after The number of items after the put
+ */
+STATIC inline void cqueue_ring_check_high(cqueue_ring_t* p_ring,
+                                          size_t before, size_t after)
+{
+    if (before < p_ring->high_mark && after >= p_ring->high_mark)
     {
-        self->read_idx = 0;
+        cqueue_ring_schedule(p_ring, p_ring->on_high);
     }
+}
+
 
-    self->num_items--;
-    if ((int32_t)(self->num_items) <= 0)
+/** Schedule the low watermark callback if a get has just taken the number of
+ *  items from above the low mark to or below it. The reader calls this only
+ *  when there's a callback.
+ *  @param p_ring A pointer to the ring buffer from which items were taken
+ *  @param before The number of items before the get
+ *  @param after The number of items after the get
+ */
+STATIC inline void cqueue_ring_check_low(cqueue_ring_t* p_ring,
+                                         size_t before, size_t after)
+{
+    if (before > p_ring->low_mark && after <= p_ring->low_mark)
     {
-        self->num_items = 0;
+        cqueue_ring_schedule(p_ring, p_ring->on_low);
     }
-    return mp_obj_new_int(to_return);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_get_obj, IntQueue_get);
 
 
-/** Return the number of items in the queue.
- *  @return The number of items available to be read from the queue
+/** Find the place where the next item is to be written into a ring. If the
+ *  queue is full, the ring's overflow policy decides whether the oldest item
+ *  is overwritten to make room, the new item is dropped, or an exception is
+ *  raised. After writing the item, the writer calls
+ *  @c cqueue_ring_put_commit().
+ *  @param p_ring A pointer to the ring buffer which will receive the item
+ *  @returns A pointer to the place for the item, or @c NULL if there's none
  */
-STATIC mp_obj_t IntQueue_available(mp_obj_t self_in)
+STATIC inline byte* cqueue_ring_put_slot(cqueue_ring_t* p_ring)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&p_ring->tail);
 
-    return mp_obj_new_int (self->num_items);
+    p_ring->put_before = cqueue_ring_span(p_ring, head, tail);
+    if (p_ring->put_before >= p_ring->size)
+    {
+        if (p_ring->overflow != CQUEUE_OVERWRITE)
+        {
+            p_ring->num_drops++;
+            if (p_ring->overflow == CQUEUE_RAISE)
+            {
+                cqueue_ring_raise_full(p_ring);
+            }
+            return NULL;
+        }
+        // Move the read position so we'll read old data, not new data
+        CQUEUE_STORE_RELEASE(&p_ring->tail, cqueue_ring_advance(p_ring, tail, 1));
+        p_ring->num_overwrites++;
+    }
+    return p_ring->p_data + cqueue_ring_index(p_ring, head) * p_ring->itemsize;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_available_obj, IntQueue_available);
 
 
-/** Return the maximum number of items which have been in the queue since the
- *  queue was created or cleared.
- *  @returns The maximum number of items which have been in the queue
+/** Make an item written at the place given by @c cqueue_ring_put_slot()
+ *  available to the reader. The release store makes sure the reader can't see
+ *  the new write position before it can see the data.
+ *  @param p_ring A pointer to the ring buffer which received the item
+ */
+STATIC inline void cqueue_ring_put_commit(cqueue_ring_t* p_ring)
+{
+    size_t head = cqueue_ring_advance(p_ring,
+                                      CQUEUE_LOAD_RELAXED(&p_ring->head), 1);
+    CQUEUE_STORE_RELEASE(&p_ring->head, head);
+    p_ring->num_puts++;
+
+    size_t num_items = cqueue_ring_span(p_ring, head,
+                                        CQUEUE_LOAD_RELAXED(&p_ring->tail));
+    if (num_items > p_ring->max_full)
+    {
+        p_ring->max_full = num_items;
+    }
+    if (p_ring->on_high != mp_const_none)
+    {
+        cqueue_ring_check_high(p_ring, p_ring->put_before, num_items);
+    }
+}
+
+
+/** Find the oldest item in a ring so that it can be read. After reading it,
+ *  the reader calls @c cqueue_ring_get_commit().
+ *  @param p_ring A pointer to the ring buffer holding the item
+ *  @returns A pointer to the oldest item, or @c NULL if the queue is empty
  */
-STATIC mp_obj_t IntQueue_max_full(mp_obj_t self_in)
+STATIC inline byte* cqueue_ring_get_slot(cqueue_ring_t* p_ring)
 {
-    cqueue_IntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
 
-    return mp_obj_new_int (self->max_full);
+    if (tail == CQUEUE_LOAD_ACQUIRE(&p_ring->head))
+    {
+        return NULL;
+    }
+    return p_ring->p_data + cqueue_ring_index(p_ring, tail) * p_ring->itemsize;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(IntQueue_max_full_obj, IntQueue_max_full);
 
 
-/** A dictionary of names and functions used to register the above functions
- *  with MicroPython
+/** Give the place from which an item was read back to the writer. The release
+ *  store makes sure the item has been read before the writer can reuse it.
+ *  @param p_ring A pointer to the ring buffer from which an item was read
  */
-STATIC const mp_rom_map_elem_t IntQueue_locals_dict_table[] =
+STATIC inline void cqueue_ring_get_commit(cqueue_ring_t* p_ring)
 {
-    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&IntQueue_clear_obj) },
-    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&IntQueue_any_obj) },
-    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&IntQueue_full_obj) },
-    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&IntQueue_put_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&IntQueue_get_obj) },
-    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&IntQueue_available_obj) },
-    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&IntQueue_max_full_obj) },
-};
-STATIC MP_DEFINE_CONST_DICT(IntQueue_locals_dict, IntQueue_locals_dict_table);
+    size_t tail = cqueue_ring_advance(p_ring,
+                                      CQUEUE_LOAD_RELAXED(&p_ring->tail), 1);
+    CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    p_ring->num_gets++;
 
+    if (p_ring->on_low != mp_const_none)
+    {
+        size_t num_items = cqueue_ring_span(p_ring,
+                               CQUEUE_LOAD_ACQUIRE(&p_ring->head), tail);
+        cqueue_ring_check_low(p_ring, num_items + 1, num_items);
+    }
+}
 
-// Probably only works for MicroPython versions from late 2022 and after
-STATIC MP_DEFINE_CONST_OBJ_TYPE(
-    cqueue_IntQueue_type,
-    MP_QSTR_IntQueue,
-    MP_TYPE_FLAG_NONE,
-    // Each of the following lines is:  slot_name, function_name,
-    print, IntQueue_print,
-    make_new, IntQueue_make_new,
-    locals_dict, &IntQueue_locals_dict
-);
 
+/** Copy a block of items into the ring, using at most two calls to @c memcpy(),
+ *  one on each side of the place where the ring wraps around. If there isn't
+ *  room for all of them, the oldest data is overwritten, the items which don't
+ *  fit are dropped, or an exception is raised and nothing is copied,
+ *  according to the ring's overflow policy.
+ *  @param p_ring A pointer to the ring buffer which receives the items
+ *  @param p_src A pointer to the items, which must match the ring's type
+ *  @param count The number of items to be copied
+ */
+STATIC void cqueue_ring_put_many(cqueue_ring_t* p_ring, const byte* p_src,
+                                 size_t count)
+{
+    if (count == 0)
+    {
+        // A closed ring has no data array to copy into
+        return;
+    }
+    size_t size = p_ring->size;
+    size_t itemsize = p_ring->itemsize;
+    size_t head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&p_ring->tail);
+    size_t before = cqueue_ring_span(p_ring, head, tail);
+    size_t room = size - before;
+
+    if (count > room && p_ring->overflow == CQUEUE_RAISE)
+    {
+        // None of the items are put, so all of them count as dropped
+        p_ring->num_drops += count;
+        cqueue_ring_raise_full(p_ring);
+    }
+    else if (count > room && p_ring->overflow == CQUEUE_REJECT)
+    {
+        p_ring->num_drops += count - room;
+        count = room;
+    }
+    else if (count > size)
+    {
+        // If more items are given than will fit, only the newest ones are
+        // copied. The others count as put and then overwritten, as they
+        // would if the items were put one at a time
+        p_ring->num_puts += count - size;
+        p_ring->num_overwrites += count - size;
+        p_src += (count - size) * itemsize;
+        count = size;
+    }
 
-//=============================================================================
+    // Old items which the new ones replace count as overwritten
+    if (count > room)
+    {
+        p_ring->num_overwrites += count - room;
+    }
+    p_ring->num_puts += count;
 
-// This silliness was used when rebuilding the code after the late 2022 change
-// in the way object types are declared. It ought not be needed. Probably.
-#ifdef FLOOFY
-    // This is a function which will be called from Python, as floof(x)
-    STATIC mp_obj_t floof(mp_obj_t x_obj)
+    if (count == size)
     {
-        // Extract the integer from the MicroPython input object
-        mp_int_t x = mp_obj_get_int(x_obj);
+        tail = head;
+        CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    }
+    else if (count > room)
+    {
+        // Move the read position past old data which is to be overwritten
+        tail = cqueue_ring_advance(p_ring, tail, count - room);
+        CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    }
 
-        // Multiply by 22 because it's silly
-        mp_int_t result = x * 22;
+    // Copy up to the end of the array, then the rest to the beginning
+    size_t write_idx = cqueue_ring_index(p_ring, head);
+    size_t first = size - write_idx;
+    if (first > count)
+    {
+        first = count;
+    }
+    memcpy(p_ring->p_data + write_idx * itemsize, p_src, first * itemsize);
+    memcpy(p_ring->p_data, p_src + first * itemsize, (count - first) * itemsize);
 
-        // Convert the result to a MicroPython integer object and return it
-        return mp_obj_new_int(result);
+    head = cqueue_ring_advance(p_ring, head, count);
+    CQUEUE_STORE_RELEASE(&p_ring->head, head);
+
+    size_t num_items = cqueue_ring_span(p_ring, head, tail);
+    if (num_items > p_ring->max_full)
+    {
+        p_ring->max_full = num_items;
+    }
+    if (p_ring->on_high != mp_const_none)
+    {
+        cqueue_ring_check_high(p_ring, before, num_items);
+    }
+}
+
+
+/** Copy up to the given number of the oldest items out of the ring, using at
+ *  most two calls to @c memcpy(), but leave them in the ring.
+ *  @param p_ring A pointer to the ring buffer whose items are copied
+ *  @param p_dest A pointer to memory which receives the items
+ *  @param count The largest number of items to be copied
+ *  @returns The number of items which were copied
+ */
+STATIC size_t cqueue_ring_peek_many(cqueue_ring_t* p_ring, byte* p_dest,
+                                    size_t count)
+{
+    size_t size = p_ring->size;
+    size_t itemsize = p_ring->itemsize;
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+    size_t num_items = cqueue_ring_span(p_ring, head, tail);
+
+    if (count > num_items)
+    {
+        count = num_items;
+    }
+    if (count == 0)
+    {
+        // A closed ring has no data array to copy from
+        return 0;
+    }
+    size_t read_idx = cqueue_ring_index(p_ring, tail);
+    size_t first = size - read_idx;
+    if (first > count)
+    {
+        first = count;
+    }
+    memcpy(p_dest, p_ring->p_data + read_idx * itemsize, first * itemsize);
+    memcpy(p_dest + first * itemsize, p_ring->p_data,
+           (count - first) * itemsize);
+
+    return count;
+}
+
+
+/** Copy up to the given number of the oldest items out of the ring, using at
+ *  most two calls to @c memcpy(), and remove them from the ring.
+ *  @param p_ring A pointer to the ring buffer from which items are taken
+ *  @param p_dest A pointer to memory which receives the items
+ *  @param count The largest number of items to be copied
+ *  @returns The number of items which were copied
+ */
+STATIC size_t cqueue_ring_get_many(cqueue_ring_t* p_ring, byte* p_dest,
+                                   size_t count)
+{
+    // Only the consumer moves the read position, so it can't change here
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    count = cqueue_ring_peek_many(p_ring, p_dest, count);
+
+    CQUEUE_STORE_RELEASE(&p_ring->tail, cqueue_ring_advance(p_ring, tail, count));
+    p_ring->num_gets += count;
+
+    if (p_ring->on_low != mp_const_none && count > 0)
+    {
+        size_t num_items = cqueue_ring_count(p_ring);
+        cqueue_ring_check_low(p_ring, num_items + count, num_items);
+    }
+
+    return count;
+}
+
+/** Reverse the order of the bytes in part of an array.
+ *  @param p_start A pointer to the first byte to be moved
+ *  @param p_end A pointer just past the last byte to be moved
+ */
+STATIC void cqueue_reverse_bytes(byte* p_start, byte* p_end)
+{
+    while (p_start + 1 < p_end)
+    {
+        byte temp = *p_start;
+        *p_start++ = *--p_end;
+        *p_end = temp;
+    }
+}
+
+
+/** Move the items in a ring so that the oldest is at the beginning of the
+ *  array and all of them are in one contiguous block. The ring is rotated in
+ *  place, by reversing its two parts and then the whole array, so no memory
+ *  is needed. This isn't safe while another thread or interrupt is putting or
+ *  getting.
+ *  @param p_ring A pointer to the ring buffer to be rearranged
+ *  @returns The number of items in the ring
+ */
+STATIC size_t cqueue_ring_linearize(cqueue_ring_t* p_ring)
+{
+    size_t count = cqueue_ring_count(p_ring);
+    size_t read_idx = cqueue_ring_index(p_ring, p_ring->tail);
+    byte* p_data = p_ring->p_data;
+    size_t itemsize = p_ring->itemsize;
+
+    if (read_idx == 0)
+    {
+        // The items already begin at the start of the array
+    }
+    else if (read_idx + count <= p_ring->size)
+    {
+        // The items don't wrap around, so they only need to be slid down
+        memmove(p_data, p_data + read_idx * itemsize, count * itemsize);
+    }
+    else
+    {
+        byte* p_split = p_data + read_idx * itemsize;
+        byte* p_end = p_data + p_ring->size * itemsize;
+        cqueue_reverse_bytes(p_data, p_split);
+        cqueue_reverse_bytes(p_split, p_end);
+        cqueue_reverse_bytes(p_data, p_end);
+    }
+
+    p_ring->tail = 0;
+    p_ring->head = count;
+
+    return count;
+}
+
+
+/** Get a buffer from an object which supports the buffer protocol, and find
+ *  out whether its items have the same layout as those of the given type so
+ *  they can be copied with @c memcpy(). Type codes such as @c 'i' and @c 'l'
+ *  match if they are the same size on this port; signedness doesn't matter,
+ *  but integers and floats don't mix.
+ *  @param typecode The array type code of the items in a queue
+ *  @param buf_in The object whose buffer is wanted
+ *  @param p_bufinfo A pointer to a structure which receives the buffer info;
+ *         a @c bytearray's type code is changed to @c 'B'
+ *  @param flags @c MP_BUFFER_READ or @c MP_BUFFER_WRITE
+ *  @param p_count A pointer to a variable which receives the number of items
+ *  @returns @c true if the buffer's items can be copied byte for byte
+ */
+STATIC bool cqueue_get_buffer(char typecode, mp_obj_t buf_in,
+                              mp_buffer_info_t* p_bufinfo, mp_uint_t flags,
+                              size_t* p_count)
+{
+    mp_get_buffer_raise(buf_in, p_bufinfo, flags);
+    if (p_bufinfo->typecode == BYTEARRAY_TYPECODE)
+    {
+        p_bufinfo->typecode = 'B';
+    }
+    size_t itemsize = mp_binary_get_size('@', p_bufinfo->typecode, NULL);
+    *p_count = p_bufinfo->len / itemsize;
+
+    bool buf_float = (p_bufinfo->typecode == 'f' || p_bufinfo->typecode == 'd');
+    bool queue_float = (typecode == 'f' || typecode == 'd');
+    return (p_bufinfo->typecode == typecode)
+           || (buf_float == queue_float
+               && itemsize == mp_binary_get_size('@', typecode, NULL));
+}
+
+/** Copy one number from one array type to another, converting it in C so that
+ *  no MicroPython objects are made and no memory is allocated. Integers of
+ *  any size convert to each other and to floats, and floats to floats; as
+ *  with @c array.array, floats can't be put into an array of integers.
+ *  @param dest_code The type code of the destination, such as @c 'h'
+ *  @param p_dest A pointer to the place where the number is written
+ *  @param src_code The type code of the source
+ *  @param p_src A pointer to the number to be copied
+ */
+STATIC void cqueue_convert_item(char dest_code, byte* p_dest, char src_code,
+                                const byte* p_src)
+{
+    long long int_value = 0;
+    double float_value = 0.0;
+    bool src_float = false;
+
+    switch (src_code)
+    {
+        case 'b': int_value = *(const int8_t*)p_src;              break;
+        case 'B': int_value = *(const uint8_t*)p_src;             break;
+        case 'h': int_value = *(const int16_t*)p_src;             break;
+        case 'H': int_value = *(const uint16_t*)p_src;            break;
+        case 'i': int_value = *(const int32_t*)p_src;             break;
+        case 'I': int_value = *(const uint32_t*)p_src;            break;
+        case 'l': int_value = *(const long*)p_src;                break;
+        case 'L': int_value = *(const unsigned long*)p_src;       break;
+        case 'q': int_value = *(const int64_t*)p_src;             break;
+        case 'Q': int_value = (long long)*(const uint64_t*)p_src; break;
+        case 'f': float_value = *(const float*)p_src;  src_float = true; break;
+        case 'd': float_value = *(const double*)p_src; src_float = true; break;
+        default:
+            mp_raise_TypeError((mp_rom_error_text_t)"Unsupported buffer type");
+    }
+
+    if (dest_code == 'f' || dest_code == 'd')
+    {
+        if (!src_float)
+        {
+            float_value = (double)int_value;
+        }
+        if (dest_code == 'f')
+        {
+            *(float*)p_dest = (float)float_value;
+        }
+        else
+        {
+            *(double*)p_dest = float_value;
+        }
+        return;
+    }
+    if (src_float)
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Can't convert float to int");
+    }
+    switch (dest_code)
+    {
+        case 'b': *(int8_t*)p_dest = (int8_t)int_value;               break;
+        case 'B': *(uint8_t*)p_dest = (uint8_t)int_value;             break;
+        case 'h': *(int16_t*)p_dest = (int16_t)int_value;             break;
+        case 'H': *(uint16_t*)p_dest = (uint16_t)int_value;           break;
+        case 'i': *(int32_t*)p_dest = (int32_t)int_value;             break;
+        case 'I': *(uint32_t*)p_dest = (uint32_t)int_value;           break;
+        case 'l': *(long*)p_dest = (long)int_value;                   break;
+        case 'L': *(unsigned long*)p_dest = (unsigned long)int_value; break;
+        case 'q': *(int64_t*)p_dest = (int64_t)int_value;             break;
+        case 'Q': *(uint64_t*)p_dest = (uint64_t)int_value;           break;
+        default:
+            mp_raise_TypeError((mp_rom_error_text_t)"Unsupported buffer type");
+    }
+}
+
+
+/** Apply a ring's overflow policy to a block of items which are to be put one
+ *  at a time, as @c cqueue_ring_put_many() does to a block which it copies,
+ *  so that all or none of the block is refused. If the block holds more items
+ *  than the ring, the oldest ones would be overwritten by later ones in the
+ *  same block, so they aren't stored at all; they count as put and then
+ *  overwritten, as they would if the items were put one at a time.
+ *  @param p_ring A pointer to the ring buffer which is to receive the items
+ *  @param p_count A pointer to the number of items in the block, which is
+ *         changed to one past the index of the last item to be put
+ *  @returns The index of the first item in the block which is to be put
+ */
+STATIC size_t cqueue_ring_limit_puts(cqueue_ring_t* p_ring, size_t* p_count)
+{
+    size_t count = *p_count;
+    size_t room = p_ring->size - cqueue_ring_count(p_ring);
+    if (count > room && p_ring->overflow == CQUEUE_RAISE)
+    {
+        p_ring->num_drops += count;
+        cqueue_ring_raise_full(p_ring);
+    }
+    else if (count > room && p_ring->overflow == CQUEUE_REJECT)
+    {
+        p_ring->num_drops += count - room;
+        *p_count = room;
+        return 0;
+    }
+
+    size_t first = 0;
+    if (count > p_ring->size)
+    {
+        first = count - p_ring->size;
+        p_ring->num_puts += first;
+        p_ring->num_overwrites += first;
+    }
+    return first;
+}
+
+
+/** Put all the items in an object which supports the buffer protocol, such as
+ *  an @c array.array, @c bytearray, or ulab @c ndarray, into a queue. If the
+ *  buffer's items have the same layout as the queue's, they're copied with at
+ *  most two @c memcpy() calls; otherwise each item is converted. If the queue
+ *  becomes full, the oldest data is overwritten, the items which don't fit
+ *  are dropped, or an exception is raised, as with @c put().
+ *  @param self_in The queue into which items are put
+ *  @param buf_in The object holding items to be put into the queue
+ */
+STATIC mp_obj_t cqueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    if (cqueue_get_buffer(p_ring->typecode, buf_in, &bufinfo, MP_BUFFER_READ,
+                          &count))
+    {
+        cqueue_ring_put_many(p_ring, bufinfo.buf, count);
+    }
+    else
+    {
+        size_t first = cqueue_ring_limit_puts(p_ring, &count);
+        size_t buf_itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+        for (size_t index = first; index < count; index++)
+        {
+            uint64_t item;
+            cqueue_convert_item(p_ring->typecode, (byte*)&item,
+                bufinfo.typecode,
+                (const byte*)bufinfo.buf + index * buf_itemsize);
+            byte* p_slot = cqueue_ring_put_slot(p_ring);
+            if (p_slot == NULL)
+            {
+                break;
+            }
+            memcpy(p_slot, &item, p_ring->itemsize);
+            cqueue_ring_put_commit(p_ring);
+        }
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(cqueue_put_many_obj, cqueue_put_many);
+
+
+/** Get as many items as are available, up to the length of a preallocated
+ *  buffer, and copy them into the buffer. The buffer can be any object which
+ *  supports the buffer protocol; items are copied with at most two @c memcpy()
+ *  calls if the buffer's type matches the queue's, and otherwise converted in
+ *  C. If an index is given, only one item is taken and it's written into the
+ *  buffer at that index. No memory is allocated either way, so this can be
+ *  used while the heap is locked, as it is in an interrupt callback.
+ *  @param n_args The number of arguments, two or three
+ *  @param args The queue, the object into whose buffer the items are written,
+ *         and optionally the index at which to write one item
+ *  @returns The number of items which were written into the buffer
+ */
+STATIC mp_obj_t cqueue_get_into(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    bool direct = cqueue_get_buffer(p_ring->typecode, args[1], &bufinfo,
+                                    MP_BUFFER_WRITE, &count);
+    size_t buf_itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    byte* p_dest = bufinfo.buf;
+
+    if (n_args > 2)
+    {
+        // Get one item into the given place, counting from the end if the
+        // index is negative as Python does
+        mp_int_t index = mp_obj_get_int(args[2]);
+        if (index < 0)
+        {
+            index += count;
+        }
+        if (index < 0 || (size_t)index >= count)
+        {
+            mp_raise_msg(&mp_type_IndexError,
+                         (mp_rom_error_text_t)"Index out of range");
+        }
+        p_dest += index * buf_itemsize;
+        count = 1;
+    }
+
+    if (direct)
+    {
+        count = cqueue_ring_get_many(p_ring, p_dest, count);
+    }
+    else
+    {
+        size_t index = 0;
+        byte* p_slot;
+        while (index < count && (p_slot = cqueue_ring_get_slot(p_ring)) != NULL)
+        {
+            cqueue_convert_item(bufinfo.typecode, p_dest + index * buf_itemsize,
+                                p_ring->typecode, p_slot);
+            cqueue_ring_get_commit(p_ring);
+            index++;
+        }
+        count = index;
+    }
+
+    return mp_obj_new_int(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(cqueue_get_into_obj, 2, 3,
+                                    cqueue_get_into);
+
+
+/** Make a memoryview of some of the items in a ring. If the ring's items are
+ *  records which don't match a type code, the view is of bytes.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param index The array index of the first item in the view
+ *  @param count The number of items in the view
+ *  @returns A writable memoryview of the items
+ */
+STATIC mp_obj_t cqueue_ring_view(const cqueue_ring_t* p_ring, size_t index,
+                                 size_t count)
+{
+    byte* p_first = p_ring->p_data + index * p_ring->itemsize;
+    if (p_ring->itemsize == mp_binary_get_size('@', p_ring->typecode, NULL))
+    {
+        return mp_obj_new_memoryview(
+            p_ring->typecode | MP_OBJ_ARRAY_TYPECODE_FLAG_RW, count, p_first);
+    }
+    return mp_obj_new_memoryview('B' | MP_OBJ_ARRAY_TYPECODE_FLAG_RW,
+                                 count * p_ring->itemsize, p_first);
+}
+
+
+/** Get memoryviews of the items in a queue without copying or removing them,
+ *  for example so that @c ulab.numpy.frombuffer() can work on them. The items
+ *  are usually in two pieces, one at the end of the queue's memory and the
+ *  other at the beginning. The views are only valid until more items are put
+ *  into the queue, and only while the queue itself is kept. A view of data in
+ *  the heap keeps that memory from being collected, but a view of data in the
+ *  data arena or an @c Arena doesn't; when the queue is collected or closed,
+ *  its memory goes back to the arena and may be given to another queue.
+ *  @param self_in The queue whose items are to be viewed
+ *  @returns A tuple of zero, one, or two memoryviews which hold the items
+ *           from oldest to newest
+ */
+STATIC mp_obj_t cqueue_views(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+
+    size_t count = cqueue_ring_count(p_ring);
+    size_t read_idx = cqueue_ring_index(p_ring, p_ring->tail);
+    size_t first = p_ring->size - read_idx;
+    if (first > count)
+    {
+        first = count;
+    }
+
+    mp_obj_t views[2];
+    size_t num_views = 0;
+    if (first > 0)
+    {
+        views[num_views++] = cqueue_ring_view(p_ring, read_idx, first);
+    }
+    if (count > first)
+    {
+        views[num_views++] = cqueue_ring_view(p_ring, 0, count - first);
+    }
+
+    return mp_obj_new_tuple(num_views, views);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(cqueue_views_obj, cqueue_views);
+
+
+/** Rotate a queue's memory in place so that its items are in one block, oldest
+ *  first, and return a view of them. This shouldn't be called while another
+ *  thread or an interrupt callback might put items into the queue.
+ *  @param self_in The queue whose items are to be rearranged
+ *  @returns A memoryview of all the items in the queue
+ */
+STATIC mp_obj_t cqueue_linearize(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t count = cqueue_ring_linearize(&self->ring);
+
+    return cqueue_ring_view(&self->ring, 0, count);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(cqueue_linearize_obj, cqueue_linearize);
+
+
+/** Return the counts of items which have been put into a queue, taken from it,
+ *  dropped because the queue was full, and overwritten before being read. The
+ *  counts are read, and reset if asked, with interrupts disabled, so they're
+ *  consistent with each other and no count made by an interrupt callback in
+ *  between is lost.
+ *  @param n_args The number of arguments, 1 or 2
+ *  @param args The queue and, optionally, a flag which if true causes the
+ *         counters to be set to zero after being read
+ *  @returns A tuple @c (puts, gets, drops, overwrites)
+ */
+STATIC mp_obj_t cqueue_counters(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    cqueue_ring_t* p_ring = &self->ring;
+    bool reset = (n_args > 1 && mp_obj_is_true(args[1]));
+
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    size_t puts = p_ring->num_puts;
+    size_t gets = p_ring->num_gets;
+    size_t drops = p_ring->num_drops;
+    size_t overwrites = p_ring->num_overwrites;
+    if (reset)
+    {
+        p_ring->num_puts = 0;
+        p_ring->num_gets = 0;
+        p_ring->num_drops = 0;
+        p_ring->num_overwrites = 0;
+    }
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+
+    mp_obj_t counts[4] =
+    {
+        mp_obj_new_int_from_uint(puts),
+        mp_obj_new_int_from_uint(gets),
+        mp_obj_new_int_from_uint(drops),
+        mp_obj_new_int_from_uint(overwrites),
+    };
+    return mp_obj_new_tuple(4, counts);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(cqueue_counters_obj, 1, 2,
+                                    cqueue_counters);
+
+
+/** Free a queue's data when the garbage collector frees the queue. Data in
+ *  an Arena or the data arena must be given back, as the collector doesn't
+ *  know about it; data in the heap is simply left to be collected. If the
+ *  queue's Arena is being collected at the same time, its finaliser may have
+ *  run first. Its object then still holds what the finaliser left in it, as
+ *  nothing can be allocated during the sweep to reuse it, so its null memory
+ *  pointer shows that the queue's data mustn't be given back to it.
+ *  @param self_in The queue which is being freed
+ */
+STATIC mp_obj_t cqueue_del(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_free(&self->ring);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(cqueue_del_obj, cqueue_del);
+
+
+/** Close a queue, giving its memory back to the Arena it came from, or to the
+ *  data arena, at once rather than when the queue is collected. The queue is
+ *  left empty and with no room; putting items into it raises @c ValueError.
+ *  Views of the queue's data mustn't be used after it's closed.
+ *  @param self_in The queue to be closed
+ */
+STATIC mp_obj_t cqueue_close(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_free(&self->ring);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(cqueue_close_obj, cqueue_close);
+
+
+/** The arguments of @c watermarks(), all of which are keywords.
+ */
+STATIC const mp_arg_t cqueue_watermarks_args[] =
+{
+    { MP_QSTR_high,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_on_high, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_low,     MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_on_low,  MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arg,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Set callbacks which are scheduled when a queue fills to a high watermark
+ *  or empties to a low one, so a consumer task can sleep until there's a
+ *  batch worth processing instead of checking @c any() on every pass. When a
+ *  put takes the number of items from below @c high to @c high or more,
+ *  @c on_high is scheduled with @c mp_sched_schedule(); when a get takes it
+ *  from above @c low to @c low or less, @c on_low is. Each callback is given
+ *  @c arg as its argument or, if that's @c None, the queue. A Python subclass
+ *  of a queue class passes itself as @c arg, as otherwise its callbacks would
+ *  get the native object inside it. Calling this with no callbacks turns
+ *  them off.
+ *  @param n_args The number of positional arguments, just the queue
+ *  @param pos_args The queue
+ *  @param kw_args Keyword arguments @c high, which defaults to the size of
+ *         the queue, @c on_high, @c low, which defaults to zero, @c on_low,
+ *         and @c arg
+ */
+STATIC mp_obj_t cqueue_watermarks(size_t n_args, const mp_obj_t *pos_args,
+                                  mp_map_t *kw_args)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_arg_val_t vals[MP_ARRAY_SIZE(cqueue_watermarks_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+                     MP_ARRAY_SIZE(cqueue_watermarks_args),
+                     cqueue_watermarks_args, vals);
+
+    if (p_ring->p_data == NULL)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Queue is closed");
+    }
+    mp_int_t high = (vals[0].u_obj == mp_const_none)
+                    ? (mp_int_t)p_ring->size : mp_obj_get_int(vals[0].u_obj);
+    mp_int_t low = vals[2].u_int;
+    if (high < 1 || high > (mp_int_t)p_ring->size || low < 0 || low >= high)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Invalid watermarks");
+    }
+    mp_obj_t on_high = vals[1].u_obj;
+    mp_obj_t on_low = vals[3].u_obj;
+    if ((on_high != mp_const_none && !mp_obj_is_callable(on_high))
+        || (on_low != mp_const_none && !mp_obj_is_callable(on_low)))
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Callback must be callable");
+    }
+    #if !MICROPY_ENABLE_SCHEDULER
+    if (on_high != mp_const_none || on_low != mp_const_none)
+    {
+        mp_raise_NotImplementedError(
+            (mp_rom_error_text_t)"Watermarks need the scheduler");
+    }
+    #endif
+
+    // An interrupt callback mustn't see a new mark with an old callback
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    p_ring->high_mark = (size_t)high;
+    p_ring->low_mark = (size_t)low;
+    p_ring->on_high = on_high;
+    p_ring->on_low = on_low;
+    p_ring->mark_arg = vals[4].u_obj;
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(cqueue_watermarks_obj, 1, cqueue_watermarks);
+
+
+/** Report how the data arena is being used, so a program can check that its
+ *  queues' data is kept out of the heap. This is @c cqueue.data_arena().
+ *  @returns A tuple @c (size, used, largest_free) of numbers of bytes,
+ *           including the small header of each block; all are zero if there's
+ *           no arena
+ */
+STATIC mp_obj_t cqueue_data_arena(void)
+{
+    size_t used = 0;
+    size_t largest_free = 0;
+    size_t size = 0;
+
+    #if CQUEUE_USE_ARENA
+    size = sizeof(cqueue_arena);
+    const cqueue_arena_block_t* p_first = (cqueue_arena_block_t*)cqueue_arena;
+    if (p_first->size == 0)
+    {
+        largest_free = size;
+    }
+    else
+    {
+        for (byte* p_at = (byte*)cqueue_arena; p_at < CQUEUE_ARENA_END; )
+        {
+            const cqueue_arena_block_t* p_block = (cqueue_arena_block_t*)p_at;
+            if (p_block->used)
+            {
+                used += p_block->size;
+            }
+            else if (p_block->size > largest_free)
+            {
+                largest_free = p_block->size;
+            }
+            p_at += p_block->size;
+        }
+    }
+    #endif
+
+    mp_obj_t values[3] =
+    {
+        mp_obj_new_int_from_uint(size),
+        mp_obj_new_int_from_uint(used),
+        mp_obj_new_int_from_uint(largest_free),
+    };
+    return mp_obj_new_tuple(3, values);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(cqueue_data_arena_obj, cqueue_data_arena);
+
+
+/** Let a queue be used by anything which takes the buffer protocol, such as
+ *  @c ulab.numpy.frombuffer() or @c array.array(). The queue's items are first
+ *  put in one block as by @c linearize(), and the buffer holds them from the
+ *  oldest to the newest.
+ *  @param self_in The queue
+ *  @param p_bufinfo A pointer to a structure which receives the buffer info
+ *  @param flags Whether the buffer is to be read or written; both are allowed
+ *  @returns Zero, meaning that a buffer is available
+ */
+STATIC mp_int_t cqueue_get_buffer_slot(mp_obj_t self_in,
+                                       mp_buffer_info_t *p_bufinfo,
+                                       mp_uint_t flags)
+{
+    (void)flags;
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+
+    size_t count = cqueue_ring_linearize(p_ring);
+    p_bufinfo->buf = p_ring->p_data;
+    if (p_ring->itemsize == mp_binary_get_size('@', p_ring->typecode, NULL))
+    {
+        p_bufinfo->typecode = p_ring->typecode;
+    }
+    else
+    {
+        p_bufinfo->typecode = 'B';
+    }
+    p_bufinfo->len = count * p_ring->itemsize;
+
+    return 0;
+}
+
+
+//=============================================================================
+
+/** This structure holds the functions which move one item of a given type
+ *  between a MicroPython object and a slot in a ring buffer. There's one of
+ *  these for each array type code, so putting and getting items never has to
+ *  look at the type code to decide what to do.
+ */
+typedef struct _cqueue_item_ops_t
+{
+    char typecode;                 // Array type code, such as 'h'
+    void (*store)(byte* p_slot, mp_obj_t item);   // Convert and write an item
+    mp_obj_t (*load)(const byte* p_slot);         // Read and convert an item
+    mp_float_t (*value)(const byte* p_slot);      // Read an item as a float
+} cqueue_item_ops_t;
+
+
+/** Get a 64-bit integer from a MicroPython object. On ports whose @c mp_int_t
+ *  has 32 bits, @c mp_obj_get_int() can't return such values, so long integers
+ *  are copied out by the same function which implements @c int.to_bytes().
+ *  @param item The object, which should be an integer
+ *  @returns The object's value, truncated to 64 bits
+ */
+STATIC long long cqueue_obj_get_ll(mp_obj_t item)
+{
+    #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+    if (mp_obj_is_int(item) && !mp_obj_is_small_int(item))
+    {
+        int64_t value;
+        mp_obj_int_to_bytes_impl(item, MP_ENDIANNESS_BIG, sizeof(value),
+                                 (byte*)&value);
+        return value;
+    }
+    #endif
+    return mp_obj_get_int(item);
+}
+
+
+/** Make a MicroPython float from a @c float item. MicroPython's floats are
+ *  @c float on some ports and @c double on others, so the conversion is made
+ *  explicit for ports which are built with @c -Wfloat-conversion.
+ *  @param value The item
+ *  @returns A new float object
+ */
+STATIC inline mp_obj_t cqueue_obj_new_float_f(float value)
+{
+    return mp_obj_new_float((mp_float_t)value);
+}
+
+
+/** Make a MicroPython float from a @c double item. Where MicroPython's floats
+ *  are @c float, precision is lost as it would be in @c array.array('d').
+ *  @param value The item
+ *  @returns A new float object
+ */
+STATIC inline mp_obj_t cqueue_obj_new_float_d(double value)
+{
+    return mp_obj_new_float((mp_float_t)value);
+}
+
+
+// This list holds every type of item which a TypedQueue can store. Each line
+// is: type code, C type, function to get a value from an object, and function
+// to make an object from a value. The macros below use the list to write one
+// set of store, load and value functions per type, then a table of all of them
+#define CQUEUE_FOR_EACH_TYPE(X) \
+    X(b, int8_t,   mp_obj_get_int,           mp_obj_new_int) \
+    X(B, uint8_t,  mp_obj_get_int,           mp_obj_new_int) \
+    X(h, int16_t,  mp_obj_get_int,           mp_obj_new_int) \
+    X(H, uint16_t, mp_obj_get_int,           mp_obj_new_int) \
+    X(i, int32_t,  mp_obj_get_int,           mp_obj_new_int) \
+    X(I, uint32_t, mp_obj_get_int_truncated, mp_obj_new_int_from_uint) \
+    X(l, long,     mp_obj_get_int,           mp_obj_new_int) \
+    X(L, unsigned long, mp_obj_get_int_truncated, mp_obj_new_int_from_uint) \
+    X(q, int64_t,  cqueue_obj_get_ll,        mp_obj_new_int_from_ll) \
+    X(Q, uint64_t, cqueue_obj_get_ll,        mp_obj_new_int_from_ull) \
+    X(f, float,    mp_obj_get_float,         cqueue_obj_new_float_f) \
+    X(d, double,   mp_obj_get_float,         cqueue_obj_new_float_d)
+
+#define CQUEUE_DEFINE_ITEM_OPS(code, ctype, from_obj, to_obj) \
+    STATIC void cqueue_store_##code(byte* p_slot, mp_obj_t item) \
+    { \
+        *(ctype*)p_slot = (ctype)from_obj(item); \
+    } \
+    STATIC mp_obj_t cqueue_load_##code(const byte* p_slot) \
+    { \
+        return to_obj(*(const ctype*)p_slot); \
+    } \
+    STATIC mp_float_t cqueue_value_##code(const byte* p_slot) \
+    { \
+        return (mp_float_t)*(const ctype*)p_slot; \
+    }
+
+CQUEUE_FOR_EACH_TYPE(CQUEUE_DEFINE_ITEM_OPS)
+
+#define CQUEUE_ITEM_OPS_ENTRY(code, ctype, from_obj, to_obj) \
+    { (#code)[0], cqueue_store_##code, cqueue_load_##code, cqueue_value_##code },
+
+/** A table of the functions used to put, get and measure each type of item.
+ */
+STATIC const cqueue_item_ops_t cqueue_item_ops[] =
+{
+    CQUEUE_FOR_EACH_TYPE(CQUEUE_ITEM_OPS_ENTRY)
+};
+
+
+/** Find the functions which store and load items with the given type code.
+ *  @param typecode An array type code such as @c 'h' or @c 'f'
+ *  @returns A pointer to the functions for that type of item
+ */
+STATIC const cqueue_item_ops_t* cqueue_item_ops_find(char typecode)
+{
+    for (size_t index = 0; index < MP_ARRAY_SIZE(cqueue_item_ops); index++)
+    {
+        if (cqueue_item_ops[index].typecode == typecode)
+        {
+            return &cqueue_item_ops[index];
+        }
+    }
+    mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+}
+
+
+//=============================================================================
+
+/** This structure holds running statistics of the values put into a queue.
+ *  The mean and variance are found with Welford's method, which adds one
+ *  value at a time without keeping the values or losing much precision.
+ */
+typedef struct _cqueue_stats_t
+{
+    size_t count;                  // Number of values measured
+    mp_float_t mean;               // Mean of the values
+    mp_float_t m2;                 // Sum of squared differences from the mean
+    mp_float_t min;                // Smallest value
+    mp_float_t max;                // Largest value
+} cqueue_stats_t;
+
+
+/** Add one value to a set of running statistics.
+ *  @param p_stats A pointer to the statistics
+ *  @param value The value to be added
+ */
+STATIC inline void cqueue_stats_add(cqueue_stats_t* p_stats, mp_float_t value)
+{
+    if (p_stats->count == 0)
+    {
+        p_stats->min = value;
+        p_stats->max = value;
+    }
+    else if (value < p_stats->min)
+    {
+        p_stats->min = value;
+    }
+    else if (value > p_stats->max)
+    {
+        p_stats->max = value;
+    }
+    p_stats->count++;
+    mp_float_t delta = value - p_stats->mean;
+    p_stats->mean += delta / (mp_float_t)p_stats->count;
+    p_stats->m2 += delta * (value - p_stats->mean);
+}
+
+
+/** This structure holds the data of the TypedQueue class and of the IntQueue,
+ *  FloatQueue, and ByteQueue classes, which are TypedQueues of a fixed type.
+ */
+typedef struct _cqueue_TypedQueue_obj_t
+{
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // Ring buffer of items
+    const cqueue_item_ops_t* p_ops; // Functions to put and get one item
+    bool keep_stats;               // True if statistics are kept of puts
+    cqueue_stats_t stats;          // Statistics of the items put
+} cqueue_TypedQueue_obj_t;
+
+
+/** The arguments accepted by the constructors of TypedQueues, after the type
+ *  code if there is one. The last one, @c stats, must stay last because
+ *  ByteQueues don't accept it.
+ */
+STATIC const mp_arg_t TypedQueue_make_new_args[] =
+{
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_stats,    MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+};
+
+
+STATIC const mp_obj_type_t cqueue_TypedQueue_type;
+
+
+/** Create a queue which holds items of the given type. This is used by the
+ *  constructors of TypedQueue and of the classes derived from it.
+ *  @param type The type of queue object being made
+ *  @param typecode The array type code of the items in the queue
+ *  @param n_args The number of positional arguments, @c size first
+ *  @param n_kw The number of keyword arguments
+ *  @param args The positional arguments followed by keyword arguments,
+ *         @c (size, *, spsc=False, overflow=None, stats=False)
+ *  @param with_stats @c true if the queue may keep statistics, so that the
+ *         @c stats keyword argument is accepted
+ *  @returns The new queue
+ */
+STATIC mp_obj_t cqueue_TypedQueue_new(const mp_obj_type_t *type, char typecode,
+                                      size_t n_args, size_t n_kw,
+                                      const mp_obj_t *args, bool with_stats)
+{
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(typecode);
+
+    size_t n_allowed = MP_ARRAY_SIZE(TypedQueue_make_new_args);
+    if (!with_stats)
+    {
+        n_allowed--;
+    }
+    mp_arg_val_t vals[MP_ARRAY_SIZE(TypedQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args, n_allowed,
+                              TypedQueue_make_new_args, vals);
+
+    cqueue_TypedQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_TypedQueue_obj_t));
+    self->base.type = type;
+    self->p_ops = p_ops;
+    self->keep_stats = with_stats && vals[4].u_bool;
+    memset(&self->stats, 0, sizeof(self->stats));
+
+    cqueue_ring_init(&self->ring, vals[0].u_int, typecode,
+                     mp_binary_get_size('@', typecode, NULL), vals[1].u_bool,
+                     vals[2].u_obj, vals[3].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** A way to print a TypedQueue or an IntQueue or FloatQueue; it's used for
+ *  debugging.
+ */
+STATIC void TypedQueue_print(const mp_print_t *print,
+                             mp_obj_t self_in,
+                             mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const mp_obj_type_t* type = mp_obj_get_type(self_in);
+    mp_print_str(print, qstr_str(type->name));
+    if (type == &cqueue_TypedQueue_type)
+    {
+        mp_printf(print, "('%c')", self->ring.typecode);
+    }
+    mp_print_str(print, "[");
+    mp_obj_print_helper(print, mp_obj_new_int(self->ring.size), PRINT_REPR);
+    mp_print_str(print, "]:");
+    for (size_t index = 0; index < self->ring.size; index++)
+    {
+        mp_obj_print_helper(print,
+            self->p_ops->load(self->ring.p_data + index * self->ring.itemsize),
+            PRINT_REPR);
+        mp_print_str(print, ",");
+    }
+    mp_print_str(print, "W:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.head)),
+        PRINT_REPR);
+    mp_print_str(print, ",R:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.tail)),
+        PRINT_REPR);
+}
+
+
+/** Set internal variables to indicate an empty queue.
+ */
+STATIC mp_obj_t TypedQueue_clear(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_clear(&self->ring);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_clear_obj, TypedQueue_clear);
+
+
+/** Create a new queue, allocating memory in which to store the data.
+ *  Preallocating the memory is important when we need to pass information from
+ *  an interrupt callback, as interrupt code isn't allowed to allocate memory.
+ *  The arguments are @c (typecode, size, *, spsc=False, overflow=None), where
+ *  @c typecode is one of the @c array module's codes @c b, @c B, @c h, @c H,
+ *  @c i, @c I, @c q, @c Q, @c f, or @c d. If keyword argument @c spsc is
+ *  @c True, the queue is safe for one producer and one consumer in different
+ *  threads or interrupts, without locking. Keyword argument @c overflow may be
+ *  @c cqueue.OVERWRITE, @c cqueue.REJECT or @c cqueue.RAISE to choose what
+ *  happens when a full queue is given another item. If @c stats is @c True,
+ *  running statistics of the items put are kept; see @c stats().
+ */
+STATIC mp_obj_t TypedQueue_make_new(const mp_obj_type_t *type,
+                                    size_t n_args,
+                                    size_t n_kw,
+                                    const mp_obj_t *args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 2, true);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(args[0], &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+
+    return cqueue_TypedQueue_new(type, p_code[0], n_args - 1, n_kw, args + 1,
+                                 true);
+}
+
+
+/** Return @c True if there are any items in the queue, @c False if it's empty.
+ */
+STATIC mp_obj_t TypedQueue_any(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_bool (cqueue_ring_count(&self->ring) > 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_any_obj, TypedQueue_any);
+
+
+/** Return @c True if the queue is full or @c False if there's still room for
+ *  more items without overwriting old ones.
+ *  @returns The Python constant @c True if the queue is full or @c False if not
+ */
+STATIC mp_obj_t TypedQueue_full(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_bool (cqueue_ring_count(&self->ring) >= self->ring.size);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_full_obj, TypedQueue_full);
+
+
+/** Put an item into the queue. If the queue is full, the oldest item is
+ *  overwritten, the new one is dropped, or @c OverflowError is raised,
+ *  according to the queue's overflow policy. The item is converted by the
+ *  store function for the queue's type, so there's no need to check the type
+ *  code each time. It's converted before a place is found for it, so an item
+ *  which can't be converted leaves the queue and its counters as they were.
+ *  @param to_put A number to be put into the queue
+ */
+STATIC mp_obj_t TypedQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    uint64_t item;
+    self->p_ops->store((byte*)&item, to_put);
+
+    byte* p_slot = cqueue_ring_put_slot(&self->ring);
+    if (p_slot != NULL)
+    {
+        memcpy(p_slot, &item, self->ring.itemsize);
+        if (self->keep_stats)
+        {
+            cqueue_stats_add(&self->stats, self->p_ops->value(p_slot));
+        }
+        cqueue_ring_put_commit(&self->ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(TypedQueue_put_obj, TypedQueue_put);
+
+
+/** Put all the items in a buffer into the queue, as does @c put_many() for
+ *  other queues. If statistics are being kept, each item is added to them as
+ *  it's converted, so they hold exactly the values which went into the queue,
+ *  after any conversion or truncation. As with @c put(), they cover items
+ *  which are overwritten, even ones which later items in the same block
+ *  overwrite before they're stored; only items which are refused are left
+ *  out.
+ *  @param self_in The queue into which items are put
+ *  @param buf_in The object holding items to be put into the queue
+ */
+STATIC mp_obj_t TypedQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->keep_stats)
+    {
+        return cqueue_put_many(self_in, buf_in);
+    }
+
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_buffer_info_t bufinfo;
+    size_t count;
+    bool same = cqueue_get_buffer(p_ring->typecode, buf_in, &bufinfo,
+                                  MP_BUFFER_READ, &count);
+    size_t first = cqueue_ring_limit_puts(p_ring, &count);
+    size_t buf_itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    for (size_t index = 0; index < count; index++)
+    {
+        const byte* p_item = (const byte*)bufinfo.buf + index * buf_itemsize;
+        uint64_t item;
+        if (same)
+        {
+            memcpy(&item, p_item, p_ring->itemsize);
+        }
+        else
+        {
+            cqueue_convert_item(p_ring->typecode, (byte*)&item,
+                                bufinfo.typecode, p_item);
+        }
+        if (index >= first)
+        {
+            byte* p_slot = cqueue_ring_put_slot(p_ring);
+            if (p_slot == NULL)
+            {
+                break;
+            }
+            memcpy(p_slot, &item, p_ring->itemsize);
+            cqueue_ring_put_commit(p_ring);
+        }
+        cqueue_stats_add(&self->stats, self->p_ops->value((const byte*)&item));
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(TypedQueue_put_many_obj, TypedQueue_put_many);
+
+
+/** Get an item from the queue.
+ *  @returns The oldest data in the queue, or @c None if the queue is empty.
+ */
+STATIC mp_obj_t TypedQueue_get(mp_obj_t self_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Make sure there's something to get
+    byte* p_slot = cqueue_ring_get_slot(&self->ring);
+    if (p_slot == NULL)
+    {
+        return mp_const_none;
+    }
+
+    // If we get here, the queue has some data in it
+    mp_obj_t to_return = self->p_ops->load(p_slot);
+    cqueue_ring_get_commit(&self->ring);
+
+    return to_return;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_get_obj, TypedQueue_get);
+
+
+/** Return the number of items in the queue.
+ *  @return The number of items available to be read from the queue
+ */
+STATIC mp_obj_t TypedQueue_available(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int (cqueue_ring_count(&self->ring));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_available_obj, TypedQueue_available);
+
+
+/** Return the maximum number of items which have been in the queue since the
+ *  queue was created or cleared.
+ *  @returns The maximum number of items which have been in the queue
+ */
+STATIC mp_obj_t TypedQueue_max_full(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int (self->ring.max_full);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_max_full_obj, TypedQueue_max_full);
+
+
+/** Return statistics of all the items put into the queue since it was created
+ *  or the statistics were reset, including items which have since been taken
+ *  out or overwritten. The queue must have been made with @c stats=True.
+ *  @returns A tuple @c (count, mean, variance, min, max), in which the
+ *           variance is that of a sample, or @c (0, None, None, None, None)
+ *           if nothing has been put
+ */
+STATIC mp_obj_t TypedQueue_stats(mp_obj_t self_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_stats_t* p_stats = &self->stats;
+
+    if (!self->keep_stats)
+    {
+        mp_raise_msg(&mp_type_RuntimeError,
+                     (mp_rom_error_text_t)"Queue doesn't keep statistics");
+    }
+
+    mp_obj_t items[5] = { mp_obj_new_int_from_uint(p_stats->count),
+                          mp_const_none, mp_const_none,
+                          mp_const_none, mp_const_none };
+    if (p_stats->count > 0)
+    {
+        mp_float_t variance = MICROPY_FLOAT_CONST(0.0);
+        if (p_stats->count > 1)
+        {
+            variance = p_stats->m2 / (mp_float_t)(p_stats->count - 1);
+        }
+        items[1] = mp_obj_new_float(p_stats->mean);
+        items[2] = mp_obj_new_float(variance);
+        items[3] = mp_obj_new_float(p_stats->min);
+        items[4] = mp_obj_new_float(p_stats->max);
+    }
+
+    return mp_obj_new_tuple(5, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_stats_obj, TypedQueue_stats);
+
+
+/** Set the queue's statistics back to those of no items. This shouldn't be
+ *  called while an interrupt callback or another thread may put items into
+ *  the queue, as an item put meanwhile could be half counted.
+ */
+STATIC mp_obj_t TypedQueue_reset_stats(mp_obj_t self_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    memset(&self->stats, 0, sizeof(self->stats));
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TypedQueue_reset_stats_obj, TypedQueue_reset_stats);
+
+
+/** A dictionary of names and functions used to register the above functions
+ *  with MicroPython. IntQueue and FloatQueue use this dictionary too.
+ */
+STATIC const mp_rom_map_elem_t TypedQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&TypedQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TypedQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&TypedQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats),     MP_ROM_PTR(&TypedQueue_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset_stats), MP_ROM_PTR(&TypedQueue_reset_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(TypedQueue_locals_dict,
+                            TypedQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.TypedQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_TypedQueue_type,
+    MP_QSTR_TypedQueue,
+    MP_TYPE_FLAG_NONE,
+    // Each of the following lines is:  slot_name, function_name,
+    print, TypedQueue_print,
+    make_new, TypedQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &TypedQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** Create a new IntQueue, which is a TypedQueue of 32-bit integers, @c 'i'.
+ *  If keyword argument @c spsc is @c True, the queue is safe for one producer
+ *  and one consumer in different threads or interrupts, without locking. If
+ *  @c stats is @c True, running statistics of the items put are kept.
+ */
+STATIC mp_obj_t IntQueue_make_new(const mp_obj_type_t *type,
+                                  size_t n_args,
+                                  size_t n_kw,
+                                  const mp_obj_t *args)
+{
+    return cqueue_TypedQueue_new(type, 'i', n_args, n_kw, args, true);
+}
+
+
+// Probably only works for MicroPython versions from late 2022 and after
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_IntQueue_type,
+    MP_QSTR_IntQueue,
+    MP_TYPE_FLAG_NONE,
+    // Each of the following lines is:  slot_name, function_name,
+    print, TypedQueue_print,
+    make_new, IntQueue_make_new,
+    parent, &cqueue_TypedQueue_type,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &TypedQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// This silliness was used when rebuilding the code after the late 2022 change
+// in the way object types are declared. It ought not be needed. Probably.
+#ifdef FLOOFY
+    // This is a function which will be called from Python, as floof(x)
+    STATIC mp_obj_t floof(mp_obj_t x_obj)
+    {
+        // Extract the integer from the MicroPython input object
+        mp_int_t x = mp_obj_get_int(x_obj);
+
+        // Multiply by 22 because it's silly
+        mp_int_t result = x * 22;
+
+        // Convert the result to a MicroPython integer object and return it
+        return mp_obj_new_int(result);
+    }
+    // Define a Python reference to the function above
+    STATIC MP_DEFINE_CONST_FUN_OBJ_1(floof_obj, floof);
+#endif
+
+//=============================================================================
+
+
+/** Create a new FloatQueue, which is a TypedQueue of single precision floating
+ *  point numbers, @c 'f'. If keyword argument @c spsc is @c True, the queue is
+ *  safe for one producer and one consumer in different threads or interrupts,
+ *  without locking. If @c stats is @c True, the count, mean, variance, minimum
+ *  and maximum of the items put are kept as they're put, so a task which only
+ *  needs averages and extremes doesn't have to get every item.
+ */
+STATIC mp_obj_t FloatQueue_make_new(const mp_obj_type_t *type,
+                                    size_t n_args,
+                                    size_t n_kw,
+                                    const mp_obj_t *args)
+{
+    return cqueue_TypedQueue_new(type, 'f', n_args, n_kw, args, true);
+}
+
+
+/** A type which contains the components of the @c cqueue.FloatQueue class in
+*  MicroPython.
+*/
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_FloatQueue_type,
+    MP_QSTR_FloatQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TypedQueue_print,
+    make_new, FloatQueue_make_new,
+    parent, &cqueue_TypedQueue_type,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &TypedQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** A way to print a ByteQueue object; it's used for debugging.
+ */
+STATIC void ByteQueue_print(const mp_print_t *print,
+                             mp_obj_t self_in,
+                             mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    byte* p_data = self->ring.p_data;
+    mp_print_str(print, "ByteQueue[");
+    mp_obj_print_helper(print, mp_obj_new_int(self->ring.size), PRINT_REPR);
+    mp_print_str(print, "]:b'");
+    for (size_t index = 0; index < self->ring.size; index++)
+    {
+        // Print characters in approximately Python string printing style
+        if (p_data[index] > 31 && p_data[index] < 127)
+        {
+            mp_printf(print, "%c", p_data[index]);
+        }
+        else
+        {
+            mp_printf(print, "\\x%02x", p_data[index]);
+        }
+    }
+    mp_print_str(print, "' W:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.head)),
+        PRINT_REPR);
+    mp_print_str(print, ", R:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.tail)),
+        PRINT_REPR);
+}
+
+
+/** Create a new ByteQueue, which is a TypedQueue of bytes, @c 'B', whose
+ *  @c put() and @c get() methods work with strings and bytes objects.
+ *  If keyword argument @c spsc is @c True, the queue is safe for one producer
+ *  and one consumer in different threads or interrupts, without locking.
+ */
+STATIC mp_obj_t ByteQueue_make_new(const mp_obj_type_t *type,
+                                   size_t n_args,
+                                   size_t n_kw,
+                                   const mp_obj_t *args)
+{
+    return cqueue_TypedQueue_new(type, 'B', n_args, n_kw, args, false);
+}
+
+
+/** Put characters into the queue. Any object with the buffer protocol, such
+ *  as a string, @c bytes, @c bytearray or @c memoryview, can be put, and its
+ *  contents are copied with at most two calls to @c memcpy(). If the queue
+ *  is full, its overflow policy decides whether old data is overwritten or
+ *  the characters which don't fit are dropped, or @c OverflowError is raised
+ *  and none of the characters are put.
+ *  @param str_obj_in The characters to be put into the queue
+ */
+STATIC mp_obj_t ByteQueue_put(mp_obj_t self_in, mp_obj_t str_obj_in)
+{
+    // Ensure that the input is a valid type (prevents crashes)
+    mp_buffer_info_t bufinfo;
+    if (!mp_get_buffer(str_obj_in, &bufinfo, MP_BUFFER_READ))
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Bytes or string required");
+    }
+
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_put_many(&self->ring, bufinfo.buf, bufinfo.len);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(ByteQueue_put_obj, ByteQueue_put);
+
+
+/** Make a @c bytes object holding up to the given number of the oldest bytes
+ *  in a queue, copied straight into the new object's memory.
+ *  @param self The ByteQueue whose bytes are copied
+ *  @param max_obj The largest number of bytes to copy, as a MicroPython int
+ *  @param remove @c true to take the bytes out of the queue, @c false to leave
+ *         them there
+ *  @returns A @c bytes object, which is empty if the queue is
+ */
+STATIC mp_obj_t ByteQueue_copy_out(cqueue_TypedQueue_obj_t* self,
+                                   mp_obj_t max_obj, bool remove)
+{
+    mp_int_t max_count = mp_obj_get_int(max_obj);
+    size_t count = cqueue_ring_count(&self->ring);
+    if (max_count < 0)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Count can't be negative");
+    }
+    if ((size_t)max_count < count)
+    {
+        count = (size_t)max_count;
+    }
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, count);
+    if (remove)
+    {
+        vstr.len = cqueue_ring_get_many(&self->ring, (byte*)vstr.buf, count);
+    }
+    else
+    {
+        vstr.len = cqueue_ring_peek_many(&self->ring, (byte*)vstr.buf, count);
+    }
+
+    return mp_obj_new_bytes_from_vstr(&vstr);
+}
+
+
+/** Get data from the queue. With no argument, one byte is taken, and @c None
+ *  is returned if the queue is empty. Given a number @c n, up to @c n bytes
+ *  are taken with at most two calls to @c memcpy(), and an empty @c bytes
+ *  object is returned if the queue is empty.
+ *  @param args The queue and, optionally, the largest number of bytes to get
+ *  @returns The oldest data in the queue, or @c None if none is present and
+ *           no count was given
+ */
+STATIC mp_obj_t ByteQueue_get(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    if (n_args > 1)
+    {
+        return ByteQueue_copy_out(self, args[1], true);
+    }
+
+    // Make sure there's something to get
+    byte* p_slot = cqueue_ring_get_slot(&self->ring);
+    if (p_slot == NULL)
+    {
+        return mp_const_none;
+    }
+
+    // If we get here, the queue has some data in it
+    byte to_return = *p_slot;
+    cqueue_ring_get_commit(&self->ring);
+
+    return mp_obj_new_bytes(&to_return, 1);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ByteQueue_get_obj, 1, 2, ByteQueue_get);
+
+
+/** Copy up to the given number of the oldest bytes in the queue without
+ *  taking them out of the queue.
+ *  @param n_obj The largest number of bytes to copy
+ *  @returns A @c bytes object, which is empty if the queue is
+ */
+STATIC mp_obj_t ByteQueue_peek(mp_obj_t self_in, mp_obj_t n_obj)
+{
+    return ByteQueue_copy_out(MP_OBJ_TO_PTR(self_in), n_obj, false);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(ByteQueue_peek_obj, ByteQueue_peek);
+
+
+/** Take bytes from the queue and write them into a @c bytearray, array or
+ *  other writable buffer, with at most two calls to @c memcpy(). As many
+ *  bytes as are in the queue and will fit are copied, or no more than
+ *  @c nbytes if that's given, as for a stream's @c readinto().
+ *  @param args The queue, the buffer, and optionally the largest number of
+ *         bytes to copy
+ *  @returns The number of bytes copied into the buffer
+ */
+STATIC mp_obj_t ByteQueue_readinto(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    size_t count = bufinfo.len;
+    if (n_args > 2)
+    {
+        mp_int_t max_count = mp_obj_get_int(args[2]);
+        if (max_count < 0)
+        {
+            mp_raise_ValueError((mp_rom_error_text_t)"Count can't be negative");
+        }
+        if ((size_t)max_count < count)
+        {
+            count = (size_t)max_count;
+        }
+    }
+
+    count = cqueue_ring_get_many(&self->ring, bufinfo.buf, count);
+
+    return mp_obj_new_int(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ByteQueue_readinto_obj, 2, 3,
+                                    ByteQueue_readinto);
+
+
+/** Read bytes from a ByteQueue used as a stream. If the queue is empty, the
+ *  stream is told to try again later, so @c read() returns @c None as a
+ *  non-blocking stream's does; a closed queue reads as the end of the stream.
+ *  @param self_in The ByteQueue from which bytes are read
+ *  @param buf Memory which receives the bytes
+ *  @param size The largest number of bytes to read
+ *  @param errcode A place to put an error code if the read fails
+ *  @returns The number of bytes read, or @c MP_STREAM_ERROR
+ */
+STATIC mp_uint_t ByteQueue_stream_read(mp_obj_t self_in, void *buf,
+                                       mp_uint_t size, int *errcode)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t count = cqueue_ring_get_many(&self->ring, buf, size);
+    if (count == 0 && size > 0 && self->ring.p_data != NULL)
+    {
+        *errcode = MP_EAGAIN;
+        return MP_STREAM_ERROR;
+    }
+    return count;
+}
+
+
+/** Write bytes into a ByteQueue used as a stream. A queue which overwrites
+ *  old data takes all the bytes; otherwise only the bytes which fit are
+ *  written, as with a non-blocking stream, rather than dropping bytes or
+ *  raising an exception.
+ *  @param self_in The ByteQueue into which bytes are written
+ *  @param buf The bytes to be written
+ *  @param size The number of bytes to be written
+ *  @param errcode A place to put an error code if the write fails
+ *  @returns The number of bytes written, or @c MP_STREAM_ERROR
+ */
+STATIC mp_uint_t ByteQueue_stream_write(mp_obj_t self_in, const void *buf,
+                                        mp_uint_t size, int *errcode)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+
+    if (p_ring->p_data == NULL)
+    {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    if (p_ring->overflow != CQUEUE_OVERWRITE)
+    {
+        size_t room = p_ring->size - cqueue_ring_count(p_ring);
+        if (room == 0 && size > 0)
+        {
+            *errcode = MP_EAGAIN;
+            return MP_STREAM_ERROR;
+        }
+        if (size > room)
+        {
+            size = room;
+        }
+    }
+    cqueue_ring_put_many(p_ring, buf, size);
+
+    return size;
+}
+
+
+/** Handle control requests for a ByteQueue used as a stream. Polling reports
+ *  that the queue can be read when it has data in it or has been closed, and
+ *  written when it has room or overwrites old data, so @c select.poll and
+ *  @c asyncio can wait on a queue instead of checking @c any() in a loop.
+ *  @param self_in The ByteQueue
+ *  @param request The request, such as @c MP_STREAM_POLL
+ *  @param arg The request's argument, such as the poll flags of interest
+ *  @param errcode A place to put an error code if the request fails
+ *  @returns The result of the request, or @c MP_STREAM_ERROR
+ */
+STATIC mp_uint_t ByteQueue_stream_ioctl(mp_obj_t self_in, mp_uint_t request,
+                                        uintptr_t arg, int *errcode)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+
+    if (request == MP_STREAM_POLL)
+    {
+        mp_uint_t ready = 0;
+        size_t count = cqueue_ring_count(p_ring);
+        if ((arg & MP_STREAM_POLL_RD) && (count > 0 || p_ring->p_data == NULL))
+        {
+            ready |= MP_STREAM_POLL_RD;
+        }
+        if ((arg & MP_STREAM_POLL_WR) && p_ring->p_data != NULL
+            && (count < p_ring->size || p_ring->overflow == CQUEUE_OVERWRITE))
+        {
+            ready |= MP_STREAM_POLL_WR;
+        }
+        return ready;
+    }
+    else if (request == MP_STREAM_FLUSH)
+    {
+        return 0;
+    }
+    else if (request == MP_STREAM_CLOSE)
+    {
+        cqueue_close(self_in);
+        return 0;
+    }
+
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+
+/** The stream protocol which lets a ByteQueue be used wherever a stream is,
+ *  for example with @c print(file=...), @c select.poll and @c asyncio.
+ */
+STATIC const mp_stream_p_t ByteQueue_stream_p =
+{
+    .read = ByteQueue_stream_read,
+    .write = ByteQueue_stream_write,
+    .ioctl = ByteQueue_stream_ioctl,
+    .is_text = false,
+};
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. The @c put() and @c get() methods
+ *  differ from those of a TypedQueue, and @c peek(), @c readinto() and the
+ *  stream methods are added.
+ */
+STATIC const mp_rom_map_elem_t ByteQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&ByteQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&ByteQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_peek),      MP_ROM_PTR(&ByteQueue_peek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto),  MP_ROM_PTR(&ByteQueue_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read),      MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline),
+                              MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write),     MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&cqueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ByteQueue_locals_dict,
+                            ByteQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.ByteQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_ByteQueue_type,
+    MP_QSTR_ByteQueue,
+    MP_TYPE_FLAG_NONE,
+    print, ByteQueue_print,
+    make_new, ByteQueue_make_new,
+    parent, &cqueue_TypedQueue_type,
+    buffer, cqueue_get_buffer_slot,
+    protocol, &ByteQueue_stream_p,
+    locals_dict, &ByteQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** A way to print a TimedQueue object; it's used for debugging. Each record is
+ *  shown as a @c (time, value) pair.
+ */
+STATIC void TimedQueue_print(const mp_print_t *print,
+                             mp_obj_t self_in,
+                             mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t value_offset = self->ring.itemsize / 2;
+    mp_printf(print, "TimedQueue('%c')[", self->ring.typecode);
+    mp_obj_print_helper(print, mp_obj_new_int(self->ring.size), PRINT_REPR);
+    mp_print_str(print, "]:");
+    for (size_t index = 0; index < self->ring.size; index++)
+    {
+        byte* p_record = self->ring.p_data + index * self->ring.itemsize;
+        mp_print_str(print, "(");
+        mp_obj_print_helper(print,
+            mp_obj_new_int_from_uint(*(mp_uint_t*)p_record), PRINT_REPR);
+        mp_print_str(print, ",");
+        mp_obj_print_helper(print, self->p_ops->load(p_record + value_offset),
+                            PRINT_REPR);
+        mp_print_str(print, "),");
+    }
+    mp_print_str(print, "W:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.head)),
+        PRINT_REPR);
+    mp_print_str(print, ",R:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.tail)),
+        PRINT_REPR);
+}
+
+
+/** The arguments accepted by the TimedQueue constructor.
+ */
+STATIC const mp_arg_t TimedQueue_make_new_args[] =
+{
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_typecode, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_QSTR(MP_QSTR_i)} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a new queue of time stamped records. Each record holds the value of
+ *  @c time.ticks_us() when it was put, as a machine word, followed by a value
+ *  of the given type. Both parts take the same number of bytes, at least the
+ *  size of a word, so that the values are aligned. The arguments are
+ *  @c (size, typecode='i', *, spsc=False, overflow=None).
+ */
+STATIC mp_obj_t TimedQueue_make_new(const mp_obj_type_t *type,
+                                    size_t n_args,
+                                    size_t n_kw,
+                                    const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(TimedQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(TimedQueue_make_new_args),
+                              TimedQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[1].u_obj, &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+
+    cqueue_TypedQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_TypedQueue_obj_t));
+    self->base.type = type;
+    self->p_ops = p_ops;
+
+    size_t half = mp_binary_get_size('@', p_code[0], NULL);
+    if (half < sizeof(mp_uint_t))
+    {
+        half = sizeof(mp_uint_t);
+    }
+    cqueue_ring_init(&self->ring, vals[0].u_int, p_code[0], 2 * half,
+                     vals[2].u_bool, vals[3].u_obj, vals[4].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Put a value into the queue along with the time at which it was put there.
+ *  If the queue is full, its overflow policy decides what happens.
+ *  @param to_put A number to be put into the queue
+ */
+STATIC mp_obj_t TimedQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    mp_uint_t now = mp_hal_ticks_us() & CQUEUE_TICKS_MASK;
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Convert the value first so that one which can't be converted doesn't
+    // take the place of the oldest record
+    uint64_t item = 0;
+    self->p_ops->store((byte*)&item, to_put);
+
+    byte* p_record = cqueue_ring_put_slot(&self->ring);
+    if (p_record != NULL)
+    {
+        *(mp_uint_t*)p_record = now;
+        memcpy(p_record + self->ring.itemsize / 2, &item,
+               self->ring.itemsize / 2);
+        cqueue_ring_put_commit(&self->ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(TimedQueue_put_obj, TimedQueue_put);
+
+
+/** Get the oldest record from the queue. This allocates a tuple; to read
+ *  records without allocating memory, use @c get_into().
+ *  @returns A tuple @c (time, value), or @c None if the queue is empty
+ */
+STATIC mp_obj_t TimedQueue_get(mp_obj_t self_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Make sure there's something to get
+    byte* p_record = cqueue_ring_get_slot(&self->ring);
+    if (p_record == NULL)
+    {
+        return mp_const_none;
+    }
+
+    // If we get here, the queue has some data in it
+    mp_obj_t items[2];
+    items[0] = mp_obj_new_int_from_uint(*(mp_uint_t*)p_record);
+    items[1] = self->p_ops->load(p_record + self->ring.itemsize / 2);
+    cqueue_ring_get_commit(&self->ring);
+
+    return mp_obj_new_tuple(2, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TimedQueue_get_obj, TimedQueue_get);
+
+
+/** Get as many records as are available, up to the length of the shorter of
+ *  two preallocated buffers, splitting each record into its time and value.
+ *  Values are copied directly if the values buffer's type matches the queue's
+ *  and times are copied directly into a buffer of unsigned machine words,
+ *  @c 'I' on 32-bit ports and @c 'Q' on 64-bit ones; otherwise each item is
+ *  converted in C. No memory is allocated.
+ *  @param self_in The queue from which records are taken
+ *  @param times_in An object supporting the buffer protocol, such as an
+ *         @c array.array of type @c 'I', which receives the times
+ *  @param values_in An object supporting the buffer protocol which receives
+ *         the values
+ *  @returns The number of records which were read
+ */
+STATIC mp_obj_t TimedQueue_get_into(mp_obj_t self_in, mp_obj_t times_in,
+                                    mp_obj_t values_in)
+{
+    cqueue_TypedQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+    size_t value_offset = p_ring->itemsize / 2;
+    size_t value_size = mp_binary_get_size('@', p_ring->typecode, NULL);
+    mp_buffer_info_t times_info;
+    mp_buffer_info_t values_info;
+    size_t times_count;
+    size_t count;
+
+    bool times_direct = cqueue_get_buffer(CQUEUE_TICKS_TYPECODE, times_in,
+                                          &times_info, MP_BUFFER_WRITE,
+                                          &times_count);
+    bool values_direct = cqueue_get_buffer(p_ring->typecode, values_in,
+                                           &values_info, MP_BUFFER_WRITE,
+                                           &count);
+    if (times_count < count)
+    {
+        count = times_count;
+    }
+    size_t times_itemsize = mp_binary_get_size('@', times_info.typecode, NULL);
+    size_t values_itemsize = mp_binary_get_size('@', values_info.typecode,
+                                                NULL);
+
+    // Take a snapshot of the write position once, then copy records and give
+    // the space back to the writer all at once
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+    size_t num_items = cqueue_ring_span(p_ring, head, tail);
+    if (count > num_items)
+    {
+        count = num_items;
+    }
+
+    size_t read_idx = cqueue_ring_index(p_ring, tail);
+    for (size_t index = 0; index < count; index++)
+    {
+        byte* p_record = p_ring->p_data + read_idx * p_ring->itemsize;
+        if (times_direct)
+        {
+            ((mp_uint_t*)times_info.buf)[index] = *(mp_uint_t*)p_record;
+        }
+        else
+        {
+            cqueue_convert_item(times_info.typecode,
+                                (byte*)times_info.buf + index * times_itemsize,
+                                CQUEUE_TICKS_TYPECODE, p_record);
+        }
+        if (values_direct)
+        {
+            memcpy((byte*)values_info.buf + index * value_size,
+                   p_record + value_offset, value_size);
+        }
+        else
+        {
+            cqueue_convert_item(values_info.typecode,
+                (byte*)values_info.buf + index * values_itemsize,
+                p_ring->typecode, p_record + value_offset);
+        }
+        if (++read_idx == p_ring->size)
+        {
+            read_idx = 0;
+        }
+    }
+
+    CQUEUE_STORE_RELEASE(&p_ring->tail, cqueue_ring_advance(p_ring, tail, count));
+    p_ring->num_gets += count;
+
+    if (p_ring->on_low != mp_const_none && count > 0)
+    {
+        size_t num_items = cqueue_ring_count(p_ring);
+        cqueue_ring_check_low(p_ring, num_items + count, num_items);
+    }
+
+    return mp_obj_new_int(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(TimedQueue_get_into_obj, TimedQueue_get_into);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. The methods which don't deal with the
+ *  contents of records are those of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t TimedQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&TimedQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TimedQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&TimedQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(TimedQueue_locals_dict,
+                            TimedQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.TimedQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_TimedQueue_type,
+    MP_QSTR_TimedQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TimedQueue_print,
+    make_new, TimedQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &TimedQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** This structure holds the data of the StructQueue class. Each item in the
+ *  ring is one record, packed as by @c struct.pack() with the queue's format.
+ */
+typedef struct _cqueue_StructQueue_obj_t
+{
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // Ring buffer of packed records
+    mp_obj_t format;               // The format string, such as '<Iffh'
+    char order;                    // Byte order character from the format
+    size_t num_fields;             // Number of values in each record
+    byte* p_scratch;               // A record being packed by put()
+} cqueue_StructQueue_obj_t;
+
+
+/** Get the fields of a record format, skipping the byte order character if
+ *  there is one.
+ *  @param format The format string, such as @c '<Iffh'
+ *  @param pp_end A pointer to a variable which receives the end of the format
+ *  @returns A pointer to the first field in the format
+ */
+STATIC const char* cqueue_struct_fields(mp_obj_t format, const char** pp_end)
+{
+    size_t len;
+    const char* p_fmt = mp_obj_str_get_data(format, &len);
+    *pp_end = p_fmt + len;
+    if (len > 0 && strchr("@=<>!", *p_fmt) != NULL)
+    {
+        p_fmt++;
+    }
+    return p_fmt;
+}
+
+
+/** Read one field from a format string: an optional repeat count followed by
+ *  a type code.
+ *  @param pp_fmt A pointer to the place in the format string, which is moved
+ *         past the field
+ *  @param p_count A pointer to a variable which receives the repeat count
+ *  @returns The type code of the field
+ */
+STATIC char cqueue_struct_next_field(const char** pp_fmt, size_t* p_count)
+{
+    const char* p_fmt = *pp_fmt;
+    size_t count = 1;
+    if (*p_fmt >= '0' && *p_fmt <= '9')
+    {
+        count = 0;
+        while (*p_fmt >= '0' && *p_fmt <= '9')
+        {
+            count = count * 10 + (*p_fmt++ - '0');
+        }
+    }
+    *p_count = count;
+    *pp_fmt = p_fmt + 1;
+    return *p_fmt;
+}
+
+
+/** Check a record format and find the size of its records as does
+ *  @c struct.calcsize(). The format may begin with a byte order character,
+ *  then has fields made of an optional repeat count and one of the type codes
+ *  @c b, @c B, @c h, @c H, @c i, @c I, @c l, @c L, @c q, @c Q, @c f, or
+ *  @c d. With native order, @c '@' or none given, fields are aligned as in C
+ *  and the size is padded so that records in an array are aligned too.
+ *  @param format The format string, such as @c '<Iffh'
+ *  @param p_order A pointer to a variable which receives the byte order
+ *  @param p_num_fields A pointer to a variable which receives the number of
+ *         values in each record
+ *  @returns The number of bytes in each record
+ */
+STATIC size_t cqueue_struct_parse(mp_obj_t format, char* p_order,
+                                  size_t* p_num_fields)
+{
+    // Find the byte order; '!' is network order, which is big endian
+    size_t len;
+    const char* p_start = mp_obj_str_get_data(format, &len);
+    char order = '@';
+    if (len > 0 && strchr("@=<>!", *p_start) != NULL)
+    {
+        order = (*p_start == '!') ? '>' : *p_start;
+    }
+
+    const char* p_end;
+    const char* p_fmt = cqueue_struct_fields(format, &p_end);
+    size_t record_size = 0;
+    size_t max_align = 1;
+    size_t num_fields = 0;
+    while (p_fmt < p_end)
+    {
+        size_t count;
+        char code = cqueue_struct_next_field(&p_fmt, &count);
+        if (p_fmt > p_end || code == '\0'
+            || strchr("bBhHiIlLqQfd", code) == NULL)
+        {
+            mp_raise_ValueError((mp_rom_error_text_t)"Bad record format");
+        }
+        size_t align;
+        size_t size = mp_binary_get_size(order, code, &align);
+        if (order == '@')
+        {
+            record_size = (record_size + align - 1) & ~(align - 1);
+            if (align > max_align)
+            {
+                max_align = align;
+            }
+        }
+        record_size += count * size;
+        num_fields += count;
+    }
+    if (num_fields == 0)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Bad record format");
+    }
+
+    *p_order = order;
+    *p_num_fields = num_fields;
+    return (record_size + max_align - 1) & ~(max_align - 1);
+}
+
+
+/** Pack values into a record as does @c struct.pack_into().
+ *  @param format The format string of the record
+ *  @param order The byte order found by @c cqueue_struct_parse()
+ *  @param p_values A pointer to as many values as the record has fields
+ *  @param p_record A pointer to the memory which receives the record
+ */
+STATIC void cqueue_struct_pack(mp_obj_t format, char order,
+                               const mp_obj_t* p_values, byte* p_record)
+{
+    byte* p_field = p_record;
+    const char* p_end;
+    const char* p_fmt = cqueue_struct_fields(format, &p_end);
+    while (p_fmt < p_end)
+    {
+        size_t count;
+        char code = cqueue_struct_next_field(&p_fmt, &count);
+        while (count--)
+        {
+            mp_binary_set_val(order, code, *p_values++, p_record, &p_field);
+        }
+    }
+}
+
+
+/** Unpack the values in a record as does @c struct.unpack_from().
+ *  @param format The format string of the record
+ *  @param order The byte order found by @c cqueue_struct_parse()
+ *  @param p_record A pointer to the record
+ *  @param p_values A pointer to places for as many values as the record has
+ *         fields
+ */
+STATIC void cqueue_struct_unpack(mp_obj_t format, char order,
+                                 const byte* p_record, mp_obj_t* p_values)
+{
+    byte* p_field = (byte*)p_record;
+    const char* p_end;
+    const char* p_fmt = cqueue_struct_fields(format, &p_end);
+    while (p_fmt < p_end)
+    {
+        size_t count;
+        char code = cqueue_struct_next_field(&p_fmt, &count);
+        while (count--)
+        {
+            *p_values++ = mp_binary_get_val(order, code, (byte*)p_record,
+                                            &p_field);
+        }
+    }
+}
+
+
+/** A way to print a StructQueue object; it's used for debugging. Each record
+ *  is shown as a tuple of its fields.
+ */
+STATIC void StructQueue_print(const mp_print_t *print,
+                              mp_obj_t self_in,
+                              mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_print_str(print, "StructQueue(");
+    mp_obj_print_helper(print, self->format, PRINT_REPR);
+    mp_print_str(print, ")[");
+    mp_obj_print_helper(print, mp_obj_new_int(self->ring.size), PRINT_REPR);
+    mp_print_str(print, "]:");
+    for (size_t index = 0; index < self->ring.size; index++)
+    {
+        byte* p_record = self->ring.p_data + index * self->ring.itemsize;
+        byte* p_field = p_record;
+        const char* p_end;
+        const char* p_fmt = cqueue_struct_fields(self->format, &p_end);
+        mp_print_str(print, "(");
+        while (p_fmt < p_end)
+        {
+            size_t count;
+            char code = cqueue_struct_next_field(&p_fmt, &count);
+            while (count--)
+            {
+                mp_obj_print_helper(print,
+                    mp_binary_get_val(self->order, code, p_record, &p_field),
+                    PRINT_REPR);
+                mp_print_str(print, ",");
+            }
+        }
+        mp_print_str(print, "),");
+    }
+    mp_print_str(print, "W:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.head)),
+        PRINT_REPR);
+    mp_print_str(print, ",R:");
+    mp_obj_print_helper(print,
+        mp_obj_new_int(cqueue_ring_index(&self->ring, self->ring.tail)),
+        PRINT_REPR);
+}
+
+
+/** Create a new queue of records, each packed according to a format string
+ *  such as those used by the @c struct module; see @c cqueue_struct_parse().
+ *  The arguments are @c (format, size, *, spsc=False, overflow=None).
+ */
+STATIC mp_obj_t StructQueue_make_new(const mp_obj_type_t *type,
+                                     size_t n_args,
+                                     size_t n_kw,
+                                     const mp_obj_t *args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 2, true);
+
+    cqueue_StructQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_StructQueue_obj_t));
+    self->base.type = type;
+    self->format = args[0];
+    size_t record_size = cqueue_struct_parse(self->format, &self->order,
+                                             &self->num_fields);
+    self->p_scratch = m_new(byte, record_size);
+
+    mp_arg_val_t vals[MP_ARRAY_SIZE(cqueue_ring_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args - 1, n_kw, args + 1,
+                              MP_ARRAY_SIZE(cqueue_ring_make_new_args),
+                              cqueue_ring_make_new_args, vals);
+    cqueue_ring_init(&self->ring, vals[0].u_int, 'B', record_size,
+                     vals[1].u_bool, vals[2].u_obj, vals[3].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Put one record into the queue. If the queue is full, its overflow policy
+ *  decides what happens. The fields are packed into a record kept for this
+ *  purpose and then copied into the queue, so no memory is allocated, and a
+ *  field which can't be packed leaves the queue as it was.
+ *  @param n_args The number of arguments, which is one more than the number
+ *         of fields because the first is the queue
+ *  @param args The queue, followed by the values of the record's fields
+ */
+STATIC mp_obj_t StructQueue_put(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args - 1 != self->num_fields)
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Wrong number of fields");
+    }
+
+    cqueue_struct_pack(self->format, self->order, args + 1, self->p_scratch);
+
+    byte* p_record = cqueue_ring_put_slot(&self->ring);
+    if (p_record != NULL)
+    {
+        memcpy(p_record, self->p_scratch, self->ring.itemsize);
+        cqueue_ring_put_commit(&self->ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR(StructQueue_put_obj, 1, StructQueue_put);
+
+
+/** Get the oldest record from the queue. This allocates a tuple; to read
+ *  records without allocating memory, use @c get_into().
+ *  @returns A tuple of the record's fields, or @c None if the queue is empty
+ */
+STATIC mp_obj_t StructQueue_get(mp_obj_t self_in)
+{
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Make sure there's something to get
+    byte* p_record = cqueue_ring_get_slot(&self->ring);
+    if (p_record == NULL)
+    {
+        return mp_const_none;
+    }
+
+    // If we get here, the queue has some data in it
+    mp_obj_t to_return = mp_obj_new_tuple(self->num_fields, NULL);
+    size_t num_items;
+    mp_obj_t* p_items;
+    mp_obj_get_array(to_return, &num_items, &p_items);
+
+    cqueue_struct_unpack(self->format, self->order, p_record, p_items);
+    cqueue_ring_get_commit(&self->ring);
+
+    return to_return;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(StructQueue_get_obj, StructQueue_get);
+
+
+/** Put packed records from a buffer into the queue, as many as there are
+ *  whole records in the buffer. The records are copied with at most two calls
+ *  to @c memcpy(). If the queue becomes full, the queue's overflow policy
+ *  decides whether the oldest records are overwritten, the records which
+ *  don't fit are dropped, or an exception is raised.
+ *  @param self_in The queue into which records are put
+ *  @param buf_in An object supporting the buffer protocol, such as a
+ *         @c bytearray, which holds records packed with the queue's format
+ */
+STATIC mp_obj_t StructQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+
+    cqueue_ring_put_many(&self->ring, bufinfo.buf,
+                         bufinfo.len / self->ring.itemsize);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(StructQueue_put_many_obj, StructQueue_put_many);
+
+
+/** Copy as many of the oldest records as will fit into a buffer, packed as
+ *  they are in the queue so they can be unpacked with @c struct.unpack_from().
+ *  A buffer the size of one record gets one record. The records are copied
+ *  with at most two calls to @c memcpy(), and no memory is allocated.
+ *  @param self_in The queue from which records are taken
+ *  @param buf_in An object supporting the buffer protocol, such as a
+ *         @c bytearray, into which records are written
+ *  @returns The number of records which were written into the buffer
+ */
+STATIC mp_obj_t StructQueue_get_into(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+
+    size_t count = cqueue_ring_get_many(&self->ring, bufinfo.buf,
+                                        bufinfo.len / self->ring.itemsize);
+
+    return mp_obj_new_int(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(StructQueue_get_into_obj, StructQueue_get_into);
+
+
+/** Return the number of bytes taken by each packed record, which is the size
+ *  of buffer needed by @c get_into() for each record.
+ *  @returns The size of a record in bytes
+ */
+STATIC mp_obj_t StructQueue_record_size(mp_obj_t self_in)
+{
+    cqueue_StructQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int(self->ring.itemsize);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(StructQueue_record_size_obj,
+                          StructQueue_record_size);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. The methods which don't deal with the
+ *  contents of records are those of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t StructQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&StructQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&StructQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&StructQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&StructQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_record_size), MP_ROM_PTR(&StructQueue_record_size_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(StructQueue_locals_dict,
+                            StructQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.StructQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_StructQueue_type,
+    MP_QSTR_StructQueue,
+    MP_TYPE_FLAG_NONE,
+    print, StructQueue_print,
+    make_new, StructQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &StructQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** This structure holds the data of the FilteredQueue class. Its first part is
+ *  a TypedQueue of floats which holds the filter's output, so the TypedQueue
+ *  methods which get items work on it unchanged.
+ */
+typedef struct _cqueue_FilteredQueue_obj_t
+{
+    cqueue_TypedQueue_obj_t queue; // Queue of filtered, decimated outputs
+    size_t num_taps;               // Number of FIR filter taps, or zero
+    mp_float_t* p_taps;            // FIR coefficients, for the newest first
+    mp_float_t* p_history;         // FIR inputs, kept twice over, end to end
+    size_t history_idx;            // Where the newest input is in the history
+    size_t num_sections;           // Number of biquad IIR sections, or zero
+    mp_float_t* p_biquads;         // b0, b1, b2, a1, a2 for each section
+    mp_float_t* p_state;           // Two state variables for each section
+    size_t decimate;               // One output is kept for this many inputs
+    size_t phase;                  // Number of inputs since an output was kept
+} cqueue_FilteredQueue_obj_t;
+
+
+/** Copy the numbers in a list, tuple, or object supporting the buffer
+ *  protocol into a newly allocated array of floats.
+ *  @param seq_in The object holding the numbers
+ *  @param p_count A pointer to a variable which receives how many there are
+ *  @returns A pointer to the new array
+ */
+STATIC mp_float_t* cqueue_new_floats(mp_obj_t seq_in, size_t* p_count)
+{
+    mp_float_t* p_floats;
+
+    if (mp_obj_is_type(seq_in, &mp_type_list)
+        || mp_obj_is_type(seq_in, &mp_type_tuple))
+    {
+        mp_obj_t* items;
+        mp_obj_get_array(seq_in, p_count, &items);
+        p_floats = m_new(mp_float_t, *p_count);
+        for (size_t index = 0; index < *p_count; index++)
+        {
+            p_floats[index] = mp_obj_get_float(items[index]);
+        }
+    }
+    else
+    {
+        mp_buffer_info_t bufinfo;
+        cqueue_get_buffer(CQUEUE_FLOAT_TYPECODE, seq_in, &bufinfo,
+                          MP_BUFFER_READ, p_count);
+        size_t itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+        p_floats = m_new(mp_float_t, *p_count);
+        for (size_t index = 0; index < *p_count; index++)
+        {
+            cqueue_convert_item(CQUEUE_FLOAT_TYPECODE, (byte*)&p_floats[index],
+                bufinfo.typecode, (const byte*)bufinfo.buf + index * itemsize);
+        }
+    }
+
+    return p_floats;
+}
+
+
+/** Run one input sample through a FilteredQueue's FIR filter, then its IIR
+ *  sections, and decide whether the result is kept or decimated away.
+ *  @param self A pointer to the queue
+ *  @param value The input sample
+ *  @param p_output A pointer to a variable which receives the filtered sample
+ *  @returns @c true if the filtered sample is to be put into the queue
+ */
+STATIC bool cqueue_filter(cqueue_FilteredQueue_obj_t* self, mp_float_t value,
+                          mp_float_t* p_output)
+{
+    size_t num_taps = self->num_taps;
+    if (num_taps > 0)
+    {
+        // The history holds each input twice, so the newest num_taps inputs
+        // are always in one block starting at the newest and going back
+        size_t idx = self->history_idx;
+        idx = (idx == 0) ? num_taps - 1 : idx - 1;
+        self->history_idx = idx;
+        mp_float_t* p_recent = self->p_history + idx;
+        p_recent[0] = value;
+        p_recent[num_taps] = value;
+
+        mp_float_t sum = MICROPY_FLOAT_CONST(0.0);
+        for (size_t tap = 0; tap < num_taps; tap++)
+        {
+            sum += self->p_taps[tap] * p_recent[tap];
+        }
+        value = sum;
+    }
+
+    // Each biquad is computed in transposed direct form II
+    mp_float_t* p_coeffs = self->p_biquads;
+    mp_float_t* p_state = self->p_state;
+    for (size_t section = 0; section < self->num_sections; section++)
+    {
+        mp_float_t out = p_coeffs[0] * value + p_state[0];
+        p_state[0] = p_coeffs[1] * value - p_coeffs[3] * out + p_state[1];
+        p_state[1] = p_coeffs[2] * value - p_coeffs[4] * out;
+        value = out;
+        p_coeffs += 5;
+        p_state += 2;
+    }
+
+    *p_output = value;
+    if (++self->phase < self->decimate)
+    {
+        return false;
+    }
+    self->phase = 0;
+    return true;
+}
+
+
+/** Put one filtered sample into a FilteredQueue's ring of outputs.
+ *  @param self A pointer to the queue
+ *  @param value The filtered sample
+ */
+STATIC inline void cqueue_filter_put(cqueue_FilteredQueue_obj_t* self,
+                                     mp_float_t value)
+{
+    byte* p_slot = cqueue_ring_put_slot(&self->queue.ring);
+    if (p_slot != NULL)
+    {
+        *(float*)p_slot = (float)value;
+        cqueue_ring_put_commit(&self->queue.ring);
+    }
+}
+
+
+/** The arguments accepted by the FilteredQueue constructor.
+ */
+STATIC const mp_arg_t FilteredQueue_make_new_args[] =
+{
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_fir,      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_iir,      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_decimate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue which filters and decimates the samples put into it and
+ *  holds the results as floats. The arguments are @c (size, *, fir=None,
+ *  iir=None, decimate=1, spsc=False, overflow=None). @c fir holds the taps of
+ *  an FIR filter, the first of which multiplies the newest sample. @c iir
+ *  holds biquad sections, six numbers each, @c b0, @c b1, @c b2, @c a0,
+ *  @c a1, @c a2, as in the flattened output of @c scipy.signal.butter() with
+ *  @c output='sos'. Samples go through the FIR filter, then the IIR sections,
+ *  and then one output of every @c decimate is kept.
+ */
+STATIC mp_obj_t FilteredQueue_make_new(const mp_obj_type_t *type,
+                                       size_t n_args,
+                                       size_t n_kw,
+                                       const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(FilteredQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(FilteredQueue_make_new_args),
+                              FilteredQueue_make_new_args, vals);
+
+    if (vals[3].u_int < 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Decimation must be positive");
+    }
+
+    cqueue_FilteredQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_FilteredQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->queue.base.type = type;
+    self->queue.p_ops = cqueue_item_ops_find('f');
+    self->decimate = (size_t)vals[3].u_int;
+
+    if (vals[1].u_obj != mp_const_none)
+    {
+        self->p_taps = cqueue_new_floats(vals[1].u_obj, &self->num_taps);
+        self->p_history = m_new0(mp_float_t, 2 * self->num_taps);
+    }
+
+    if (vals[2].u_obj != mp_const_none)
+    {
+        size_t num_coeffs;
+        mp_float_t* p_sos = cqueue_new_floats(vals[2].u_obj, &num_coeffs);
+        if (num_coeffs % 6 != 0)
+        {
+            mp_raise_ValueError(
+                (mp_rom_error_text_t)"IIR needs 6 coefficients per section");
+        }
+
+        // Divide through by a0 so that it needn't be stored or used
+        self->num_sections = num_coeffs / 6;
+        self->p_biquads = m_new(mp_float_t, 5 * self->num_sections);
+        self->p_state = m_new0(mp_float_t, 2 * self->num_sections);
+        for (size_t section = 0; section < self->num_sections; section++)
+        {
+            const mp_float_t* p_row = p_sos + 6 * section;
+            mp_float_t* p_coeffs = self->p_biquads + 5 * section;
+            if (p_row[3] == MICROPY_FLOAT_CONST(0.0))
+            {
+                mp_raise_ValueError((mp_rom_error_text_t)"IIR a0 can't be 0");
+            }
+            p_coeffs[0] = p_row[0] / p_row[3];
+            p_coeffs[1] = p_row[1] / p_row[3];
+            p_coeffs[2] = p_row[2] / p_row[3];
+            p_coeffs[3] = p_row[4] / p_row[3];
+            p_coeffs[4] = p_row[5] / p_row[3];
+        }
+        m_del(mp_float_t, p_sos, num_coeffs);
+    }
+
+    cqueue_ring_init(&self->queue.ring, vals[0].u_int, 'f', sizeof(float),
+                     vals[4].u_bool, vals[5].u_obj, vals[6].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Filter a sample and put the result into the queue if it isn't decimated
+ *  away. If the queue is full, its overflow policy decides what happens. No
+ *  memory is allocated, so this can be called in an interrupt callback.
+ *  @param to_put The sample, an integer or a float
+ */
+STATIC mp_obj_t FilteredQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_FilteredQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_float_t output;
+    if (cqueue_filter(self, mp_obj_get_float(to_put), &output))
+    {
+        cqueue_filter_put(self, output);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(FilteredQueue_put_obj, FilteredQueue_put);
+
+
+/** Filter all the samples in an object which supports the buffer protocol and
+ *  put the results which aren't decimated away into the queue. The samples
+ *  are converted in C, so no memory is allocated.
+ *  @param self_in The queue into which filtered samples are put
+ *  @param buf_in The object holding the samples
+ */
+STATIC mp_obj_t FilteredQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_FilteredQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    cqueue_get_buffer(CQUEUE_FLOAT_TYPECODE, buf_in, &bufinfo, MP_BUFFER_READ,
+                      &count);
+    size_t itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    const byte* p_src = bufinfo.buf;
+    for (size_t index = 0; index < count; index++)
+    {
+        mp_float_t value;
+        mp_float_t output;
+        cqueue_convert_item(CQUEUE_FLOAT_TYPECODE, (byte*)&value,
+                            bufinfo.typecode, p_src);
+        if (cqueue_filter(self, value, &output))
+        {
+            cqueue_filter_put(self, output);
+        }
+        p_src += itemsize;
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(FilteredQueue_put_many_obj, FilteredQueue_put_many);
+
+
+/** Empty the queue and forget the filter's past inputs, so the next sample is
+ *  filtered as if it were the first.
+ */
+STATIC mp_obj_t FilteredQueue_clear(mp_obj_t self_in)
+{
+    cqueue_FilteredQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_clear(&self->queue.ring);
+    if (self->num_taps > 0)
+    {
+        memset(self->p_history, 0, 2 * self->num_taps * sizeof(mp_float_t));
+    }
+    if (self->num_sections > 0)
+    {
+        memset(self->p_state, 0, 2 * self->num_sections * sizeof(mp_float_t));
+    }
+    self->history_idx = 0;
+    self->phase = 0;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(FilteredQueue_clear_obj, FilteredQueue_clear);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. Filtered samples are taken out with
+ *  the methods of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t FilteredQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&FilteredQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&FilteredQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TypedQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&FilteredQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(FilteredQueue_locals_dict,
+                            FilteredQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.FilteredQueue class
+ *  in MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_FilteredQueue_type,
+    MP_QSTR_FilteredQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TypedQueue_print,
+    make_new, FilteredQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &FilteredQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// Items of type 'Q' are kept in a number with their top bit flipped, which
+// gives signed numbers in the same order as the unsigned items
+#define CQUEUE_NUMBER_Q_BIAS        ((uint64_t)1 << 63)
+
+/** A value from a window, kept exactly as it was stored in the queue. Items
+ *  of integer types are kept as 64-bit integers, as a float of 32 bits can't
+ *  hold integers above 2 ** 24 exactly; floats are kept as floats.
+ */
+typedef union _cqueue_number_t
+{
+    int64_t whole;                 // The value of an integer item
+    mp_float_t real;               // The value of a float item
+} cqueue_number_t;
+
+
+/** Read an item as a number which can be compared exactly with the others.
+ *  @param typecode The array type code of the item
+ *  @param p_item A pointer to the item, as it's stored in the queue
+ *  @returns The item's value
+ */
+STATIC cqueue_number_t cqueue_number_get(char typecode, const byte* p_item)
+{
+    cqueue_number_t number;
+    if (typecode == 'f' || typecode == 'd')
+    {
+        cqueue_convert_item(CQUEUE_FLOAT_TYPECODE, (byte*)&number.real,
+                            typecode, p_item);
+    }
+    else if (typecode == 'Q')
+    {
+        number.whole = (int64_t)(*(const uint64_t*)p_item
+                                 ^ CQUEUE_NUMBER_Q_BIAS);
+    }
+    else
+    {
+        cqueue_convert_item('q', (byte*)&number.whole, typecode, p_item);
+    }
+    return number;
+}
+
+
+/** Write a number back into an item, the reverse of @c cqueue_number_get().
+ *  @param typecode The array type code of the item
+ *  @param p_item A pointer to the place where the item is written
+ *  @param number The number, which came from an item of the same type
+ */
+STATIC void cqueue_number_set(char typecode, byte* p_item,
+                              cqueue_number_t number)
+{
+    if (typecode == 'f' || typecode == 'd')
+    {
+        cqueue_convert_item(typecode, p_item, CQUEUE_FLOAT_TYPECODE,
+                            (const byte*)&number.real);
+    }
+    else if (typecode == 'Q')
+    {
+        *(uint64_t*)p_item = (uint64_t)number.whole ^ CQUEUE_NUMBER_Q_BIAS;
+    }
+    else
+    {
+        cqueue_convert_item(typecode, p_item, 'q',
+                            (const byte*)&number.whole);
+    }
+}
+
+
+/** Find out whether one number is less than another.
+ *  @param is_float @c true if the numbers are floats, @c false if integers
+ *  @param first The number on the left of the comparison
+ *  @param second The number on the right of the comparison
+ *  @returns @c true if the first number is less than the second
+ */
+STATIC inline bool cqueue_number_less(bool is_float, cqueue_number_t first,
+                                      cqueue_number_t second)
+{
+    return is_float ? (first.real < second.real)
+                    : (first.whole < second.whole);
+}
+
+
+/** Convert a whole number kept by @c cqueue_number_get() to a float, as is
+ *  needed to find means and interpolate, undoing the bias of @c 'Q' items.
+ *  @param typecode The array type code of the queue's items
+ *  @param whole The whole number
+ *  @returns The number as a float
+ */
+STATIC mp_float_t cqueue_number_whole_float(char typecode, int64_t whole)
+{
+    mp_float_t value = (mp_float_t)whole;
+    if (typecode == 'Q')
+    {
+        value += MICROPY_FLOAT_CONST(9223372036854775808.0);
+    }
+    return value;
+}
+
+
+/** Make an object from a number, an integer for integer type codes, which for
+ *  small values needs no memory to be allocated, or a float.
+ *  @param typecode The array type code of the queue's items
+ *  @param number The number
+ *  @returns A new integer or float object
+ */
+STATIC mp_obj_t cqueue_number_obj(char typecode, cqueue_number_t number)
+{
+    if (typecode == 'f' || typecode == 'd')
+    {
+        return mp_obj_new_float(number.real);
+    }
+    else if (typecode == 'Q')
+    {
+        return mp_obj_new_int_from_ull((uint64_t)number.whole
+                                       ^ CQUEUE_NUMBER_Q_BIAS);
+    }
+    return mp_obj_new_int_from_ll(number.whole);
+}
+
+
+/** One entry in a monotonic deque: a value from the window and the sequence
+ *  number of the put which brought it, so it can be dropped when it leaves
+ *  the window.
+ */
+typedef struct _cqueue_window_entry_t
+{
+    cqueue_number_t value;         // The value which was put
+    size_t seq;                    // Sequence number of the put, which wraps
+} cqueue_window_entry_t;
+
+
+/** A deque of window entries whose values only increase (for the minimum) or
+ *  only decrease (for the maximum) from front to back. The front entry is
+ *  then the minimum or maximum of the window. It is stored in a ring of as
+ *  many entries as the window has items, which is as many as it can hold.
+ */
+typedef struct _cqueue_deque_t
+{
+    cqueue_window_entry_t* p_entries; // Ring of entries
+    size_t front;                  // Index of the front entry
+    size_t count;                  // Number of entries in the deque
+} cqueue_deque_t;
+
+
+/** This structure holds the data of the WindowQueue class. Its first part is
+ *  a TypedQueue, so the methods which put and get items are shared; the rest
+ *  keeps track of the last @c window items put, whether or not they have
+ *  been taken out of the queue since.
+ */
+typedef struct _cqueue_WindowQueue_obj_t
+{
+    cqueue_TypedQueue_obj_t queue; // Queue of the items put
+    size_t window;                 // Number of items in a full window
+    bool is_float;                 // True if the items are floats
+    cqueue_number_t* p_values;     // Ring of the values in the window
+    size_t value_idx;              // Where the next value goes in the ring
+    size_t num_values;             // Number of values in the window
+    size_t seq;                    // Sequence number of the next put
+    int64_t whole_sum;             // Sum of the window's values if integers
+    mp_float_t sum;                // Sum of the window's values if floats
+    mp_float_t sum_error;          // Rounding error in the sum, to be removed
+    cqueue_deque_t min_deque;      // Increasing values; minimum at the front
+    cqueue_deque_t max_deque;      // Decreasing values; maximum at the front
+} cqueue_WindowQueue_obj_t;
+
+
+/** Add a float to a sum, keeping track of the rounding error as in Kahan
+ *  summation so that adding and removing values many times doesn't let the
+ *  sum drift away from the sum of the values in the window. Integers are
+ *  summed exactly instead, and don't need this.
+ *  @param self A pointer to the queue whose window sum is changed
+ *  @param value The value to be added, or the negative of a value to remove
+ */
+STATIC inline void cqueue_window_add(cqueue_WindowQueue_obj_t* self,
+                                     mp_float_t value)
+{
+    mp_float_t corrected = value - self->sum_error;
+    mp_float_t new_sum = self->sum + corrected;
+    self->sum_error = (new_sum - self->sum) - corrected;
+    self->sum = new_sum;
+}
+
+
+/** Put a new entry at the back of a monotonic deque, first removing entries
+ *  which have left the window from the front and entries which can never be
+ *  the minimum or maximum again from the back.
+ *  @param p_deque A pointer to the deque
+ *  @param window The number of items in the window, which is also the size of
+ *         the deque's ring
+ *  @param value The value just put
+ *  @param seq The sequence number of the put
+ *  @param keep_min @c true for the minimum deque, @c false for the maximum
+ *  @param is_float @c true if the values are floats, @c false if integers
+ */
+STATIC inline void cqueue_deque_push(cqueue_deque_t* p_deque, size_t window,
+                                     cqueue_number_t value, size_t seq,
+                                     bool keep_min, bool is_float)
+{
+    cqueue_window_entry_t* p_entries = p_deque->p_entries;
+
+    // Subtracting sequence numbers gives the right answer even after they
+    // have wrapped around
+    if (p_deque->count > 0 && seq - p_entries[p_deque->front].seq >= window)
+    {
+        if (++p_deque->front == window)
+        {
+            p_deque->front = 0;
+        }
+        p_deque->count--;
+    }
+
+    while (p_deque->count > 0)
+    {
+        size_t back = p_deque->front + p_deque->count - 1;
+        if (back >= window)
+        {
+            back -= window;
+        }
+        if (keep_min ? cqueue_number_less(is_float, p_entries[back].value,
+                                          value)
+                     : cqueue_number_less(is_float, value,
+                                          p_entries[back].value))
+        {
+            break;
+        }
+        p_deque->count--;
+    }
+
+    size_t slot = p_deque->front + p_deque->count;
+    if (slot >= window)
+    {
+        slot -= window;
+    }
+    p_entries[slot].value = value;
+    p_entries[slot].seq = seq;
+    p_deque->count++;
+}
+
+
+/** Add a value to a WindowQueue's window, pushing out the oldest one if the
+ *  window is full. This takes the same time however big the window is.
+ *  @param self A pointer to the queue
+ *  @param value The value which was put
+ */
+STATIC void cqueue_window_put(cqueue_WindowQueue_obj_t* self,
+                              cqueue_number_t value)
+{
+    size_t idx = self->value_idx;
+    bool is_float = self->is_float;
+
+    if (self->num_values == self->window)
+    {
+        if (is_float)
+        {
+            cqueue_window_add(self, -self->p_values[idx].real);
+        }
+        else
+        {
+            // Unsigned arithmetic wraps around rather than overflowing
+            self->whole_sum = (int64_t)((uint64_t)self->whole_sum
+                                        - (uint64_t)self->p_values[idx].whole);
+        }
+    }
+    else
+    {
+        self->num_values++;
+    }
+    self->p_values[idx] = value;
+    if (is_float)
+    {
+        cqueue_window_add(self, value.real);
+    }
+    else
+    {
+        self->whole_sum = (int64_t)((uint64_t)self->whole_sum
+                                    + (uint64_t)value.whole);
+    }
+    self->value_idx = (idx + 1 == self->window) ? 0 : idx + 1;
+
+    cqueue_deque_push(&self->min_deque, self->window, value, self->seq, true,
+                      is_float);
+    cqueue_deque_push(&self->max_deque, self->window, value, self->seq, false,
+                      is_float);
+    self->seq++;
+}
+
+
+/** Empty a WindowQueue's window.
+ *  @param self A pointer to the queue
+ */
+STATIC void cqueue_window_clear(cqueue_WindowQueue_obj_t* self)
+{
+    self->value_idx = 0;
+    self->num_values = 0;
+    self->whole_sum = 0;
+    self->sum = MICROPY_FLOAT_CONST(0.0);
+    self->sum_error = MICROPY_FLOAT_CONST(0.0);
+    self->min_deque.front = 0;
+    self->min_deque.count = 0;
+    self->max_deque.front = 0;
+    self->max_deque.count = 0;
+}
+
+
+/** The arguments accepted by the WindowQueue constructor.
+ */
+STATIC const mp_arg_t WindowQueue_make_new_args[] =
+{
+    { MP_QSTR_typecode, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_window,   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue which keeps the sum, minimum and maximum of the last
+ *  @c window items put into it. The arguments are @c (typecode, size, *,
+ *  window=size, spsc=False, overflow=None). The window holds the last items
+ *  put whether or not they've been taken out of the queue, so the queue can
+ *  be smaller than the window if the items are read often.
+ */
+STATIC mp_obj_t WindowQueue_make_new(const mp_obj_type_t *type,
+                                     size_t n_args,
+                                     size_t n_kw,
+                                     const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(WindowQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(WindowQueue_make_new_args),
+                              WindowQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[0].u_obj, &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+
+    mp_int_t window = vals[2].u_int;
+    if (window == 0)
+    {
+        window = vals[1].u_int;
+    }
+    if (window < 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Window size must be positive");
+    }
+
+    cqueue_WindowQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_WindowQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->queue.base.type = type;
+    self->queue.p_ops = p_ops;
+    self->window = (size_t)window;
+    self->is_float = (p_code[0] == 'f' || p_code[0] == 'd');
+    self->p_values = m_new(cqueue_number_t, self->window);
+    self->min_deque.p_entries = m_new(cqueue_window_entry_t, self->window);
+    self->max_deque.p_entries = m_new(cqueue_window_entry_t, self->window);
+    cqueue_window_clear(self);
+
+    cqueue_ring_init(&self->queue.ring, vals[1].u_int, p_code[0],
+                     mp_binary_get_size('@', p_code[0], NULL), vals[3].u_bool,
+                     vals[4].u_obj, vals[5].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Put an item into the queue and its value into the window. The item counts
+ *  in the window even if the queue is full and the overflow policy drops it.
+ *  No memory is allocated, so this can be called in an interrupt callback.
+ *  @param to_put A number to be put into the queue
+ */
+STATIC mp_obj_t WindowQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_WindowQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const cqueue_item_ops_t* p_ops = self->queue.p_ops;
+
+    // Convert the item as the queue stores it, so the window sees the same
+    // value that a get() would return
+    uint64_t item;
+    p_ops->store((byte*)&item, to_put);
+    cqueue_window_put(self, cqueue_number_get(self->queue.ring.typecode,
+                                              (const byte*)&item));
+
+    byte* p_slot = cqueue_ring_put_slot(&self->queue.ring);
+    if (p_slot != NULL)
+    {
+        memcpy(p_slot, &item, self->queue.ring.itemsize);
+        cqueue_ring_put_commit(&self->queue.ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(WindowQueue_put_obj, WindowQueue_put);
+
+
+/** Return the mean of the items in the window. The sum of integers is kept
+ *  exactly, as long as it fits in 64 bits, and it's divided in two parts so
+ *  that the only rounding is in making the float which is returned.
+ *  @returns The mean as a float, or @c None if nothing has been put
+ */
+STATIC mp_obj_t WindowQueue_window_mean(mp_obj_t self_in)
+{
+    cqueue_WindowQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_float_t count = (mp_float_t)self->num_values;
+
+    if (self->num_values == 0)
+    {
+        return mp_const_none;
+    }
+    if (self->is_float)
+    {
+        return mp_obj_new_float(self->sum / count);
+    }
+    int64_t num_values = (int64_t)self->num_values;
+    int64_t quotient = self->whole_sum / num_values;
+    int64_t remainder = self->whole_sum % num_values;
+    return mp_obj_new_float(
+        cqueue_number_whole_float(self->queue.ring.typecode, quotient)
+        + (mp_float_t)remainder / count);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(WindowQueue_window_mean_obj, WindowQueue_window_mean);
+
+
+/** Make an object of the queue's item type from the value at the front of a
+ *  monotonic deque. Integers come back as integers, which for small values
+ *  needs no memory to be allocated.
+ *  @param self A pointer to the queue
+ *  @param p_deque A pointer to the minimum or maximum deque
+ *  @returns The minimum or maximum, or @c None if nothing has been put
+ */
+STATIC mp_obj_t cqueue_window_extreme(const cqueue_WindowQueue_obj_t* self,
+                                      const cqueue_deque_t* p_deque)
+{
+    if (p_deque->count == 0)
+    {
+        return mp_const_none;
+    }
+    return cqueue_number_obj(self->queue.ring.typecode,
+                             p_deque->p_entries[p_deque->front].value);
+}
+
+
+/** Return the smallest item in the window.
+ *  @returns The minimum, or @c None if nothing has been put
+ */
+STATIC mp_obj_t WindowQueue_window_min(mp_obj_t self_in)
+{
+    cqueue_WindowQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return cqueue_window_extreme(self, &self->min_deque);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(WindowQueue_window_min_obj, WindowQueue_window_min);
+
+
+/** Return the largest item in the window.
+ *  @returns The maximum, or @c None if nothing has been put
+ */
+STATIC mp_obj_t WindowQueue_window_max(mp_obj_t self_in)
+{
+    cqueue_WindowQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return cqueue_window_extreme(self, &self->max_deque);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(WindowQueue_window_max_obj, WindowQueue_window_max);
+
+
+/** Empty both the queue and its window.
+ */
+STATIC mp_obj_t WindowQueue_clear(mp_obj_t self_in)
+{
+    cqueue_WindowQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_clear(&self->queue.ring);
+    cqueue_window_clear(self);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(WindowQueue_clear_obj, WindowQueue_clear);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. Items are taken out with the methods
+ *  of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t WindowQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&WindowQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&WindowQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TypedQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_window_mean), MP_ROM_PTR(&WindowQueue_window_mean_obj) },
+    { MP_ROM_QSTR(MP_QSTR_window_min), MP_ROM_PTR(&WindowQueue_window_min_obj) },
+    { MP_ROM_QSTR(MP_QSTR_window_max), MP_ROM_PTR(&WindowQueue_window_max_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(WindowQueue_locals_dict,
+                            WindowQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.WindowQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_WindowQueue_type,
+    MP_QSTR_WindowQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TypedQueue_print,
+    make_new, WindowQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &WindowQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// Marks the end of a list in a MedianQueue's skip list
+#define CQUEUE_SKIP_END             ((size_t)-1)
+
+/** This structure holds the data of the MedianQueue class. Its first part is
+ *  a TypedQueue. The rest is an indexable skip list which keeps the last
+ *  @c window values put in sorted order, so any order statistic can be found
+ *  in O(log N) time. There's one skip list node for each place in the window,
+ *  plus a head node; as a value leaves the window, its node is unlinked and
+ *  relinked with the new value. Each node's number of levels is chosen at
+ *  random when the queue is made and never changes, which keeps the expected
+ *  O(log N) time without allocating memory as values are put.
+ */
+typedef struct _cqueue_MedianQueue_obj_t
+{
+    cqueue_TypedQueue_obj_t queue; // Queue of items or of running medians
+    bool filter;                   // True if the queue gets running medians
+    size_t window;                 // Number of values in a full window
+    bool is_float;                 // True if the items are floats
+    size_t value_idx;              // Node which the next value will use
+    size_t num_values;             // Number of values in the window
+    size_t max_level;              // Number of levels in the head node
+    cqueue_number_t* p_values;     // Value held by each node
+    uint8_t* p_levels;             // Number of levels of each node
+    size_t* p_links;               // Where each node's links begin
+    size_t* p_next;                // Next node at each level of each node
+    size_t* p_width;               // How many places each link skips
+} cqueue_MedianQueue_obj_t;
+
+
+/** Empty a MedianQueue's skip list. The head node is the one after the last
+ *  place in the window. Links to the end are given the width they would have
+ *  if the end were a node after the last value, which lets inserting and
+ *  removing treat them as any other link.
+ *  @param self A pointer to the queue
+ */
+STATIC void cqueue_skip_clear(cqueue_MedianQueue_obj_t* self)
+{
+    size_t head = self->p_links[self->window];
+    for (size_t level = 0; level < self->max_level; level++)
+    {
+        self->p_next[head + level] = CQUEUE_SKIP_END;
+        self->p_width[head + level] = 1;
+    }
+    self->value_idx = 0;
+    self->num_values = 0;
+}
+
+
+/** Unlink a node from a MedianQueue's skip list. The node must hold the
+ *  oldest value in the window; as values equal to each other are kept
+ *  oldest first, it's the first node with its value.
+ *  @param self A pointer to the queue
+ *  @param node The node to be removed
+ */
+STATIC void cqueue_skip_remove(cqueue_MedianQueue_obj_t* self, size_t node)
+{
+    cqueue_number_t value = self->p_values[node];
+    size_t* p_next = self->p_next;
+    size_t* p_width = self->p_width;
+    size_t here = self->window;
+
+    for (size_t level = self->max_level; level-- > 0; )
+    {
+        size_t next;
+        while ((next = p_next[self->p_links[here] + level]) != CQUEUE_SKIP_END
+               && cqueue_number_less(self->is_float, self->p_values[next],
+                                     value))
+        {
+            here = next;
+        }
+        size_t link = self->p_links[here] + level;
+        if (p_next[link] == node)
+        {
+            size_t node_link = self->p_links[node] + level;
+            p_width[link] += p_width[node_link] - 1;
+            p_next[link] = p_next[node_link];
+        }
+        else
+        {
+            p_width[link]--;
+        }
+    }
+}
+
+
+/** Link a node into a MedianQueue's skip list after all the nodes whose
+ *  values are less than or equal to its value.
+ *  @param self A pointer to the queue
+ *  @param node The node to be inserted, which already holds its value
+ */
+STATIC void cqueue_skip_insert(cqueue_MedianQueue_obj_t* self, size_t node)
+{
+    cqueue_number_t value = self->p_values[node];
+    size_t* p_next = self->p_next;
+    size_t* p_width = self->p_width;
+    size_t preds[8 * sizeof(size_t)];
+    size_t ranks[8 * sizeof(size_t)];
+    size_t here = self->window;
+    size_t rank = 0;
+
+    for (size_t level = self->max_level; level-- > 0; )
+    {
+        size_t link;
+        size_t next;
+        while (link = self->p_links[here] + level,
+               (next = p_next[link]) != CQUEUE_SKIP_END
+               && !cqueue_number_less(self->is_float, value,
+                                      self->p_values[next]))
+        {
+            rank += p_width[link];
+            here = next;
+        }
+        preds[level] = here;
+        ranks[level] = rank;
+    }
+
+    // The new node's place in the sorted order, counting from one
+    rank++;
+    for (size_t level = 0; level < self->max_level; level++)
+    {
+        size_t link = self->p_links[preds[level]] + level;
+        if (level < self->p_levels[node])
+        {
+            size_t node_link = self->p_links[node] + level;
+            p_next[node_link] = p_next[link];
+            p_width[node_link] = p_width[link] - (rank - ranks[level]) + 1;
+            p_next[link] = node;
+            p_width[link] = rank - ranks[level];
+        }
+        else
+        {
+            p_width[link]++;
+        }
+    }
+}
+
+
+/** Find the value at a given place in the sorted order of the window.
+ *  @param self A pointer to the queue
+ *  @param rank The place, from 1 for the smallest value to the number of
+ *         values in the window for the largest
+ *  @returns The value at that place
+ */
+STATIC cqueue_number_t cqueue_skip_value_at(
+    const cqueue_MedianQueue_obj_t* self, size_t rank)
+{
+    size_t here = self->window;
+    size_t pos = 0;
+
+    for (size_t level = self->max_level; level-- > 0; )
+    {
+        size_t link = self->p_links[here] + level;
+        while (self->p_next[link] != CQUEUE_SKIP_END
+               && pos + self->p_width[link] <= rank)
+        {
+            pos += self->p_width[link];
+            here = self->p_next[link];
+            link = self->p_links[here] + level;
+        }
+    }
+
+    return self->p_values[here];
+}
+
+
+/** Find a percentile of the values in the window, interpolating between the
+ *  two nearest values as @c numpy.percentile() does by default. For a queue
+ *  of integers, a percentile which falls on one of the values is returned as
+ *  that integer, exactly; one between two values is a float, found from the
+ *  exact difference between them.
+ *  @param self A pointer to the queue, which must hold at least one value
+ *  @param percent The percentile, from 0 to 100
+ *  @returns The value below which the given percent of the values lie
+ */
+STATIC mp_obj_t cqueue_skip_percentile(const cqueue_MedianQueue_obj_t* self,
+                                       mp_float_t percent)
+{
+    mp_float_t place = percent / MICROPY_FLOAT_CONST(100.0)
+                       * (mp_float_t)(self->num_values - 1);
+    size_t below = (size_t)place;
+    mp_float_t fraction = place - (mp_float_t)below;
+    char typecode = self->queue.ring.typecode;
+
+    cqueue_number_t low = cqueue_skip_value_at(self, below + 1);
+    if (!(fraction > MICROPY_FLOAT_CONST(0.0)))
+    {
+        return cqueue_number_obj(typecode, low);
+    }
+    cqueue_number_t high = cqueue_skip_value_at(self, below + 2);
+    if (self->is_float)
+    {
+        return mp_obj_new_float(low.real + fraction * (high.real - low.real));
+    }
+
+    // The higher value isn't less than the lower, so unsigned subtraction
+    // gives their difference exactly
+    uint64_t spread = (uint64_t)high.whole - (uint64_t)low.whole;
+    return mp_obj_new_float(cqueue_number_whole_float(typecode, low.whole)
+                            + fraction * (mp_float_t)spread);
+}
+
+
+/** The arguments accepted by the MedianQueue constructor.
+ */
+STATIC const mp_arg_t MedianQueue_make_new_args[] =
+{
+    { MP_QSTR_typecode, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_window,   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_filter,   MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue which keeps the last @c window values put into it in sorted
+ *  order. The arguments are @c (typecode, size, *, window=size, filter=False,
+ *  spsc=False, overflow=None). If @c filter is @c True, each put puts the
+ *  running median into the queue instead of the item itself, making a median
+ *  filter.
+ */
+STATIC mp_obj_t MedianQueue_make_new(const mp_obj_type_t *type,
+                                     size_t n_args,
+                                     size_t n_kw,
+                                     const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(MedianQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(MedianQueue_make_new_args),
+                              MedianQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[0].u_obj, &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+
+    mp_int_t window = vals[2].u_int;
+    if (window == 0)
+    {
+        window = vals[1].u_int;
+    }
+    if (window < 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Window size must be positive");
+    }
+
+    cqueue_MedianQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_MedianQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->queue.base.type = type;
+    self->queue.p_ops = p_ops;
+    self->filter = vals[3].u_bool;
+    self->window = (size_t)window;
+    self->is_float = (p_code[0] == 'f' || p_code[0] == 'd');
+
+    // The head needs enough levels that the top one skips about half the
+    // values in a full window
+    self->max_level = 1;
+    while (self->max_level < 8 * sizeof(size_t) - 1
+           && ((size_t)1 << self->max_level) < self->window)
+    {
+        self->max_level++;
+    }
+
+    // Give each node a random number of levels, half as many nodes having
+    // each level as the one below, using a xorshift generator with a fixed
+    // seed; the skip list only needs the levels not to depend on the data
+    self->p_values = m_new(cqueue_number_t, self->window);
+    self->p_levels = m_new(uint8_t, self->window + 1);
+    self->p_links = m_new(size_t, self->window + 1);
+    uint32_t random = 2463534242u;
+    size_t num_links = 0;
+    for (size_t node = 0; node < self->window; node++)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        uint8_t levels = 1;
+        for (uint32_t bits = random; (bits & 1) && levels < self->max_level;
+             bits >>= 1)
+        {
+            levels++;
+        }
+        self->p_levels[node] = levels;
+        self->p_links[node] = num_links;
+        num_links += levels;
+    }
+    self->p_levels[self->window] = (uint8_t)self->max_level;
+    self->p_links[self->window] = num_links;
+    num_links += self->max_level;
+    self->p_next = m_new(size_t, num_links);
+    self->p_width = m_new(size_t, num_links);
+    cqueue_skip_clear(self);
+
+    cqueue_ring_init(&self->queue.ring, vals[1].u_int, p_code[0],
+                     mp_binary_get_size('@', p_code[0], NULL), vals[4].u_bool,
+                     vals[5].u_obj, vals[6].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Put a value into the window, and put either it or the running median into
+ *  the queue. The value counts in the window even if the queue is full and
+ *  the overflow policy drops it. No memory is allocated, so this can be
+ *  called in an interrupt callback.
+ *  @param to_put A number to be put into the queue
+ */
+STATIC mp_obj_t MedianQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_MedianQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+
+    // Convert the item as the queue stores it, so the window sees the same
+    // value that a get() would return
+    uint64_t item;
+    self->queue.p_ops->store((byte*)&item, to_put);
+    char typecode = p_ring->typecode;
+
+    size_t node = self->value_idx;
+    if (self->num_values == self->window)
+    {
+        cqueue_skip_remove(self, node);
+    }
+    else
+    {
+        self->num_values++;
+    }
+    self->p_values[node] = cqueue_number_get(typecode, (const byte*)&item);
+    cqueue_skip_insert(self, node);
+    self->value_idx = (node + 1 == self->window) ? 0 : node + 1;
+
+    if (self->filter)
+    {
+        // A median filter puts out one of the values, the lower of the two
+        // middle ones if there are an even number, so integers stay integers
+        cqueue_number_set(typecode, (byte*)&item,
+            cqueue_skip_value_at(self, (self->num_values + 1) / 2));
+    }
+
+    byte* p_slot = cqueue_ring_put_slot(p_ring);
+    if (p_slot != NULL)
+    {
+        memcpy(p_slot, &item, p_ring->itemsize);
+        cqueue_ring_put_commit(p_ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(MedianQueue_put_obj, MedianQueue_put);
+
+
+/** Return the median of the values in the window. If there are an even
+ *  number, it's the mean of the two middle values.
+ *  @returns The median, which for integer type codes is an integer if it's
+ *           one of the values and a float otherwise, or @c None if nothing
+ *           has been put
+ */
+STATIC mp_obj_t MedianQueue_median(mp_obj_t self_in)
+{
+    cqueue_MedianQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->num_values == 0)
+    {
+        return mp_const_none;
+    }
+    return cqueue_skip_percentile(self, MICROPY_FLOAT_CONST(50.0));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(MedianQueue_median_obj, MedianQueue_median);
+
+
+/** Return a percentile of the values in the window.
+ *  @param percent_in The percentile, from 0 for the minimum to 100 for the
+ *         maximum
+ *  @returns The percentile, which for integer type codes is an integer if
+ *           it's one of the values and a float otherwise, or @c None if
+ *           nothing has been put
+ */
+STATIC mp_obj_t MedianQueue_percentile(mp_obj_t self_in, mp_obj_t percent_in)
+{
+    cqueue_MedianQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_float_t percent = mp_obj_get_float(percent_in);
+    if (!(percent >= MICROPY_FLOAT_CONST(0.0)
+          && percent <= MICROPY_FLOAT_CONST(100.0)))
+    {
+        mp_raise_ValueError(
+            (mp_rom_error_text_t)"Percentile must be from 0 to 100");
+    }
+    if (self->num_values == 0)
+    {
+        return mp_const_none;
+    }
+    return cqueue_skip_percentile(self, percent);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(MedianQueue_percentile_obj, MedianQueue_percentile);
+
+
+/** Empty both the queue and its window.
+ */
+STATIC mp_obj_t MedianQueue_clear(mp_obj_t self_in)
+{
+    cqueue_MedianQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_clear(&self->queue.ring);
+    cqueue_skip_clear(self);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(MedianQueue_clear_obj, MedianQueue_clear);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. Items are taken out with the methods
+ *  of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t MedianQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&MedianQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&MedianQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TypedQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_median),    MP_ROM_PTR(&MedianQueue_median_obj) },
+    { MP_ROM_QSTR(MP_QSTR_percentile), MP_ROM_PTR(&MedianQueue_percentile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(MedianQueue_locals_dict,
+                            MedianQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.MedianQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_MedianQueue_type,
+    MP_QSTR_MedianQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TypedQueue_print,
+    make_new, MedianQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &MedianQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// The most bytes a PackedIntQueue record can take: 33 bits, 7 in each byte
+#define CQUEUE_PACKED_MAX_RECORD    5
+
+/** This structure holds the data of the PackedIntQueue class. Its ring holds
+ *  bytes rather than items. Each 32-bit integer is stored as a varint record,
+ *  seven bits to a byte with the high bit set in all but the last byte. A
+ *  record's lowest bit is set if it's a keyframe, which holds the zigzag
+ *  encoded value itself; other records hold the zigzag encoded difference
+ *  from the item before. Slowly changing values such as encoder counts then
+ *  take one byte each instead of four. Keyframes are written every
+ *  @c keyframe items and whenever the queue is empty, so that when the oldest
+ *  items are overwritten, whole groups starting at a keyframe are dropped and
+ *  the reader can always decode the item at the tail.
+ */
+typedef struct _cqueue_PackedIntQueue_obj_t
+{
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // Ring of bytes holding the records
+    size_t keyframe;               // Most items between one keyframe and next
+    size_t since_key;              // Items written since the last keyframe
+    size_t num_in;                 // Items written, changed only by writer
+    size_t num_out;                // Items read or overwritten
+    int32_t last_put;              // Value of the newest item written
+    int32_t last_got;              // Value of the newest item read
+} cqueue_PackedIntQueue_obj_t;
+
+
+/** Find the number of items in a PackedIntQueue.
+ *  @param self A pointer to the queue
+ *  @returns The number of items available to be read
+ */
+STATIC inline size_t cqueue_packed_count(const cqueue_PackedIntQueue_obj_t* self)
+{
+    return CQUEUE_LOAD_ACQUIRE(&self->num_in)
+           - CQUEUE_LOAD_ACQUIRE(&self->num_out);
+}
+
+
+/** Encode a value as a PackedIntQueue record.
+ *  @param self A pointer to the queue
+ *  @param value The value to be encoded
+ *  @param key @c true for a keyframe holding the value itself, @c false for
+ *         a record holding the difference from the newest item written
+ *  @param p_record A pointer to @c CQUEUE_PACKED_MAX_RECORD bytes which
+ *         receive the record
+ *  @returns The number of bytes in the record
+ */
+STATIC size_t cqueue_packed_encode(const cqueue_PackedIntQueue_obj_t* self,
+                                   int32_t value, bool key, byte* p_record)
+{
+    // Differences wrap around just as the counters which make them do
+    int32_t number = key ? value
+                     : (int32_t)((uint32_t)value - (uint32_t)self->last_put);
+    uint32_t zigzag = ((uint32_t)number << 1) ^ (uint32_t)(number >> 31);
+    uint64_t code = ((uint64_t)zigzag << 1) | (key ? 1 : 0);
+
+    size_t length = 0;
+    while (code >= 0x80)
+    {
+        p_record[length++] = (byte)(code | 0x80);
+        code >>= 7;
+    }
+    p_record[length++] = (byte)code;
+    return length;
+}
+
+
+/** Decode the record at a position in a PackedIntQueue's ring.
+ *  @param self A pointer to the queue
+ *  @param pos The position of the record, which must be before the head
+ *  @param p_code A pointer to a variable which receives the record's code,
+ *         whose lowest bit is set for a keyframe
+ *  @returns The position of the next record
+ */
+STATIC size_t cqueue_packed_decode(const cqueue_PackedIntQueue_obj_t* self,
+                                   size_t pos, uint64_t* p_code)
+{
+    const cqueue_ring_t* p_ring = &self->ring;
+    uint64_t code = 0;
+    unsigned int shift = 0;
+    byte data;
+    do
+    {
+        data = p_ring->p_data[cqueue_ring_index(p_ring, pos)];
+        pos = cqueue_ring_advance(p_ring, pos, 1);
+        code |= (uint64_t)(data & 0x7F) << shift;
+        shift += 7;
+    }
+    while ((data & 0x80) && shift < 7 * CQUEUE_PACKED_MAX_RECORD);
+
+    *p_code = code;
+    return pos;
+}
+
+
+/** Find the value of an item from its record's code and the item before it.
+ *  @param code The code decoded from the record
+ *  @param previous The value of the item before, unused for a keyframe
+ *  @returns The item's value
+ */
+STATIC inline int32_t cqueue_packed_value(uint64_t code, int32_t previous)
+{
+    uint32_t zigzag = (uint32_t)(code >> 1);
+    int32_t number = (int32_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+    if (code & 1)
+    {
+        return number;
+    }
+    return (int32_t)((uint32_t)previous + (uint32_t)number);
+}
+
+
+/** Put a value into a PackedIntQueue. If there isn't room, the queue's
+ *  overflow policy decides whether the oldest group of items, from the tail to
+ *  the next keyframe, is overwritten as often as needed, the new item is
+ *  dropped, or an exception is raised.
+ *  @param self A pointer to the queue
+ *  @param value The value to be put
+ */
+STATIC void cqueue_packed_put(cqueue_PackedIntQueue_obj_t* self, int32_t value)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    byte record[CQUEUE_PACKED_MAX_RECORD];
+    size_t before = cqueue_packed_count(self);
+    bool key = (before == 0) || (self->since_key >= self->keyframe);
+    size_t length = cqueue_packed_encode(self, value, key, record);
+
+    size_t head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&p_ring->tail);
+    while (p_ring->size - cqueue_ring_span(p_ring, head, tail) < length)
+    {
+        if (p_ring->overflow != CQUEUE_OVERWRITE)
+        {
+            p_ring->num_drops++;
+            if (p_ring->overflow == CQUEUE_RAISE)
+            {
+                cqueue_ring_raise_full(p_ring);
+            }
+            return;
+        }
+
+        // Drop the oldest record and any which depend on it, stopping at the
+        // next keyframe so the reader can start there
+        uint64_t code;
+        size_t dropped = 0;
+        do
+        {
+            tail = cqueue_packed_decode(self, tail, &code);
+            dropped++;
+        }
+        while (tail != head
+               && !(p_ring->p_data[cqueue_ring_index(p_ring, tail)] & 1));
+        CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+        CQUEUE_STORE_RELEASE(&self->num_out, self->num_out + dropped);
+        p_ring->num_overwrites += dropped;
+
+        // With nothing left to be the difference from, make a keyframe
+        if (tail == head && !key)
+        {
+            key = true;
+            length = cqueue_packed_encode(self, value, key, record);
+        }
+    }
+
+    for (size_t index = 0; index < length; index++)
+    {
+        p_ring->p_data[cqueue_ring_index(p_ring, head)] = record[index];
+        head = cqueue_ring_advance(p_ring, head, 1);
+    }
+    CQUEUE_STORE_RELEASE(&p_ring->head, head);
+    CQUEUE_STORE_RELEASE(&self->num_in, self->num_in + 1);
+
+    self->last_put = value;
+    self->since_key = key ? 1 : self->since_key + 1;
+    p_ring->num_puts++;
+    size_t num_items = cqueue_packed_count(self);
+    if (num_items > p_ring->max_full)
+    {
+        p_ring->max_full = num_items;
+    }
+    if (p_ring->on_high != mp_const_none)
+    {
+        cqueue_ring_check_high(p_ring, before, num_items);
+    }
+}
+
+
+/** Take the oldest value out of a PackedIntQueue.
+ *  @param self A pointer to the queue
+ *  @param p_value A pointer to a variable which receives the value
+ *  @returns @c true if a value was taken, or @c false if the queue is empty
+ */
+STATIC bool cqueue_packed_get(cqueue_PackedIntQueue_obj_t* self,
+                              int32_t* p_value)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    size_t before = cqueue_packed_count(self);
+    if (before == 0)
+    {
+        return false;
+    }
+
+    uint64_t code;
+    tail = cqueue_packed_decode(self, tail, &code);
+    self->last_got = cqueue_packed_value(code, self->last_got);
+    *p_value = self->last_got;
+
+    CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    CQUEUE_STORE_RELEASE(&self->num_out, self->num_out + 1);
+    p_ring->num_gets++;
+    if (p_ring->on_low != mp_const_none)
+    {
+        cqueue_ring_check_low(p_ring, before, before - 1);
+    }
+    return true;
+}
+
+
+/** The arguments accepted by the PackedIntQueue constructor.
+ */
+STATIC const mp_arg_t PackedIntQueue_make_new_args[] =
+{
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_keyframe, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 32} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue of 32-bit integers which are packed as differences into a
+ *  ring of bytes. The arguments are @c (size, *, keyframe=32, spsc=False,
+ *  overflow=None), where @c size is the number of bytes in the ring, not the
+ *  number of items; a ring of @c N bytes holds between @c N/5 and @c N items.
+ */
+STATIC mp_obj_t PackedIntQueue_make_new(const mp_obj_type_t *type,
+                                        size_t n_args,
+                                        size_t n_kw,
+                                        const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(PackedIntQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(PackedIntQueue_make_new_args),
+                              PackedIntQueue_make_new_args, vals);
+
+    if (vals[0].u_int < CQUEUE_PACKED_MAX_RECORD)
+    {
+        mp_raise_ValueError(
+            (mp_rom_error_text_t)"Queue size must be at least 5 bytes");
+    }
+    if (vals[1].u_int < 1)
+    {
+        mp_raise_ValueError(
+            (mp_rom_error_text_t)"Keyframe interval must be positive");
+    }
+
+    cqueue_PackedIntQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_PackedIntQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->base.type = type;
+    self->keyframe = (size_t)vals[1].u_int;
+    cqueue_ring_init(&self->ring, vals[0].u_int, 'B', 1, vals[2].u_bool,
+                     vals[3].u_obj, vals[4].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Print a PackedIntQueue's size and how full it is. The items aren't shown,
+ *  as they can only be decoded in order from the oldest.
+ */
+STATIC void PackedIntQueue_print(const mp_print_t *print,
+                                 mp_obj_t self_in,
+                                 mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "PackedIntQueue[%u]: %u items in %u bytes",
+              (unsigned int)self->ring.size,
+              (unsigned int)cqueue_packed_count(self),
+              (unsigned int)cqueue_ring_count(&self->ring));
+}
+
+
+/** Put an integer into the queue. It's kept as a 32-bit integer, as in an
+ *  IntQueue. No memory is allocated, so this can be called in an interrupt
+ *  callback.
+ *  @param to_put The integer to be put into the queue
+ */
+STATIC mp_obj_t PackedIntQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    int32_t value;
+    cqueue_store_i((byte*)&value, to_put);
+    cqueue_packed_put(self, value);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(PackedIntQueue_put_obj, PackedIntQueue_put);
+
+
+/** Put all the integers in an object which supports the buffer protocol, such
+ *  as an @c array.array, into the queue.
+ *  @param buf_in The object holding integers to be put into the queue
+ */
+STATIC mp_obj_t PackedIntQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    cqueue_get_buffer('i', buf_in, &bufinfo, MP_BUFFER_READ, &count);
+    size_t itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    const byte* p_src = bufinfo.buf;
+    for (size_t index = 0; index < count; index++, p_src += itemsize)
+    {
+        int32_t value;
+        cqueue_convert_item('i', (byte*)&value, bufinfo.typecode, p_src);
+        cqueue_packed_put(self, value);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(PackedIntQueue_put_many_obj, PackedIntQueue_put_many);
+
+
+/** Take the oldest integer out of the queue.
+ *  @returns The integer, or @c None if the queue is empty
+ */
+STATIC mp_obj_t PackedIntQueue_get(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    int32_t value;
+    if (!cqueue_packed_get(self, &value))
+    {
+        return mp_const_none;
+    }
+    return cqueue_load_i((const byte*)&value);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_get_obj, PackedIntQueue_get);
+
+
+/** Take integers out of the queue and decode them into an object which
+ *  supports the buffer protocol, such as an @c array.array, converting them
+ *  to its type in C so that no memory is allocated.
+ *  @param buf_in The object which receives the integers
+ *  @returns The number of integers taken, which is the smaller of the
+ *           buffer's length and the number in the queue
+ */
+STATIC mp_obj_t PackedIntQueue_get_into(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    cqueue_get_buffer('i', buf_in, &bufinfo, MP_BUFFER_WRITE, &count);
+    size_t itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    byte* p_dest = bufinfo.buf;
+    size_t num_got = 0;
+    int32_t value;
+    while (num_got < count && cqueue_packed_get(self, &value))
+    {
+        cqueue_convert_item(bufinfo.typecode, p_dest, 'i', (const byte*)&value);
+        p_dest += itemsize;
+        num_got++;
+    }
+
+    return MP_OBJ_NEW_SMALL_INT(num_got);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(PackedIntQueue_get_into_obj, PackedIntQueue_get_into);
+
+
+/** Check whether the queue has any integers in it.
+ *  @returns @c True if there's something to get
+ */
+STATIC mp_obj_t PackedIntQueue_any(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_bool(cqueue_packed_count(self) != 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_any_obj, PackedIntQueue_any);
+
+
+/** Check whether the queue might not have room for another integer. As items
+ *  take different numbers of bytes, this is true when fewer bytes are free
+ *  than the largest record needs.
+ *  @returns @c True if the next item put may not fit without overflowing
+ */
+STATIC mp_obj_t PackedIntQueue_full(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_bool(self->ring.size - cqueue_ring_count(&self->ring)
+                           < CQUEUE_PACKED_MAX_RECORD);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_full_obj, PackedIntQueue_full);
+
+
+/** Return the number of integers in the queue.
+ *  @returns The number of integers available to be read
+ */
+STATIC mp_obj_t PackedIntQueue_available(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int_from_uint(cqueue_packed_count(self));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_available_obj,
+                          PackedIntQueue_available);
+
+
+/** Return the number of bytes used by the integers in the queue, so the
+ *  compression can be checked against the four bytes each takes in an
+ *  IntQueue.
+ *  @returns The number of bytes in use
+ */
+STATIC mp_obj_t PackedIntQueue_bytes_used(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int_from_uint(cqueue_ring_count(&self->ring));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_bytes_used_obj,
+                          PackedIntQueue_bytes_used);
+
+
+/** Empty the queue. The next integer put will be a keyframe.
+ */
+STATIC mp_obj_t PackedIntQueue_clear(mp_obj_t self_in)
+{
+    cqueue_PackedIntQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_ring_clear(&self->ring);
+    self->num_in = 0;
+    self->num_out = 0;
+    self->since_key = 0;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(PackedIntQueue_clear_obj, PackedIntQueue_clear);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython.
+ */
+STATIC const mp_rom_map_elem_t PackedIntQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),      MP_ROM_PTR(&PackedIntQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),        MP_ROM_PTR(&PackedIntQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),       MP_ROM_PTR(&PackedIntQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),        MP_ROM_PTR(&PackedIntQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),   MP_ROM_PTR(&PackedIntQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),        MP_ROM_PTR(&PackedIntQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),   MP_ROM_PTR(&PackedIntQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),   MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available),  MP_ROM_PTR(&PackedIntQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bytes_used), MP_ROM_PTR(&PackedIntQueue_bytes_used_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),   MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),      MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),    MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(PackedIntQueue_locals_dict,
+                            PackedIntQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.PackedIntQueue class
+ *  in MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_PackedIntQueue_type,
+    MP_QSTR_PackedIntQueue,
+    MP_TYPE_FLAG_NONE,
+    print, PackedIntQueue_print,
+    make_new, PackedIntQueue_make_new,
+    locals_dict, &PackedIntQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// The formats in which a CompactQueue stores its numbers
+#define CQUEUE_Q15                  0
+#define CQUEUE_Q31                  1
+#define CQUEUE_F16                  2
+
+/** This structure holds the data of the CompactQueue class. Its first part is
+ *  a TypedQueue of the raw stored numbers, @c 'h' for Q15, @c 'i' for Q31,
+ *  and @c 'H' holding the bits of IEEE half precision floats, so that views,
+ *  linearizing and the buffer protocol give the packed data. Numbers are
+ *  converted to and from floats in C as they're put and taken out.
+ */
+typedef struct _cqueue_CompactQueue_obj_t
+{
+    cqueue_TypedQueue_obj_t queue; // Queue of raw stored numbers
+    uint8_t format;                // CQUEUE_Q15, CQUEUE_Q31 or CQUEUE_F16
+    bool saturate;                 // True to clip values which are too big
+    mp_float_t scale;              // Value represented by full scale
+    mp_float_t to_raw;             // Factor from values to stored numbers
+    mp_float_t from_raw;           // Factor from stored numbers to values
+} cqueue_CompactQueue_obj_t;
+
+
+/** Convert a single precision float to the bits of a half precision float,
+ *  rounding to the nearest value and to even on ties. Values too big for a
+ *  half become infinite.
+ *  @param value The number to be converted
+ *  @returns The bits of the half precision number
+ */
+STATIC uint16_t cqueue_float_to_half(float value)
+{
+    union { float f; uint32_t u; } bits = { .f = value };
+    uint32_t sign = (bits.u >> 16) & 0x8000;
+    uint32_t magnitude = bits.u & 0x7FFFFFFF;
+
+    if (magnitude >= 0x47800000)
+    {
+        // Too big for a half, infinite, or not a number
+        return (uint16_t)(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+    }
+    if (magnitude < 0x38800000)
+    {
+        // Too small for a normal half; halves below 2 ** -14 are subnormal,
+        // holding multiples of 2 ** -24
+        if (magnitude < 0x33000000)
+        {
+            return (uint16_t)sign;
+        }
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x007FFFFF) | 0x00800000;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midway = 1u << (shift - 1);
+        if (rest > midway || (rest == midway && (half & 1)))
+        {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    // Rebias the exponent from 127 to 15 and round away the mantissa's low
+    // bits; a carry into the exponent gives the right result
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+
+/** Convert the bits of a half precision float to a single precision float.
+ *  @param half The bits of the half precision number
+ *  @returns The number as a float
+ */
+STATIC float cqueue_half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x03FF;
+    union { float f; uint32_t u; } bits;
+
+    if (exponent == 0)
+    {
+        // Zero or subnormal, a multiple of 2 ** -24
+        float value = (float)mantissa * 5.9604644775390625e-8f;
+        return sign ? -value : value;
+    }
+    if (exponent == 0x1F)
+    {
+        bits.u = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    return bits.f;
+}
+
+
+/** Convert a value to the number stored in a CompactQueue. A value beyond the
+ *  range of the format is clipped to the nearest end of the range if the
+ *  queue saturates; otherwise an @c OverflowError is raised.
+ *  @param self A pointer to the queue
+ *  @param value The value to be stored
+ *  @param p_raw A pointer to the place where the stored number is written
+ */
+STATIC void cqueue_compact_encode(const cqueue_CompactQueue_obj_t* self,
+                                  mp_float_t value, byte* p_raw)
+{
+    mp_float_t raw = value * self->to_raw;
+    mp_float_t high;
+    switch (self->format)
+    {
+        case CQUEUE_Q15: high = MICROPY_FLOAT_CONST(32767.0);      break;
+        case CQUEUE_Q31: high = MICROPY_FLOAT_CONST(2147483647.0); break;
+        default:         high = MICROPY_FLOAT_CONST(65504.0);      break;
+    }
+    mp_float_t low = (self->format == CQUEUE_F16)
+                     ? -high : -high - MICROPY_FLOAT_CONST(1.0);
+
+    // A value which isn't a number fails both comparisons; half precision
+    // floats can hold it, but fixed point numbers can't
+    if (!(raw >= low && raw <= high))
+    {
+        bool not_number = (raw != raw);
+        if (not_number ? self->format != CQUEUE_F16 : !self->saturate)
+        {
+            mp_raise_msg(&mp_type_OverflowError,
+                         (mp_rom_error_text_t)"Value out of range");
+        }
+        if (raw > high)
+        {
+            raw = high;
+        }
+        else if (raw < low)
+        {
+            raw = low;
+        }
+    }
+
+    if (self->format == CQUEUE_F16)
+    {
+        *(uint16_t*)p_raw = cqueue_float_to_half((float)raw);
+        return;
+    }
+
+    // Round to the nearest integer; a float can't hold 2 ** 31 - 1 exactly,
+    // so the result is clipped again as an integer
+    int64_t whole = (int64_t)(raw < 0 ? raw - MICROPY_FLOAT_CONST(0.5)
+                                      : raw + MICROPY_FLOAT_CONST(0.5));
+    if (self->format == CQUEUE_Q15)
+    {
+        *(int16_t*)p_raw = (int16_t)(whole > INT16_MAX ? INT16_MAX
+                                     : whole < INT16_MIN ? INT16_MIN : whole);
+    }
+    else
+    {
+        *(int32_t*)p_raw = (int32_t)(whole > INT32_MAX ? INT32_MAX
+                                     : whole < INT32_MIN ? INT32_MIN : whole);
+    }
+}
+
+
+/** Convert a number stored in a CompactQueue back to its value.
+ *  @param self A pointer to the queue
+ *  @param p_raw A pointer to the stored number
+ *  @returns The value
+ */
+STATIC mp_float_t cqueue_compact_decode(const cqueue_CompactQueue_obj_t* self,
+                                        const byte* p_raw)
+{
+    mp_float_t raw;
+    switch (self->format)
+    {
+        case CQUEUE_Q15:
+            raw = (mp_float_t)*(const int16_t*)p_raw;
+            break;
+        case CQUEUE_Q31:
+            raw = (mp_float_t)*(const int32_t*)p_raw;
+            break;
+        default:
+            raw = (mp_float_t)cqueue_half_to_float(*(const uint16_t*)p_raw);
+            break;
+    }
+    return raw * self->from_raw;
+}
+
+
+/** The arguments accepted by the CompactQueue constructor.
+ */
+STATIC const mp_arg_t CompactQueue_make_new_args[] =
+{
+    { MP_QSTR_format,   MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,     MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_scale,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_saturate, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    { MP_QSTR_spsc,     MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue which stores floats in a compact format. The arguments are
+ *  @c (format, size, *, scale=1.0, saturate=True, spsc=False, overflow=None).
+ *  The format is @c 'q15' or @c 'q31' for fixed point numbers which hold
+ *  values from @c -scale up to just under @c scale, or @c 'f16' for half
+ *  precision floats, which hold values up to 65504 times @c scale.
+ */
+STATIC mp_obj_t CompactQueue_make_new(const mp_obj_type_t *type,
+                                      size_t n_args,
+                                      size_t n_kw,
+                                      const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(CompactQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(CompactQueue_make_new_args),
+                              CompactQueue_make_new_args, vals);
+
+    size_t format_len;
+    const char* p_format = mp_obj_str_get_data(vals[0].u_obj, &format_len);
+    uint8_t format;
+    char typecode;
+    mp_float_t full_scale;
+    if (format_len == 3 && memcmp(p_format, "q15", 3) == 0)
+    {
+        format = CQUEUE_Q15;
+        typecode = 'h';
+        full_scale = MICROPY_FLOAT_CONST(32768.0);
+    }
+    else if (format_len == 3 && memcmp(p_format, "q31", 3) == 0)
+    {
+        format = CQUEUE_Q31;
+        typecode = 'i';
+        full_scale = MICROPY_FLOAT_CONST(2147483648.0);
+    }
+    else if (format_len == 3 && memcmp(p_format, "f16", 3) == 0)
+    {
+        format = CQUEUE_F16;
+        typecode = 'H';
+        full_scale = MICROPY_FLOAT_CONST(1.0);
+    }
+    else
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported format");
+    }
+
+    mp_float_t scale = MICROPY_FLOAT_CONST(1.0);
+    if (vals[2].u_obj != mp_const_none)
+    {
+        scale = mp_obj_get_float(vals[2].u_obj);
+    }
+    if (!(scale > MICROPY_FLOAT_CONST(0.0)))
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Scale must be positive");
+    }
+
+    cqueue_CompactQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_CompactQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->queue.base.type = type;
+    self->queue.p_ops = cqueue_item_ops_find(typecode);
+    self->format = format;
+    self->saturate = vals[3].u_bool;
+    self->scale = scale;
+    self->to_raw = full_scale / scale;
+    self->from_raw = scale / full_scale;
+
+    cqueue_ring_init(&self->queue.ring, vals[1].u_int, typecode,
+                     mp_binary_get_size('@', typecode, NULL), vals[4].u_bool,
+                     vals[5].u_obj, vals[6].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Print a CompactQueue's format, size, and the values in its array, in the
+ *  order in which they're stored.
+ */
+STATIC void CompactQueue_print(const mp_print_t *print,
+                               mp_obj_t self_in,
+                               mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const cqueue_ring_t* p_ring = &self->queue.ring;
+    static const char* const format_names[] = { "q15", "q31", "f16" };
+
+    mp_printf(print, "CompactQueue('%s')[", format_names[self->format]);
+    mp_obj_print_helper(print, mp_obj_new_int(p_ring->size), PRINT_REPR);
+    mp_print_str(print, "]:");
+    for (size_t index = 0; index < p_ring->size; index++)
+    {
+        mp_obj_print_helper(print,
+            mp_obj_new_float(cqueue_compact_decode(self,
+                p_ring->p_data + index * p_ring->itemsize)),
+            PRINT_REPR);
+        mp_print_str(print, ",");
+    }
+}
+
+
+/** Put a value into the queue, converting it to the queue's format. No memory
+ *  is allocated, so this can be called in an interrupt callback.
+ *  @param to_put A number to be put into the queue
+ */
+STATIC mp_obj_t CompactQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+
+    // Convert first, so a value out of range doesn't take a place
+    uint32_t raw;
+    cqueue_compact_encode(self, mp_obj_get_float(to_put), (byte*)&raw);
+
+    byte* p_slot = cqueue_ring_put_slot(p_ring);
+    if (p_slot != NULL)
+    {
+        memcpy(p_slot, &raw, p_ring->itemsize);
+        cqueue_ring_put_commit(p_ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(CompactQueue_put_obj, CompactQueue_put);
+
+
+/** Put all the numbers in an object which supports the buffer protocol into
+ *  the queue. Floats are converted to the queue's format; integers of the
+ *  same size as the stored numbers are taken to be in packed form already,
+ *  such as data saved from @c linearize(), and are copied.
+ *  @param buf_in The object holding the numbers to be put into the queue
+ */
+STATIC mp_obj_t CompactQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    if (cqueue_get_buffer(p_ring->typecode, buf_in, &bufinfo, MP_BUFFER_READ,
+                          &count))
+    {
+        cqueue_ring_put_many(p_ring, bufinfo.buf, count);
+        return mp_const_none;
+    }
+    if (bufinfo.typecode != 'f' && bufinfo.typecode != 'd')
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Unsupported buffer type");
+    }
+
+    // Apply the overflow policy to the whole block first, as is done when
+    // copying, so that all or none of it is refused
+    size_t room = p_ring->size - cqueue_ring_count(p_ring);
+    if (count > room && p_ring->overflow == CQUEUE_RAISE)
+    {
+        p_ring->num_drops += count;
+        cqueue_ring_raise_full(p_ring);
+    }
+    else if (count > room && p_ring->overflow == CQUEUE_REJECT)
+    {
+        p_ring->num_drops += count - room;
+        count = room;
+    }
+
+    for (size_t index = 0; index < count; index++)
+    {
+        mp_float_t value = (bufinfo.typecode == 'f')
+            ? (mp_float_t)((const float*)bufinfo.buf)[index]
+            : (mp_float_t)((const double*)bufinfo.buf)[index];
+        uint32_t raw;
+        cqueue_compact_encode(self, value, (byte*)&raw);
+        byte* p_slot = cqueue_ring_put_slot(p_ring);
+        if (p_slot == NULL)
+        {
+            break;
+        }
+        memcpy(p_slot, &raw, p_ring->itemsize);
+        cqueue_ring_put_commit(p_ring);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(CompactQueue_put_many_obj, CompactQueue_put_many);
+
+
+/** Take the oldest value out of the queue.
+ *  @returns The value as a float, or @c None if the queue is empty
+ */
+STATIC mp_obj_t CompactQueue_get(mp_obj_t self_in)
+{
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    byte* p_slot = cqueue_ring_get_slot(&self->queue.ring);
+    if (p_slot == NULL)
+    {
+        return mp_const_none;
+    }
+    mp_float_t value = cqueue_compact_decode(self, p_slot);
+    cqueue_ring_get_commit(&self->queue.ring);
+
+    return mp_obj_new_float(value);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(CompactQueue_get_obj, CompactQueue_get);
+
+
+/** Take values out of the queue into an object which supports the buffer
+ *  protocol. An array of floats receives the values; an array of integers the
+ *  same size as the stored numbers receives them in packed form, copied with
+ *  at most two @c memcpy() calls. As with other queues, if an index is given,
+ *  only one item is taken and written at that index. No memory is allocated.
+ *  @param n_args The number of arguments, two or three
+ *  @param args The queue, the object into whose buffer the items are written,
+ *         and optionally the index at which to write one item
+ *  @returns The number of items which were written into the buffer
+ */
+STATIC mp_obj_t CompactQueue_get_into(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+    mp_buffer_info_t bufinfo;
+    size_t count;
+
+    if (cqueue_get_buffer(p_ring->typecode, args[1], &bufinfo,
+                          MP_BUFFER_WRITE, &count))
+    {
+        return cqueue_get_into(n_args, args);
+    }
+    if (bufinfo.typecode != 'f' && bufinfo.typecode != 'd')
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Unsupported buffer type");
+    }
+
+    size_t first = 0;
+    if (n_args > 2)
+    {
+        mp_int_t index = mp_obj_get_int(args[2]);
+        if (index < 0)
+        {
+            index += count;
+        }
+        if (index < 0 || (size_t)index >= count)
+        {
+            mp_raise_msg(&mp_type_IndexError,
+                         (mp_rom_error_text_t)"Index out of range");
+        }
+        first = (size_t)index;
+        count = first + 1;
+    }
+
+    size_t index = first;
+    byte* p_slot;
+    while (index < count && (p_slot = cqueue_ring_get_slot(p_ring)) != NULL)
+    {
+        mp_float_t value = cqueue_compact_decode(self, p_slot);
+        if (bufinfo.typecode == 'f')
+        {
+            ((float*)bufinfo.buf)[index] = (float)value;
+        }
+        else
+        {
+            ((double*)bufinfo.buf)[index] = (double)value;
+        }
+        cqueue_ring_get_commit(p_ring);
+        index++;
+    }
+
+    return mp_obj_new_int(index - first);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(CompactQueue_get_into_obj, 2, 3,
+                                    CompactQueue_get_into);
+
+
+/** Return the value represented by a stored number of full scale, and the
+ *  smallest step between values, so data exported in packed form can be
+ *  converted elsewhere.
+ *  @returns A tuple @c (scale, step)
+ */
+STATIC mp_obj_t CompactQueue_scale(mp_obj_t self_in)
+{
+    cqueue_CompactQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_obj_t items[2] =
+    {
+        mp_obj_new_float(self->scale),
+        mp_obj_new_float(self->format == CQUEUE_F16 ? self->scale
+                         * MICROPY_FLOAT_CONST(5.9604644775390625e-8)
+                         : self->from_raw),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(CompactQueue_scale_obj, CompactQueue_scale);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. Views and linearizing give the data
+ *  in packed form.
+ */
+STATIC const mp_rom_map_elem_t CompactQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&CompactQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&CompactQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&CompactQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&CompactQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_views),     MP_ROM_PTR(&cqueue_views_obj) },
+    { MP_ROM_QSTR(MP_QSTR_linearize), MP_ROM_PTR(&cqueue_linearize_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scale),     MP_ROM_PTR(&CompactQueue_scale_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(CompactQueue_locals_dict,
+                            CompactQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.CompactQueue class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_CompactQueue_type,
+    MP_QSTR_CompactQueue,
+    MP_TYPE_FLAG_NONE,
+    print, CompactQueue_print,
+    make_new, CompactQueue_make_new,
+    buffer, cqueue_get_buffer_slot,
+    locals_dict, &CompactQueue_locals_dict
+);
+
+
+//=============================================================================
+
+// The largest record a Share can hold, so that records can be copied into
+// fixed-size buffers on the stack rather than variable-length arrays
+#define CQUEUE_SHARE_MAX_RECORD     256
+
+/** This structure holds the data of the Share class, a single value or record
+ *  shared between an interrupt callback or thread and a task. It's protected
+ *  by a sequence lock with two copies of the data, as in Linux's latched
+ *  sequence counters. The writer makes the sequence number odd, so readers use
+ *  the second copy while it writes the first, then even, so readers use the
+ *  first while it writes the second. A reader checks that the sequence number
+ *  didn't change while it copied the data, and if it did, tries again. The
+ *  writer never waits, and as a reader always has a copy which isn't being
+ *  written, a reader in an interrupt callback which interrupts the writer
+ *  doesn't have to wait either. Interrupts are never disabled.
+ */
+typedef struct _cqueue_Share_obj_t
+{
+    mp_obj_base_t base;
+    mp_obj_t format;               // The format string, such as 'f' or '<hhf'
+    char order;                    // Byte order character from the format
+    size_t num_fields;             // Number of values in the record
+    size_t record_size;            // Number of bytes in the record
+    size_t sequence;               // Twice the number of puts, plus one while
+                                   // a put is between its two copies
+    byte* p_copies[2];             // The two copies of the record
+} cqueue_Share_obj_t;
+
+
+/** Write a packed record into a Share.
+ *  @param self A pointer to the share
+ *  @param p_record A pointer to the packed record
+ */
+STATIC void cqueue_share_write(cqueue_Share_obj_t* self, const byte* p_record)
+{
+    size_t sequence = CQUEUE_LOAD_RELAXED(&self->sequence);
+
+    // Send readers to the second copy, making sure they can see the change
+    // before the first copy starts to change
+    CQUEUE_STORE_RELEASE(&self->sequence, sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(self->p_copies[0], p_record, self->record_size);
+
+    // Send readers back to the first copy, then bring the second up to date
+    CQUEUE_STORE_RELEASE(&self->sequence, sequence + 2);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(self->p_copies[1], p_record, self->record_size);
+}
+
+
+/** Read a consistent copy of the record in a Share.
+ *  @param self A pointer to the share
+ *  @param p_record A pointer to memory which receives the record
+ *  @returns The sequence number of the record which was read
+ */
+STATIC size_t cqueue_share_read(const cqueue_Share_obj_t* self, byte* p_record)
+{
+    size_t sequence;
+    do
+    {
+        sequence = CQUEUE_LOAD_ACQUIRE(&self->sequence);
+        memcpy(p_record, self->p_copies[sequence & 1], self->record_size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while (CQUEUE_LOAD_RELAXED(&self->sequence) != sequence);
+
+    return sequence;
+}
+
+
+/** Make a share's version, the number of puts, from its sequence number. It's
+ *  kept to the positive small integers so reading it allocates no memory.
+ *  @param sequence The sequence number
+ *  @returns The version as a small integer
+ */
+STATIC inline mp_obj_t cqueue_share_version(size_t sequence)
+{
+    return MP_OBJ_NEW_SMALL_INT((sequence >> 1) & MP_SMALL_INT_POSITIVE_MASK);
+}
+
+
+/** Create a shared value or record. The only argument is a format string
+ *  such as those used by the @c struct module; see @c cqueue_struct_parse().
+ *  If it has one field, such as @c 'f', the share holds a single value;
+ *  otherwise @c put() and @c get() work with all the fields at once. The
+ *  share starts out holding zeros, at version 0.
+ */
+STATIC mp_obj_t Share_make_new(const mp_obj_type_t *type,
+                               size_t n_args,
+                               size_t n_kw,
+                               const mp_obj_t *args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+
+    cqueue_Share_obj_t *self = m_new_obj(cqueue_Share_obj_t);
+    self->base.type = type;
+    self->format = args[0];
+    self->record_size = cqueue_struct_parse(self->format, &self->order,
+                                            &self->num_fields);
+    if (self->record_size > CQUEUE_SHARE_MAX_RECORD)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Record too big for a Share");
+    }
+    self->sequence = 0;
+    self->p_copies[0] = m_new0(byte, 2 * self->record_size);
+    self->p_copies[1] = self->p_copies[0] + self->record_size;
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Unpack a record read from a Share into a value, or a tuple if the share
+ *  has more than one field.
+ *  @param self A pointer to the share
+ *  @param p_record A pointer to the record
+ *  @returns The value or tuple of values
+ */
+STATIC mp_obj_t cqueue_share_unpack(const cqueue_Share_obj_t* self,
+                                    const byte* p_record)
+{
+    if (self->num_fields == 1)
+    {
+        mp_obj_t value;
+        cqueue_struct_unpack(self->format, self->order, p_record, &value);
+        return value;
+    }
+    mp_obj_t to_return = mp_obj_new_tuple(self->num_fields, NULL);
+    size_t num_items;
+    mp_obj_t* p_items;
+    mp_obj_get_array(to_return, &num_items, &p_items);
+    cqueue_struct_unpack(self->format, self->order, p_record, p_items);
+    return to_return;
+}
+
+
+/** A way to print a Share object; it shows the format and current value.
+ */
+STATIC void Share_print(const mp_print_t *print,
+                        mp_obj_t self_in,
+                        mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    byte record[CQUEUE_SHARE_MAX_RECORD];
+    cqueue_share_read(self, record);
+
+    mp_print_str(print, "Share(");
+    mp_obj_print_helper(print, self->format, PRINT_REPR);
+    mp_print_str(print, "):");
+    mp_obj_print_helper(print, cqueue_share_unpack(self, record), PRINT_REPR);
+}
+
+
+/** Put a value or record into the share. The values are packed before the
+ *  lock is taken, so a value of the wrong type raises an exception without
+ *  changing the share. No memory is allocated and interrupts aren't
+ *  disabled, so this can be called from an interrupt callback.
+ *  @param n_args The number of arguments, which is one more than the number
+ *         of fields because the first is the share
+ *  @param args The share, followed by the values of the record's fields
+ */
+STATIC mp_obj_t Share_put(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args - 1 != self->num_fields)
+    {
+        mp_raise_TypeError((mp_rom_error_text_t)"Wrong number of fields");
+    }
+
+    byte record[CQUEUE_SHARE_MAX_RECORD];
+    memset(record, 0, self->record_size);
+    cqueue_struct_pack(self->format, self->order, args + 1, record);
+    cqueue_share_write(self, record);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR(Share_put_obj, 2, Share_put);
+
+
+/** Get the value or record in the share. Reading a float or a record makes a
+ *  new object; to read without allocating memory, use @c get_into().
+ *  @returns The value, or a tuple of the values if the share has more than
+ *           one field
+ */
+STATIC mp_obj_t Share_get(mp_obj_t self_in)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    byte record[CQUEUE_SHARE_MAX_RECORD];
+    cqueue_share_read(self, record);
+    return cqueue_share_unpack(self, record);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(Share_get_obj, Share_get);
+
+
+/** Copy the packed record in the share into an object which supports the
+ *  buffer protocol, such as a @c bytearray of @c record_size() bytes or an
+ *  @c array.array of one item of the share's type. No memory is allocated.
+ *  @param buf_in The object which receives the record
+ *  @returns The version of the record which was copied
+ */
+STATIC mp_obj_t Share_get_into(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < self->record_size)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Buffer too small");
+    }
+    return cqueue_share_version(cqueue_share_read(self, bufinfo.buf));
+}
+MP_DEFINE_CONST_FUN_OBJ_2(Share_get_into_obj, Share_get_into);
+
+
+/** Return the number of times a value has been put into the share. A reader
+ *  which saves the version can check it first, which is quicker than reading
+ *  the value, and skip values it has already seen. Versions wrap around to
+ *  zero when they become too big for a small integer.
+ *  @returns The version, which changes with every @c put()
+ */
+STATIC mp_obj_t Share_version(mp_obj_t self_in)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return cqueue_share_version(CQUEUE_LOAD_ACQUIRE(&self->sequence));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(Share_version_obj, Share_version);
+
+
+/** Get the value in the share only if it has been put since a given version.
+ *  @param version_in A version returned by @c version() or @c get_new()
+ *  @returns A tuple @c (version, value) if there's a newer value, or @c None
+ *           if not, so nothing is allocated when there's nothing new
+ */
+STATIC mp_obj_t Share_get_new(mp_obj_t self_in, mp_obj_t version_in)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_obj_t version = cqueue_share_version(
+        CQUEUE_LOAD_ACQUIRE(&self->sequence));
+    if (MP_OBJ_SMALL_INT_VALUE(version) == mp_obj_get_int(version_in))
+    {
+        return mp_const_none;
+    }
+
+    byte record[CQUEUE_SHARE_MAX_RECORD];
+    size_t sequence = cqueue_share_read(self, record);
+    mp_obj_t items[2] =
+    {
+        cqueue_share_version(sequence),
+        cqueue_share_unpack(self, record),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(Share_get_new_obj, Share_get_new);
+
+
+/** Return the number of bytes in the share's packed record.
+ *  @returns The size of a record as would be found by @c struct.calcsize()
+ */
+STATIC mp_obj_t Share_record_size(mp_obj_t self_in)
+{
+    cqueue_Share_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_int(self->record_size);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(Share_record_size_obj, Share_record_size);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython.
+ */
+STATIC const mp_rom_map_elem_t Share_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_put),         MP_ROM_PTR(&Share_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),         MP_ROM_PTR(&Share_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),    MP_ROM_PTR(&Share_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_new),     MP_ROM_PTR(&Share_get_new_obj) },
+    { MP_ROM_QSTR(MP_QSTR_version),     MP_ROM_PTR(&Share_version_obj) },
+    { MP_ROM_QSTR(MP_QSTR_record_size), MP_ROM_PTR(&Share_record_size_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(Share_locals_dict, Share_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.Share class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_Share_type,
+    MP_QSTR_Share,
+    MP_TYPE_FLAG_NONE,
+    print, Share_print,
+    make_new, Share_make_new,
+    locals_dict, &Share_locals_dict
+);
+
+
+//=============================================================================
+
+/** This structure holds the data of the TaskQueue class, a C version of
+ *  @c task_share.Queue. Its first part is a TypedQueue, so items can also be
+ *  moved with the methods of other queues.
+ */
+typedef struct _cqueue_TaskQueue_obj_t
+{
+    cqueue_TypedQueue_obj_t queue; // Queue of items
+    bool thread_protect;           // True to disable interrupts in tasks
+    bool overwrite;                // True to overwrite old data when full
+    mp_obj_t name;                 // Name shown by diagnostic printouts
+} cqueue_TaskQueue_obj_t;
+
+
+/** Wait while a TaskQueue is full or empty, as @c task_share.Queue does.
+ *  Pending events such as scheduled callbacks and keyboard interrupts are
+ *  handled while waiting, except in an interrupt callback, where they can't
+ *  be.
+ *  @param p_ring A pointer to the queue's ring buffer
+ *  @param for_room @c true to wait for room to put an item, @c false to wait
+ *         for an item to get
+ *  @param in_isr @c true if called from an interrupt callback
+ */
+STATIC void cqueue_task_wait(const cqueue_ring_t* p_ring, bool for_room,
+                             bool in_isr)
+{
+    while (for_room ? cqueue_ring_count(p_ring) >= p_ring->size
+                    : cqueue_ring_count(p_ring) == 0)
+    {
+        if (p_ring->p_data == NULL)
+        {
+            cqueue_ring_raise_full(p_ring);
+        }
+        if (!in_isr)
+        {
+            MICROPY_EVENT_POLL_HOOK
+        }
+    }
+}
+
+
+/** The arguments accepted by the TaskQueue constructor, the same as those of
+ *  @c task_share.Queue.
+ */
+STATIC const mp_arg_t TaskQueue_make_new_args[] =
+{
+    { MP_QSTR_type_code,      MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,           MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_thread_protect, MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_overwrite,      MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_name,           MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_arena,          MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a queue which can replace a @c task_share.Queue. The arguments are
+ *  @c (type_code, size, thread_protect=False, overwrite=False, name=None).
+ *  Adding the queue to @c task_share.share_list is left to
+ *  @c task_share.Queue, which is a subclass of this one.
+ */
+STATIC mp_obj_t TaskQueue_make_new(const mp_obj_type_t *type,
+                                   size_t n_args,
+                                   size_t n_kw,
+                                   const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(TaskQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(TaskQueue_make_new_args),
+                              TaskQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[0].u_obj, &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+
+    cqueue_TaskQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_TaskQueue_obj_t));
+    memset(self, 0, sizeof(*self));
+    self->queue.base.type = type;
+    self->queue.p_ops = p_ops;
+    self->thread_protect = vals[2].u_bool;
+    self->overwrite = vals[3].u_bool;
+    self->name = (vals[4].u_obj == mp_const_none)
+                 ? MP_OBJ_NEW_QSTR(MP_QSTR_Queue)
+                 : mp_obj_str_make_new(&mp_type_str, 1, 0, &vals[4].u_obj);
+
+    cqueue_ring_init(&self->queue.ring, vals[1].u_int, p_code[0],
+                     mp_binary_get_size('@', p_code[0], NULL), false,
+                     MP_OBJ_NEW_SMALL_INT(self->overwrite ? CQUEUE_OVERWRITE
+                                                          : CQUEUE_REJECT),
+                     vals[5].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Print a line of diagnostic information about the queue in the same form
+ *  as @c task_share.Queue: its name, type, and how full it has been.
+ */
+STATIC void TaskQueue_print(const mp_print_t *print,
+                            mp_obj_t self_in,
+                            mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_TaskQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const char* p_type;
+    switch (self->queue.ring.typecode)
+    {
+        case 'b': p_type = "int8";    break;
+        case 'B': p_type = "uint8";   break;
+        case 'h': p_type = "int16";   break;
+        case 'H': p_type = "uint16";  break;
+        case 'i': p_type = "int(?)";  break;
+        case 'I': p_type = "uint(?)"; break;
+        case 'l': p_type = "int32";   break;
+        case 'L': p_type = "uint32";  break;
+        case 'q': p_type = "int64";   break;
+        case 'Q': p_type = "uint64";  break;
+        case 'f': p_type = "float";   break;
+        default:  p_type = "double";  break;
+    }
+    mp_printf(print, "%-12s Queue<%s> Max Full %u/%u",
+              mp_obj_str_get_str(self->name), p_type,
+              (unsigned int)self->queue.ring.max_full,
+              (unsigned int)self->queue.ring.size);
+}
+
+
+/** The arguments of @c put() after the item.
+ */
+STATIC const mp_arg_t TaskQueue_put_args[] =
+{
+    { MP_QSTR_item,   MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_in_ISR, MP_ARG_BOOL, {.u_bool = false} },
+};
+
+
+/** Put an item into the queue. As with @c task_share.Queue, if the queue is
+ *  full, an interrupt callback drops the item, and a task waits for room
+ *  unless the queue was made to overwrite old data. If @c thread_protect was
+ *  set, interrupts are disabled in a task just while the item is copied in.
+ *  No memory is allocated.
+ *  @param n_args The number of positional arguments, including the queue
+ *  @param pos_args The queue, the item, and optionally @c in_ISR
+ *  @param kw_args Keyword arguments, which may include @c in_ISR
+ */
+STATIC mp_obj_t TaskQueue_put(size_t n_args, const mp_obj_t *pos_args,
+                              mp_map_t *kw_args)
+{
+    cqueue_TaskQueue_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+    mp_arg_val_t vals[MP_ARRAY_SIZE(TaskQueue_put_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+                     MP_ARRAY_SIZE(TaskQueue_put_args), TaskQueue_put_args,
+                     vals);
+    bool in_isr = vals[1].u_bool;
+
+    // Convert the item before disabling interrupts, as it might not convert
+    uint64_t item;
+    self->queue.p_ops->store((byte*)&item, vals[0].u_obj);
+
+    if (cqueue_ring_count(p_ring) >= p_ring->size)
+    {
+        if (in_isr)
+        {
+            p_ring->num_drops++;
+            return mp_const_none;
+        }
+        if (!self->overwrite)
+        {
+            cqueue_task_wait(p_ring, true, in_isr);
+        }
+    }
+
+    mp_uint_t irq_state = 0;
+    bool protect = self->thread_protect && !in_isr;
+    if (protect)
+    {
+        irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    }
+    byte* p_slot = cqueue_ring_put_slot(p_ring);
+    if (p_slot != NULL)
+    {
+        memcpy(p_slot, &item, p_ring->itemsize);
+        cqueue_ring_put_commit(p_ring);
+    }
+    if (protect)
+    {
+        MICROPY_END_ATOMIC_SECTION(irq_state);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(TaskQueue_put_obj, 2, TaskQueue_put);
+
+
+/** The arguments of @c get().
+ */
+STATIC const mp_arg_t TaskQueue_get_args[] =
+{
+    { MP_QSTR_in_ISR, MP_ARG_BOOL, {.u_bool = false} },
+};
+
+
+/** Take the oldest item out of the queue, waiting for one if the queue is
+ *  empty, as @c task_share.Queue does. If @c thread_protect was set,
+ *  interrupts are disabled in a task just while the item is copied out.
+ *  @param n_args The number of positional arguments, including the queue
+ *  @param pos_args The queue and optionally @c in_ISR
+ *  @param kw_args Keyword arguments, which may include @c in_ISR
+ *  @returns The item
+ */
+STATIC mp_obj_t TaskQueue_get(size_t n_args, const mp_obj_t *pos_args,
+                              mp_map_t *kw_args)
+{
+    cqueue_TaskQueue_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    cqueue_ring_t* p_ring = &self->queue.ring;
+    mp_arg_val_t vals[MP_ARRAY_SIZE(TaskQueue_get_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+                     MP_ARRAY_SIZE(TaskQueue_get_args), TaskQueue_get_args,
+                     vals);
+    bool in_isr = vals[0].u_bool;
+
+    // Copy the item out with interrupts disabled, then make an object of it
+    // after they're enabled again, as that might allocate memory. If another
+    // task took the item first, wait for the next one
+    uint64_t item;
+    bool protect = self->thread_protect && !in_isr;
+    byte* p_slot;
+    do
+    {
+        cqueue_task_wait(p_ring, false, in_isr);
+        mp_uint_t irq_state = 0;
+        if (protect)
+        {
+            irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        }
+        p_slot = cqueue_ring_get_slot(p_ring);
+        if (p_slot != NULL)
+        {
+            memcpy(&item, p_slot, p_ring->itemsize);
+            cqueue_ring_get_commit(p_ring);
+        }
+        if (protect)
+        {
+            MICROPY_END_ATOMIC_SECTION(irq_state);
+        }
+    }
+    while (p_slot == NULL);
+
+    return self->queue.p_ops->load((byte*)&item);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(TaskQueue_get_obj, 1, TaskQueue_get);
+
+
+/** Check whether the queue is empty.
+ *  @returns @c True if there are no items in the queue
+ */
+STATIC mp_obj_t TaskQueue_empty(mp_obj_t self_in)
+{
+    cqueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    return mp_obj_new_bool(cqueue_ring_count(&self->ring) == 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(TaskQueue_empty_obj, TaskQueue_empty);
+
+
+/** A dictionary of names and functions which is used to register functions so
+ *  they can be called from MicroPython. The names and behavior match those of
+ *  @c task_share.Queue; the other methods are those of a TypedQueue.
+ */
+STATIC const mp_rom_map_elem_t TaskQueue_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&TaskQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&TaskQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&TypedQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_empty),     MP_ROM_PTR(&TaskQueue_empty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&TypedQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_num_in),    MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&TypedQueue_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&cqueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&cqueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&TypedQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&TypedQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_watermarks), MP_ROM_PTR(&cqueue_watermarks_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(TaskQueue_locals_dict, TaskQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.TaskQueue class in
+ *  MicroPython. Python classes may inherit from it, as @c task_share.Queue
+ *  does.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_TaskQueue_type,
+    MP_QSTR_TaskQueue,
+    MP_TYPE_FLAG_NONE,
+    print, TaskQueue_print,
+    make_new, TaskQueue_make_new,
+    locals_dict, &TaskQueue_locals_dict
+);
+
+
+//=============================================================================
+
+/** Create an arena from which queues can take their data. The argument is
+ *  the number of bytes; the memory for them comes from the data arena if
+ *  there's room there, or else from the heap, in one piece, once.
+ */
+STATIC mp_obj_t Arena_make_new(const mp_obj_type_t *type,
+                               size_t n_args,
+                               size_t n_kw,
+                               const mp_obj_t *args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t num_bytes = mp_obj_get_int(args[0]);
+    if (num_bytes < ((mp_int_t)1 << CQUEUE_POOL_MIN_LOG2))
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Arena is too small");
+    }
+
+    cqueue_Arena_obj_t *self = m_new_obj_with_finaliser(cqueue_Arena_obj_t);
+    self->base.type = type;
+    self->p_mem = NULL;
+    self->size = (size_t)num_bytes;
+    self->p_mem = cqueue_data_alloc(self->size);
+    cqueue_pool_init(self);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Print an arena's size and how much of it is in use.
+ */
+STATIC void Arena_print(const mp_print_t *print,
+                        mp_obj_t self_in,
+                        mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_Arena_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "Arena(%u bytes, %u used in %u blocks)",
+              (unsigned int)self->size, (unsigned int)self->used,
+              (unsigned int)self->num_blocks);
+}
+
+
+/** Report how an arena is being used.
+ *  @param self_in The arena
+ *  @returns A tuple @c (size, used, largest_free, num_blocks, max_used,
+ *           num_fails): the numbers of bytes in the arena and in blocks
+ *           holding queue data, the most data one more queue could have,
+ *           the number of blocks holding queue data, the most bytes ever
+ *           used, and the number of queues which didn't fit
+ */
+STATIC mp_obj_t Arena_stats(mp_obj_t self_in)
+{
+    cqueue_Arena_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t largest_free = 0;
+    if (self->free_sizes != 0)
+    {
+        largest_free = ((size_t)1 << (31 - __builtin_clz(self->free_sizes)))
+                       - CQUEUE_POOL_HEADER;
+    }
+    mp_obj_t values[6] =
+    {
+        mp_obj_new_int_from_uint(self->size),
+        mp_obj_new_int_from_uint(self->used),
+        mp_obj_new_int_from_uint(largest_free),
+        mp_obj_new_int_from_uint(self->num_blocks),
+        mp_obj_new_int_from_uint(self->max_used),
+        mp_obj_new_int_from_uint(self->num_fails),
+    };
+    return mp_obj_new_tuple(6, values);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(Arena_stats_obj, Arena_stats);
+
+
+/** Give an arena's memory back to the data arena when the arena is collected.
+ *  Queues made from the arena refer to it, so any which haven't been closed
+ *  are being collected in the same sweep. Setting the memory pointer to null
+ *  tells those whose finalisers run later not to give their data back.
+ *  @param self_in The arena which is being freed
+ */
+STATIC mp_obj_t Arena_del(mp_obj_t self_in)
+{
+    cqueue_Arena_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    cqueue_data_free(self->p_mem);
+    self->p_mem = NULL;
+    self->size = 0;
+    self->free_sizes = 0;
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(Arena_del_obj, Arena_del);
+
+
+/** A dictionary of names and functions used to register the above functions
+ *  with MicroPython.
+ */
+STATIC const mp_rom_map_elem_t Arena_locals_dict_table[] =
+{
+    { MP_ROM_QSTR(MP_QSTR_stats),     MP_ROM_PTR(&Arena_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&Arena_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(Arena_locals_dict, Arena_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.Arena class in
+ *  MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_Arena_type,
+    MP_QSTR_Arena,
+    MP_TYPE_FLAG_NONE,
+    print, Arena_print,
+    make_new, Arena_make_new,
+    locals_dict, &Arena_locals_dict
+);
+
+
+//=============================================================================
+
+/** This structure holds one reader's place in a BroadcastQueue. Only that
+ *  reader changes it, so readers need no locking against each other.
+ */
+typedef struct _cqueue_reader_t
+{
+    size_t tail;                   // Read position of this reader
+    size_t num_gets;               // Number of items this reader has taken
+    size_t num_overruns;           // Items overwritten before it read them
+} cqueue_reader_t;
+
+
+/** This structure holds the data of the BroadcastQueue class, a queue with
+ *  one writer and several readers, each of which gets every item. The ring
+ *  has one more place than the queue can hold for each reader, so the place
+ *  the writer is filling is never one a reader may be reading. Positions are
+ *  free running counters which wrap far beyond the size of the array, so a
+ *  reader can tell how far behind it has fallen. A reader which falls more
+ *  than a queue's worth behind skips the items which were overwritten and
+ *  counts them as overruns; the writer never waits for a slow reader.
+ */
+typedef struct _cqueue_BroadcastQueue_obj_t
+{
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // The data and the write position
+    const cqueue_item_ops_t* p_ops;// Functions which store and load items
+    size_t num_readers;            // Number of readers
+    cqueue_reader_t readers[];     // Place of each reader in the queue
+} cqueue_BroadcastQueue_obj_t;
+
+
+/** Convert a position in a BroadcastQueue into an index in its array.
+ *  @param p_ring A pointer to the queue's ring buffer
+ *  @param pos A position from the writer or a reader
+ *  @returns The array index at which the item at that position is stored
+ */
+STATIC inline size_t cqueue_broadcast_index(const cqueue_ring_t* p_ring,
+                                            size_t pos)
+{
+    return p_ring->mask ? (pos & p_ring->mask) : (pos % p_ring->size);
+}
+
+
+/** Find a reader of a BroadcastQueue from its number.
+ *  @param self A pointer to the queue
+ *  @param reader_in The number of the reader, from zero
+ *  @returns A pointer to the reader's place in the queue
+ */
+STATIC cqueue_reader_t* cqueue_broadcast_reader(
+    cqueue_BroadcastQueue_obj_t* self, mp_obj_t reader_in)
+{
+    mp_int_t reader = mp_obj_get_int(reader_in);
+    if (reader < 0 || (size_t)reader >= self->num_readers)
+    {
+        mp_raise_msg(&mp_type_IndexError,
+                     (mp_rom_error_text_t)"No such reader");
+    }
+    return &self->readers[reader];
+}
+
+
+/** Find how many items a reader has waiting. If the writer has overwritten
+ *  items the reader hadn't read, the reader skips ahead to the oldest item
+ *  which is still there, and the skipped items are counted as overruns.
+ *  @param p_ring A pointer to the queue's ring buffer
+ *  @param p_reader A pointer to the reader
+ *  @param head The write position
+ *  @returns The number of items the reader can read
+ */
+STATIC size_t cqueue_broadcast_catch_up(const cqueue_ring_t* p_ring,
+                                        cqueue_reader_t* p_reader,
+                                        size_t head)
+{
+    size_t capacity = p_ring->size - 1;
+    size_t num_items = cqueue_ring_span(p_ring, head, p_reader->tail);
+    if (num_items > capacity)
+    {
+        p_reader->num_overruns += num_items - capacity;
+        p_reader->tail = cqueue_ring_advance(p_ring, p_reader->tail,
+                                             num_items - capacity);
+        num_items = capacity;
+    }
+    return num_items;
+}
+
+
+/** Copy items which a reader hasn't read out of a BroadcastQueue. The items
+ *  are copied first and then checked, as in a sequence lock: if the writer
+ *  has since come around to any of them, they're thrown away and the reader
+ *  tries again from the oldest items which are left. No locking is needed,
+ *  and nothing the writer does has to wait for the reader.
+ *  @param self A pointer to the queue
+ *  @param p_reader A pointer to the reader
+ *  @param dest_code The type code of the items at @c p_dest
+ *  @param p_dest A pointer to memory which receives the items
+ *  @param max_count The largest number of items to be copied
+ *  @returns The number of items which were copied
+ */
+STATIC size_t cqueue_broadcast_take(cqueue_BroadcastQueue_obj_t* self,
+                                    cqueue_reader_t* p_reader, char dest_code,
+                                    byte* p_dest, size_t max_count)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    if (p_ring->p_data == NULL)
+    {
+        return 0;
+    }
+    size_t itemsize = p_ring->itemsize;
+    size_t dest_itemsize = mp_binary_get_size('@', dest_code, NULL);
+    bool direct = (dest_code == p_ring->typecode);
+
+    for (;;)
+    {
+        size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+        size_t count = cqueue_broadcast_catch_up(p_ring, p_reader, head);
+        if (count > max_count)
+        {
+            count = max_count;
+        }
+
+        size_t read_idx = cqueue_broadcast_index(p_ring, p_reader->tail);
+        for (size_t index = 0; index < count; index++)
+        {
+            const byte* p_slot = p_ring->p_data + read_idx * itemsize;
+            if (direct)
+            {
+                memcpy(p_dest + index * itemsize, p_slot, itemsize);
+            }
+            else
+            {
+                cqueue_convert_item(dest_code, p_dest + index * dest_itemsize,
+                                    p_ring->typecode, p_slot);
+            }
+            if (++read_idx == p_ring->size)
+            {
+                read_idx = 0;
+            }
+        }
+
+        // If the writer has begun to fill the place of an item just copied,
+        // the copy may be torn, so catch up past it and copy again
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+        if (cqueue_ring_span(p_ring, head, p_reader->tail) < p_ring->size)
+        {
+            p_reader->tail = cqueue_ring_advance(p_ring, p_reader->tail, count);
+            p_reader->num_gets += count;
+            return count;
+        }
+    }
+}
+
+
+/** Write one item into a BroadcastQueue, overwriting the oldest one if the
+ *  queue is full. The write position is moved after each item, so a reader
+ *  can always tell which place the writer may be filling.
+ *  @param self A pointer to the queue
+ *  @param p_src A pointer to the item, whose type code is @c src_code
+ *  @param src_code The type code of the item
+ */
+STATIC inline void cqueue_broadcast_put(cqueue_BroadcastQueue_obj_t* self,
+                                        const byte* p_src, char src_code)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    size_t head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    byte* p_slot = p_ring->p_data
+                   + cqueue_broadcast_index(p_ring, head) * p_ring->itemsize;
+    if (src_code == p_ring->typecode)
+    {
+        memcpy(p_slot, p_src, p_ring->itemsize);
+    }
+    else
+    {
+        cqueue_convert_item(p_ring->typecode, p_slot, src_code, p_src);
+    }
+    CQUEUE_STORE_RELEASE(&p_ring->head, cqueue_ring_advance(p_ring, head, 1));
+    p_ring->num_puts++;
+}
+
+
+/** The arguments used to create a BroadcastQueue.
+ */
+STATIC const mp_arg_t BroadcastQueue_make_new_args[] =
+{
+    { MP_QSTR_type_code, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,      MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_readers,   MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_arena,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
+
+
+/** Create a new BroadcastQueue. The arguments are
+ *  @c (type_code, size, readers, *, arena=None): the array type code of the
+ *  items, the number of items each reader can have waiting, and the number
+ *  of readers, which are numbered from zero. Each reader starts with an empty
+ *  queue.
+ */
+STATIC mp_obj_t BroadcastQueue_make_new(const mp_obj_type_t *type,
+                                        size_t n_args,
+                                        size_t n_kw,
+                                        const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(BroadcastQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(BroadcastQueue_make_new_args),
+                              BroadcastQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[0].u_obj, &code_len);
+    if (code_len != 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
+    }
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+    mp_int_t size = vals[1].u_int;
+    if (size < 1)
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Queue size must be positive");
+    }
+    mp_int_t num_readers = vals[2].u_int;
+    if (num_readers < 1)
+    {
+        mp_raise_ValueError(
+            (mp_rom_error_text_t)"There must be at least one reader");
+    }
+
+    cqueue_BroadcastQueue_obj_t *self = cqueue_obj_new(
+        sizeof(cqueue_BroadcastQueue_obj_t)
+        + num_readers * sizeof(cqueue_reader_t));
+    memset(self->readers, 0, num_readers * sizeof(cqueue_reader_t));
+    self->base.type = type;
+    self->p_ops = p_ops;
+    self->num_readers = (size_t)num_readers;
+
+    cqueue_ring_init(&self->ring, size + 1, p_code[0],
+                     mp_binary_get_size('@', p_code[0], NULL), false,
+                     mp_const_none, vals[3].u_obj);
+
+    // Unless the array's size is a power of two, positions wrap at the
+    // largest multiple of it which can't overflow when a count is added
+    if (!self->ring.mask)
+    {
+        self->ring.wrap = ((size_t)-1 / self->ring.size - 1) * self->ring.size;
+    }
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+
+/** Print a BroadcastQueue's type, size and readers; it's used for debugging.
+ */
+STATIC void BroadcastQueue_print(const mp_print_t *print,
+                                 mp_obj_t self_in,
+                                 mp_print_kind_t kind)
+{
+    (void)kind;
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t head = self->ring.head;
+    mp_printf(print, "BroadcastQueue('%c')[%u]:", self->ring.typecode,
+              (unsigned int)(self->ring.size ? self->ring.size - 1 : 0));
+    for (size_t reader = 0; reader < self->num_readers; reader++)
+    {
+        size_t waiting = 0;
+        if (self->ring.p_data != NULL)
+        {
+            waiting = cqueue_ring_span(&self->ring, head,
+                                       self->readers[reader].tail);
+            if (waiting >= self->ring.size)
+            {
+                waiting = self->ring.size - 1;
+            }
+        }
+        mp_printf(print, "%s%u", reader ? "," : "R:", (unsigned int)waiting);
+    }
+}
+
+
+/** Put an item into the queue for every reader. If the queue is full for a
+ *  reader which has fallen behind, that reader's oldest item is overwritten.
+ *  No memory is allocated, so this can be done in an interrupt callback.
+ *  @param to_put The item to be put
+ */
+STATIC mp_obj_t BroadcastQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->ring.p_data == NULL)
+    {
+        cqueue_ring_raise_full(&self->ring);
+    }
+
+    uint64_t item;
+    self->p_ops->store((byte*)&item, to_put);
+    cqueue_broadcast_put(self, (const byte*)&item, self->ring.typecode);
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(BroadcastQueue_put_obj, BroadcastQueue_put);
+
+
+/** Put all the items from a buffer, such as an @c array.array, into the
+ *  queue for every reader. Items of another type are converted in C.
+ *  @param buf_in An object holding the items to be put
+ */
+STATIC mp_obj_t BroadcastQueue_put_many(mp_obj_t self_in, mp_obj_t buf_in)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->ring.p_data == NULL)
+    {
+        cqueue_ring_raise_full(&self->ring);
+    }
+
+    mp_buffer_info_t bufinfo;
+    size_t count;
+    bool direct = cqueue_get_buffer(self->ring.typecode, buf_in, &bufinfo,
+                                    MP_BUFFER_READ, &count);
+    char src_code = direct ? self->ring.typecode : bufinfo.typecode;
+    size_t buf_itemsize = mp_binary_get_size('@', bufinfo.typecode, NULL);
+    for (size_t index = 0; index < count; index++)
+    {
+        cqueue_broadcast_put(self,
+            (const byte*)bufinfo.buf + index * buf_itemsize, src_code);
+    }
+
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_2(BroadcastQueue_put_many_obj,
+                          BroadcastQueue_put_many);
+
+
+/** Get the oldest item which a reader hasn't read.
+ *  @param reader_in The number of the reader
+ *  @returns The item, or @c None if the reader has read every item
+ */
+STATIC mp_obj_t BroadcastQueue_get(mp_obj_t self_in, mp_obj_t reader_in)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_reader_t* p_reader = cqueue_broadcast_reader(self, reader_in);
+
+    uint64_t item;
+    if (cqueue_broadcast_take(self, p_reader, self->ring.typecode,
+                              (byte*)&item, 1) == 0)
+    {
+        return mp_const_none;
+    }
+    return self->p_ops->load((const byte*)&item);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(BroadcastQueue_get_obj, BroadcastQueue_get);
+
+
+/** Get as many of a reader's items as there are and will fit into a buffer,
+ *  such as an @c array.array, converting them in C if its type differs.
+ *  @param reader_in The number of the reader
+ *  @param buf_in A writable buffer which receives the items
+ *  @returns The number of items copied into the buffer
+ */
+STATIC mp_obj_t BroadcastQueue_get_into(mp_obj_t self_in, mp_obj_t reader_in,
+                                        mp_obj_t buf_in)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_reader_t* p_reader = cqueue_broadcast_reader(self, reader_in);
+
+    mp_buffer_info_t bufinfo;
+    size_t count;
+    bool direct = cqueue_get_buffer(self->ring.typecode, buf_in, &bufinfo,
+                                    MP_BUFFER_WRITE, &count);
+    char dest_code = direct ? self->ring.typecode : bufinfo.typecode;
+    count = cqueue_broadcast_take(self, p_reader, dest_code, bufinfo.buf,
+                                  count);
+
+    return mp_obj_new_int(count);
+}
+MP_DEFINE_CONST_FUN_OBJ_3(BroadcastQueue_get_into_obj,
+                          BroadcastQueue_get_into);
+
+
+/** Find how many items a reader has waiting, at most the size of the queue.
+ *  @param reader_in The number of the reader
+ *  @returns The number of items the reader can get
+ */
+STATIC mp_obj_t BroadcastQueue_available(mp_obj_t self_in, mp_obj_t reader_in)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_reader_t* p_reader = cqueue_broadcast_reader(self, reader_in);
+    if (self->ring.p_data == NULL)
+    {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
+    size_t head = CQUEUE_LOAD_ACQUIRE(&self->ring.head);
+    return mp_obj_new_int_from_uint(
+        cqueue_broadcast_catch_up(&self->ring, p_reader, head));
+}
+MP_DEFINE_CONST_FUN_OBJ_2(BroadcastQueue_available_obj,
+                          BroadcastQueue_available);
+
+
+/** Check whether a reader has any items waiting.
+ *  @param reader_in The number of the reader
+ *  @returns @c True if the reader can get an item, @c False if not
+ */
+STATIC mp_obj_t BroadcastQueue_any(mp_obj_t self_in, mp_obj_t reader_in)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_reader_t* p_reader = cqueue_broadcast_reader(self, reader_in);
+
+    return mp_obj_new_bool(self->ring.p_data != NULL
+                           && CQUEUE_LOAD_ACQUIRE(&self->ring.head)
+                              != p_reader->tail);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(BroadcastQueue_any_obj, BroadcastQueue_any);
+
+
+/** Get counts of the items which a reader has taken and which were
+ *  overwritten before the reader could take them, optionally setting them
+ *  to zero.
+ *  @param args The queue, the number of the reader and, optionally, @c True
+ *         to reset the counts
+ *  @returns A tuple @c (puts, gets, overruns) of the items put into the
+ *           queue, taken by this reader, and missed by this reader
+ */
+STATIC mp_obj_t BroadcastQueue_counters(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_BroadcastQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    cqueue_reader_t* p_reader = cqueue_broadcast_reader(self, args[1]);
+    if (self->ring.p_data != NULL)
+    {
+        cqueue_broadcast_catch_up(&self->ring, p_reader,
+                                  CQUEUE_LOAD_ACQUIRE(&self->ring.head));
+    }
+
+    mp_obj_t counts[3] =
+    {
+        mp_obj_new_int_from_uint(self->ring.num_puts),
+        mp_obj_new_int_from_uint(p_reader->num_gets),
+        mp_obj_new_int_from_uint(p_reader->num_overruns),
+    };
+    if (n_args > 2 && mp_obj_is_true(args[2]))
+    {
+        p_reader->num_gets = 0;
+        p_reader->num_overruns = 0;
     }
-    // Define a Python reference to the function above
-    STATIC MP_DEFINE_CONST_FUN_OBJ_1(floof_obj, floof);
-#endif
 
-//=============================================================================
+    return mp_obj_new_tuple(3, counts);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(BroadcastQueue_counters_obj, 2, 3,
+                                    BroadcastQueue_counters);
 
 
-/** This structure holds the data of the FloatQueue class.
+/** A dictionary of names and functions used to register the above functions
+ *  with MicroPython. Closing the queue uses the function which every queue
+ *  class shares.
  */
-typedef struct _cqueue_FloatQueue_obj_t
+STATIC const mp_rom_map_elem_t BroadcastQueue_locals_dict_table[] =
 {
-    mp_obj_base_t base;
-    size_t size;                   // Size of the array
-    size_t write_idx;              // Array index of write pointer
-    size_t read_idx;               // Array index of read pointer
-    float* p_data;                 // Pointer to array of data
-    size_t num_items;              // Number of items currently in the queue
-    size_t max_full;               // Maximum number of items in the queue
-} cqueue_FloatQueue_obj_t;
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&BroadcastQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put_many),  MP_ROM_PTR(&BroadcastQueue_put_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&BroadcastQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into),  MP_ROM_PTR(&BroadcastQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&BroadcastQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&BroadcastQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&BroadcastQueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(BroadcastQueue_locals_dict,
+                            BroadcastQueue_locals_dict_table);
+
+
+/** A type which contains the components of the @c cqueue.BroadcastQueue class
+ *  in MicroPython.
+ */
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    cqueue_BroadcastQueue_type,
+    MP_QSTR_BroadcastQueue,
+    MP_TYPE_FLAG_NONE,
+    print, BroadcastQueue_print,
+    make_new, BroadcastQueue_make_new,
+    locals_dict, &BroadcastQueue_locals_dict
+);
 
 
-STATIC const mp_obj_type_t cqueue_FloatQueue_type;
+//=============================================================================
 
+// GCC says whether it can compare and swap a size_t without a lock. Ports
+// which can't, such as those on Cortex-M0 processors, use a critical section
+#if (__SIZEOF_SIZE_T__ == 4 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)) \
+    || (__SIZEOF_SIZE_T__ == 8 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#define CQUEUE_HAVE_CAS             (1)
+#else
+#define CQUEUE_HAVE_CAS             (0)
+#endif
 
-/** A way to print a FloatQueue object; it's used for debugging.
+// How many times a waiting ThreadQueue just lets other threads run before it
+// begins to wait as @c MICROPY_EVENT_POLL_HOOK does, which may sleep
+#define CQUEUE_THREAD_SPINS         (200)
+
+/** This structure holds the data of the ThreadQueue class, a queue which any
+ *  number of threads may put items into and get items from at once. It uses
+ *  Dmitry Vyukov's bounded multiple producer, multiple consumer scheme: each
+ *  place in the array, or cell, begins with a sequence number which says
+ *  whether the cell is ready to be written or read at a given position, and
+ *  a thread claims a position by moving @c head or @c tail forward with a
+ *  compare and swap. Threads never hold a lock, so one which is stopped while
+ *  putting or getting can't keep the others waiting long. The ring's
+ *  @c itemsize is the size of a cell, and @c head and @c tail are free
+ *  running counters; the number of cells is a power of two so that they can
+ *  wrap around without a jump in the array index.
  */
-STATIC void FloatQueue_print(const mp_print_t *print,
-                             mp_obj_t self_in,
-                             mp_print_kind_t kind)
+typedef struct _cqueue_ThreadQueue_obj_t
 {
-    (void)kind;
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_print_str(print, "FloatQueue[");
-    mp_obj_print_helper(print, mp_obj_new_int(self->size), PRINT_REPR);
-    mp_print_str(print, "]:");
-    for (size_t index = 0; index < self->size; index++)
+    mp_obj_base_t base;
+    cqueue_ring_t ring;            // Cells, and write and read positions
+    const cqueue_item_ops_t* p_ops;// Functions which store and load items
+    size_t value_size;             // Number of bytes in each item
+} cqueue_ThreadQueue_obj_t;
+
+
+/** Replace a position with a new one if nobody has changed it in the
+ *  meantime. This is @c __atomic_compare_exchange_n() where the processor has
+ *  it, or the same thing with interrupts disabled where it doesn't.
+ *  @param p_pos A pointer to the position
+ *  @param p_expected A pointer to the position as last seen, which receives
+ *         the position as it is now if it has changed
+ *  @param desired The new position
+ *  @returns @c true if the position was changed
+ */
+STATIC inline bool cqueue_compare_exchange(size_t* p_pos, size_t* p_expected,
+                                           size_t desired)
+{
+    #if CQUEUE_HAVE_CAS
+    return __atomic_compare_exchange_n(p_pos, p_expected, desired, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    #else
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    bool swapped = (*p_pos == *p_expected);
+    if (swapped)
     {
-        mp_obj_print_helper(print, mp_obj_new_float(self->p_data[index]),
-                            PRINT_REPR);
-        mp_print_str(print, ",");
+        *p_pos = desired;
     }
-    mp_print_str(print, "W:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->write_idx), PRINT_REPR);
-    mp_print_str(print, ",R:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->read_idx), PRINT_REPR);
+    else
+    {
+        *p_expected = *p_pos;
+    }
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+    return swapped;
+    #endif
 }
 
 
-/** Set internal variables to indicate an empty queue.
+/** Add to a counter which several threads may change at once.
+ *  @param p_count A pointer to the counter
+ *  @param amount The number to be added
  */
-STATIC mp_obj_t FloatQueue_clear(mp_obj_t self_in)
+STATIC inline void cqueue_atomic_add(size_t* p_count, size_t amount)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    self->write_idx = 0;
-    self->read_idx = 0;
-    self->num_items = 0;
-    self->max_full = 0;
-
-    return mp_const_none;
+    #if CQUEUE_HAVE_CAS
+    __atomic_fetch_add(p_count, amount, __ATOMIC_RELAXED);
+    #else
+    mp_uint_t irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    *p_count += amount;
+    MICROPY_END_ATOMIC_SECTION(irq_state);
+    #endif
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_clear_obj, FloatQueue_clear);
 
 
-/** Create a new queue, allocating memory in which to store the data.
- *  Preallocating the memory is important when we need to pass information from
- *  an interrupt callback, as interrupt code isn't allowed to allocate memory.
+/** Find a cell of a ThreadQueue from a position.
+ *  @param p_ring A pointer to the queue's ring buffer
+ *  @param pos A write or read position
+ *  @returns A pointer to the cell's sequence number, which is followed by the
+ *           item
  */
-STATIC mp_obj_t FloatQueue_make_new(const mp_obj_type_t *type,
-                                    size_t n_args,
-                                    size_t n_kw,
-                                    const mp_obj_t *args)
+STATIC inline size_t* cqueue_thread_cell(const cqueue_ring_t* p_ring,
+                                         size_t pos)
 {
-    mp_arg_check_num(n_args, n_kw, 1, 1, true);
-    cqueue_FloatQueue_obj_t *self = m_new_obj(cqueue_FloatQueue_obj_t);
-    self->base.type = &cqueue_FloatQueue_type;
+    return (size_t*)(p_ring->p_data
+                     + (pos & (p_ring->size - 1)) * p_ring->itemsize);
+}
 
-    self->size = mp_obj_get_int(args[0]);
 
-    FloatQueue_clear (self);
+/** Try to put an item into a ThreadQueue without waiting.
+ *  @param self A pointer to the queue
+ *  @param p_item A pointer to the item, already in the queue's type
+ *  @returns @c true if the item was put, or @c false if the queue was full
+ */
+STATIC bool cqueue_thread_try_put(cqueue_ThreadQueue_obj_t* self,
+                                  const byte* p_item)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    size_t pos = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    for (;;)
+    {
+        size_t* p_cell = cqueue_thread_cell(p_ring, pos);
+        intptr_t diff = (intptr_t)(CQUEUE_LOAD_ACQUIRE(p_cell) - pos);
+        if (diff == 0)
+        {
+            // The cell is empty; claim it unless another thread just did
+            if (cqueue_compare_exchange(&p_ring->head, &pos, pos + 1))
+            {
+                memcpy(p_cell + 1, p_item, self->value_size);
+                CQUEUE_STORE_RELEASE(p_cell, pos + 1);
+                cqueue_atomic_add(&p_ring->num_puts, 1);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell still holds an item from a lap ago
+            return false;
+        }
+        else
+        {
+            pos = CQUEUE_LOAD_RELAXED(&p_ring->head);
+        }
+    }
+}
 
-    self->p_data = (float*)(m_new(byte, sizeof(float) * self->size));
 
-    return MP_OBJ_FROM_PTR(self);
+/** Try to get an item from a ThreadQueue without waiting.
+ *  @param self A pointer to the queue
+ *  @param p_item A pointer to memory which receives the item
+ *  @returns @c true if an item was taken, or @c false if the queue was empty
+ */
+STATIC bool cqueue_thread_try_get(cqueue_ThreadQueue_obj_t* self,
+                                  byte* p_item)
+{
+    cqueue_ring_t* p_ring = &self->ring;
+    size_t pos = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    for (;;)
+    {
+        size_t* p_cell = cqueue_thread_cell(p_ring, pos);
+        intptr_t diff = (intptr_t)(CQUEUE_LOAD_ACQUIRE(p_cell) - (pos + 1));
+        if (diff == 0)
+        {
+            // The cell holds an item; claim it unless another thread just did
+            if (cqueue_compare_exchange(&p_ring->tail, &pos, pos + 1))
+            {
+                memcpy(p_item, p_cell + 1, self->value_size);
+                CQUEUE_STORE_RELEASE(p_cell, pos + p_ring->size);
+                cqueue_atomic_add(&p_ring->num_gets, 1);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+        }
+    }
 }
 
 
-// Return True if there are any items in the queue, False if it's empty
-STATIC mp_obj_t FloatQueue_any(mp_obj_t self_in)
+/** Wait a little while for another thread to put or get an item. At first
+ *  the GIL is just released and taken back, which lets other threads run;
+ *  after a while the thread waits as @c MICROPY_EVENT_POLL_HOOK does, which
+ *  releases the GIL and may sleep until an interrupt. Pending callbacks and
+ *  exceptions such as @c KeyboardInterrupt are handled while waiting.
+ *  @param p_ring A pointer to the queue's ring buffer
+ *  @param start The time in milliseconds at which the wait began
+ *  @param timeout_ms The longest time to wait, or a negative number to wait
+ *         as long as it takes
+ *  @param p_spins A pointer to a count of the times this wait has gone
+ *         around, which begins at zero
+ *  @returns @c true to try again, or @c false if the time is up or the queue
+ *           has been closed
+ */
+STATIC bool cqueue_thread_wait(const cqueue_ring_t* p_ring, mp_uint_t start,
+                               mp_int_t timeout_ms, size_t* p_spins)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    return mp_obj_new_bool (self->num_items > 0);
+    if (p_ring->p_data == NULL || timeout_ms == 0 || (timeout_ms > 0
+        && mp_hal_ticks_ms() - start >= (mp_uint_t)timeout_ms))
+    {
+        return false;
+    }
+    if (*p_spins < CQUEUE_THREAD_SPINS)
+    {
+        (*p_spins)++;
+        MP_THREAD_GIL_EXIT();
+        MP_THREAD_GIL_ENTER();
+    }
+    else
+    {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return true;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_any_obj, FloatQueue_any);
 
 
-/** Return @c True if the queue is full or @c False if there's still room for
- *  more items without overwriting old ones.
- *  @returns The Python constant @c True if the queue is full or @c False if not
+/** Get a timeout in milliseconds from a MicroPython object.
+ *  @param timeout_in An integer, or @c None to wait as long as it takes
+ *  @returns The timeout, which is negative for no limit
  */
-STATIC mp_obj_t FloatQueue_full(mp_obj_t self_in)
+STATIC mp_int_t cqueue_thread_timeout(mp_obj_t timeout_in)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    return mp_obj_new_bool (self->num_items >= self->size);
+    return (timeout_in == mp_const_none) ? -1 : mp_obj_get_int(timeout_in);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_full_obj, FloatQueue_full);
 
 
-/** Put an item into the queue. Overwrite old data if queue is full.
- *  @param to_put The floating point number to be put into the queue
+/** The arguments used to create a ThreadQueue.
  */
-STATIC mp_obj_t FloatQueue_put(mp_obj_t self_in, mp_obj_t to_put)
+STATIC const mp_arg_t ThreadQueue_make_new_args[] =
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    float putted = mp_obj_get_float(to_put);
+    { MP_QSTR_type_code, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+    { MP_QSTR_size,      MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_arena,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+};
 
-    self->p_data[self->write_idx] = putted;
-    self->write_idx++;
-    if (self->write_idx >= self->size)
+
+/** Create a new ThreadQueue. The arguments are
+ *  @c (type_code, size, *, arena=None). The size is rounded up to a power of
+ *  two if it isn't one.
+ */
+STATIC mp_obj_t ThreadQueue_make_new(const mp_obj_type_t *type,
+                                     size_t n_args,
+                                     size_t n_kw,
+                                     const mp_obj_t *args)
+{
+    mp_arg_val_t vals[MP_ARRAY_SIZE(ThreadQueue_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(ThreadQueue_make_new_args),
+                              ThreadQueue_make_new_args, vals);
+
+    size_t code_len;
+    const char* p_code = mp_obj_str_get_data(vals[0].u_obj, &code_len);
+    if (code_len != 1)
     {
-        self->write_idx = 0;
+        mp_raise_ValueError((mp_rom_error_text_t)"Unsupported type code");
     }
-
-    // If the queue is full before writing, move the read pointer so we'll read
-    // old data, not new data
-    if (self->num_items >= self->size)
+    const cqueue_item_ops_t* p_ops = cqueue_item_ops_find(p_code[0]);
+    mp_int_t size = vals[1].u_int;
+    if (size < 1 || size > ((mp_int_t)1 << (8 * sizeof(mp_int_t) - 3)))
     {
-        self->read_idx++;
-        if (self->read_idx >= self->size)
-        {
-            self->read_idx = 0;
-        }
+        mp_raise_ValueError((mp_rom_error_text_t)"Invalid queue size");
     }
-
-    // Now increase the fillage and check again if the queue is full
-    self->num_items++;
-    if (self->num_items >= self->size)
+    mp_int_t num_cells = 1;
+    while (num_cells < size)
     {
-        self->num_items = self->size;
+        num_cells <<= 1;
     }
-    if (self->num_items > self->max_full)
+
+    cqueue_ThreadQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_ThreadQueue_obj_t));
+    self->base.type = type;
+    self->p_ops = p_ops;
+    self->value_size = mp_binary_get_size('@', p_code[0], NULL);
+
+    // Each cell is a sequence number and an item, padded so that every cell's
+    // sequence number is aligned
+    size_t cell_size = (sizeof(size_t) + self->value_size + sizeof(size_t) - 1)
+                       & ~(sizeof(size_t) - 1);
+    cqueue_ring_init(&self->ring, num_cells, p_code[0], cell_size, false,
+                     mp_const_none, vals[2].u_obj);
+    for (size_t pos = 0; pos < self->ring.size; pos++)
     {
-        self->max_full = self->num_items;
+        *cqueue_thread_cell(&self->ring, pos) = pos;
     }
 
-    return mp_const_none;
+    return MP_OBJ_FROM_PTR(self);
 }
-MP_DEFINE_CONST_FUN_OBJ_2(FloatQueue_put_obj, FloatQueue_put);
 
 
-/** Get an item from the queue; return @c None if the queue is empty.
- *  @returns The oldest data in the queue, or @c None if none is present
+/** Print a ThreadQueue's type, size and number of items; it's used for
+ *  debugging.
  */
-STATIC mp_obj_t FloatQueue_get(mp_obj_t self_in)
+STATIC void ThreadQueue_print(const mp_print_t *print,
+                              mp_obj_t self_in,
+                              mp_print_kind_t kind)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)kind;
+    cqueue_ThreadQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "ThreadQueue('%c')[%u]:%u items", self->ring.typecode,
+              (unsigned int)self->ring.size,
+              (unsigned int)(self->ring.head - self->ring.tail));
+}
 
-    // Make sure there's something to get
-    if (self->num_items == 0)
+
+/** Put an item into the queue, waiting for room if it's full. While waiting,
+ *  the GIL is released so other threads can run. With a timeout of zero this
+ *  never waits or allocates memory, so it can be used in interrupt callbacks.
+ *  @param args The queue, the item, and optionally the longest time to wait
+ *         in milliseconds, or @c None, the default, to wait as long as it
+ *         takes
+ *  @returns @c True if the item was put, or @c False if time ran out first
+ */
+STATIC mp_obj_t ThreadQueue_put(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_ThreadQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t timeout_ms = cqueue_thread_timeout(n_args > 2 ? args[2]
+                                                           : mp_const_none);
+    if (self->ring.p_data == NULL)
     {
-        return mp_const_none;
+        cqueue_ring_raise_full(&self->ring);
     }
 
-    float to_return = self->p_data[self->read_idx];
+    // Convert the item first, as converting it might raise an exception
+    uint64_t item;
+    self->p_ops->store((byte*)&item, args[1]);
 
-    // If we get here, the queue has some data in it
-    self->read_idx++;
-    if (self->read_idx >= self->size)
+    mp_uint_t start = mp_hal_ticks_ms();
+    size_t spins = 0;
+    while (!cqueue_thread_try_put(self, (const byte*)&item))
+    {
+        if (!cqueue_thread_wait(&self->ring, start, timeout_ms, &spins))
+        {
+            if (self->ring.p_data == NULL)
+            {
+                cqueue_ring_raise_full(&self->ring);
+            }
+            cqueue_atomic_add(&self->ring.num_drops, 1);
+            return mp_const_false;
+        }
+    }
+    return mp_const_true;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ThreadQueue_put_obj, 2, 3,
+                                    ThreadQueue_put);
+
+
+/** Get the oldest item from the queue, waiting for one if the queue is empty.
+ *  While waiting, the GIL is released so other threads can run.
+ *  @param args The queue, and optionally the longest time to wait in
+ *         milliseconds, or @c None, the default, to wait as long as it takes
+ *  @returns The item, or @c None if time ran out first
+ */
+STATIC mp_obj_t ThreadQueue_get(size_t n_args, const mp_obj_t *args)
+{
+    cqueue_ThreadQueue_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t timeout_ms = cqueue_thread_timeout(n_args > 1 ? args[1]
+                                                           : mp_const_none);
+    if (self->ring.p_data == NULL)
     {
-        self->read_idx = 0;
+        return mp_const_none;
     }
 
-    self->num_items--;
-    if ((int32_t)(self->num_items) <= 0)
+    uint64_t item;
+    mp_uint_t start = mp_hal_ticks_ms();
+    size_t spins = 0;
+    while (!cqueue_thread_try_get(self, (byte*)&item))
     {
-        self->num_items = 0;
+        if (!cqueue_thread_wait(&self->ring, start, timeout_ms, &spins))
+        {
+            return mp_const_none;
+        }
     }
-    return mp_obj_new_float(to_return);
+    return self->p_ops->load((const byte*)&item);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_get_obj, FloatQueue_get);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ThreadQueue_get_obj, 1, 2,
+                                    ThreadQueue_get);
 
 
-/** Return the number of items in the queue.
- *  @return The number if items available to be read from the queue
+/** Find how many items are in the queue. As other threads may be putting and
+ *  getting, the number may have changed by the time it's used.
+ *  @returns The number of items in the queue
  */
-STATIC mp_obj_t FloatQueue_available(mp_obj_t self_in)
+STATIC mp_obj_t ThreadQueue_available(mp_obj_t self_in)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ThreadQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&self->ring.tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&self->ring.head);
 
-    return mp_obj_new_int (self->num_items);
+    // A get may have moved the tail past a head read earlier
+    intptr_t count = (intptr_t)(head - tail);
+    if (count < 0)
+    {
+        count = 0;
+    }
+    else if ((size_t)count > self->ring.size)
+    {
+        count = self->ring.size;
+    }
+    return mp_obj_new_int(count);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_available_obj, FloatQueue_available);
+MP_DEFINE_CONST_FUN_OBJ_1(ThreadQueue_available_obj, ThreadQueue_available);
 
 
-/** Return the maximum number of items which have been in the queue since it
- *  was created or last cleared.
- *  @returns The largest number of items in the queue
+/** Check whether the queue has any items in it.
+ *  @returns @c True if there's at least one item, @c False if not
  */
-STATIC mp_obj_t FloatQueue_max_full(mp_obj_t self_in)
+STATIC mp_obj_t ThreadQueue_any(mp_obj_t self_in)
 {
-    cqueue_FloatQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(
+        MP_OBJ_SMALL_INT_VALUE(ThreadQueue_available(self_in)) > 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(ThreadQueue_any_obj, ThreadQueue_any);
 
-    return mp_obj_new_int (self->max_full);
+
+/** Check whether the queue is full.
+ *  @returns @c True if there's no room for another item, @c False if there is
+ */
+STATIC mp_obj_t ThreadQueue_full(mp_obj_t self_in)
+{
+    cqueue_ThreadQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool((size_t)MP_OBJ_SMALL_INT_VALUE(
+        ThreadQueue_available(self_in)) >= self->ring.size);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(FloatQueue_max_full_obj, FloatQueue_max_full);
+MP_DEFINE_CONST_FUN_OBJ_1(ThreadQueue_full_obj, ThreadQueue_full);
 
 
-/** A dictionary of names and functions which is used to register functions so
- *  they can be called from MicroPython.
+/** A dictionary of names and functions used to register the above functions
+ *  with MicroPython. Drops counted by @c counters() are puts which timed out.
  */
-STATIC const mp_rom_map_elem_t FloatQueue_locals_dict_table[] =
+STATIC const mp_rom_map_elem_t ThreadQueue_locals_dict_table[] =
 {
-    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&FloatQueue_clear_obj) },
-    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&FloatQueue_any_obj) },
-    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&FloatQueue_full_obj) },
-    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&FloatQueue_put_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&FloatQueue_get_obj) },
-    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&FloatQueue_available_obj) },
-    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&FloatQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&ThreadQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&ThreadQueue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&ThreadQueue_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&ThreadQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&ThreadQueue_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters),  MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),     MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),   MP_ROM_PTR(&cqueue_del_obj) },
 };
-STATIC MP_DEFINE_CONST_DICT(FloatQueue_locals_dict,
-                            FloatQueue_locals_dict_table);
+STATIC MP_DEFINE_CONST_DICT(ThreadQueue_locals_dict,
+                            ThreadQueue_locals_dict_table);
 
 
-/** A type which contains the components of the @c cqueue.FloatQueue class in
-*  MicroPython.
-*/
+/** A type which contains the components of the @c cqueue.ThreadQueue class in
+ *  MicroPython.
+ */
 STATIC MP_DEFINE_CONST_OBJ_TYPE(
-    cqueue_FloatQueue_type,
-    MP_QSTR_FloatQueue,
+    cqueue_ThreadQueue_type,
+    MP_QSTR_ThreadQueue,
     MP_TYPE_FLAG_NONE,
-    print, FloatQueue_print,
-    make_new, FloatQueue_make_new,
-    locals_dict, &FloatQueue_locals_dict
+    print, ThreadQueue_print,
+    make_new, ThreadQueue_make_new,
+    locals_dict, &ThreadQueue_locals_dict
 );
 
 
 //=============================================================================
 
-/** This structure holds the data of the ByteQueue class.
+// Each message in a MessageQueue begins with its length in this many bytes
+#define CQUEUE_MSG_HEADER           (sizeof(uint16_t))
+
+// A length which marks the rest of the array as padding, skipped by readers
+#define CQUEUE_MSG_PAD              (0xFFFF)
+
+/** This structure holds the data of the MessageQueue class, whose items are
+ *  messages of any length up to half its capacity, such as command strings or
+ *  packets. The ring holds bytes. Each message is kept in one piece as a
+ *  16-bit length followed by its bytes; a message which won't fit before the
+ *  end of the array goes at the beginning, and the bytes it skips are
+ *  padding, marked with @c CQUEUE_MSG_PAD if there's room for a length. The
+ *  padding counts as used until the reader passes it, and a message can't be
+ *  longer than half the capacity so that it always fits into an empty queue.
+ *
+ *  In SPSC mode the writer changes only @c head and the reader only @c tail,
+ *  as in the other queues. Otherwise an overwriting put throws away whole
+ *  messages by moving @c tail, so puts and gets are done with interrupts
+ *  disabled to keep the reader from losing its place between messages.
  */
-typedef struct _cqueue_ByteQueue_obj_t
+typedef struct _cqueue_MessageQueue_obj_t
 {
     mp_obj_base_t base;
-    size_t size;                   // Size of the array
-    size_t write_idx;              // Array index of write pointer
-    size_t read_idx;               // Array index of read pointer
-    byte* p_data;                  // Pointer to array of data
-    size_t num_items;              // Number of items currently in the queue
-    size_t max_full;               // Maximum number of items in the queue
-} cqueue_ByteQueue_obj_t;
+    cqueue_ring_t ring;            // Bytes of messages, lengths and padding
+} cqueue_MessageQueue_obj_t;
 
 
-STATIC const mp_obj_type_t cqueue_ByteQueue_type;
+/** Read the length at a position in a MessageQueue's ring.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param pos The position of the length, which is never split by the end
+ *         of the array
+ *  @returns The length of the message, or @c CQUEUE_MSG_PAD
+ */
+STATIC inline size_t cqueue_msg_length(const cqueue_ring_t* p_ring,
+                                       size_t pos)
+{
+    uint16_t length;
+    memcpy(&length, p_ring->p_data + cqueue_ring_index(p_ring, pos),
+           CQUEUE_MSG_HEADER);
+    return length;
+}
 
 
-/** A way to print a ByteQueue object; it's used for debugging.
+/** Move a read position past any padding at the end of the array, so that it
+ *  is at the length of the oldest message.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param tail The read position
+ *  @param head The write position
+ *  @returns The read position of the oldest message, or @c head if there
+ *           are no messages
  */
-STATIC void ByteQueue_print(const mp_print_t *print,
-                             mp_obj_t self_in,
-                             mp_print_kind_t kind)
+STATIC size_t cqueue_msg_skip_pad(const cqueue_ring_t* p_ring, size_t tail,
+                                  size_t head)
 {
-    (void)kind;
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_print_str(print, "ByteQueue[");
-    mp_obj_print_helper(print, mp_obj_new_int(self->size), PRINT_REPR);
-    mp_print_str(print, "]:b'");
-    for (size_t index = 0; index < self->size; index++)
+    if (tail == head)
     {
-        // Print characters in approximately Python string printing style
-        if (self->p_data[index] > 31 && self->p_data[index] < 127)
-        {
-            mp_printf(print, "%c", self->p_data[index]);
-        }
-        else
-        {
-            mp_printf(print, "\\x%02x", self->p_data[index]);
-        }
+        return tail;
     }
-    mp_print_str(print, "' W:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->write_idx), PRINT_REPR);
-    mp_print_str(print, ", R:");
-    mp_obj_print_helper(print, mp_obj_new_int(self->read_idx), PRINT_REPR);
+    size_t rest = p_ring->size - cqueue_ring_index(p_ring, tail);
+    if (rest < CQUEUE_MSG_HEADER
+        || cqueue_msg_length(p_ring, tail) == CQUEUE_MSG_PAD)
+    {
+        tail = cqueue_ring_advance(p_ring, tail, rest);
+    }
+    return tail;
 }
 
 
-/** Set internal variables to indicate an empty queue.
+/** Find how many bytes of padding must go in front of a message so that it
+ *  doesn't run past the end of the array.
+ *  @param p_ring A pointer to the ring buffer
+ *  @param head The write position
+ *  @param length The number of bytes in the message
+ *  @returns The number of bytes to skip, which is zero if the message fits
  */
-STATIC mp_obj_t ByteQueue_clear(mp_obj_t self_in)
+STATIC inline size_t cqueue_msg_pad_size(const cqueue_ring_t* p_ring,
+                                         size_t head, size_t length)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    self->write_idx = 0;
-    self->read_idx = 0;
-    self->num_items = 0;
-    self->max_full = 0;
-
-    return mp_const_none;
+    size_t rest = p_ring->size - cqueue_ring_index(p_ring, head);
+    return (rest < CQUEUE_MSG_HEADER + length) ? rest : 0;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_clear_obj, ByteQueue_clear);
 
 
-/** Create a new queue, allocating memory in which to store the data.
- *  Preallocating the memory is important when we need to pass information from
- *  an interrupt callback, as interrupt code isn't allowed to allocate memory.
+/** Find the longest message which can be put into a MessageQueue. Padding is
+ *  always shorter than the message after it, so a message no longer than
+ *  this fits into an empty queue wherever the write position is.
+ *  @param p_ring A pointer to the ring buffer
+ *  @returns The largest number of bytes in a message
  */
-STATIC mp_obj_t ByteQueue_make_new(const mp_obj_type_t *type,
-                                   size_t n_args,
-                                   size_t n_kw,
-                                   const mp_obj_t *args)
+STATIC inline size_t cqueue_msg_max_length(const cqueue_ring_t* p_ring)
 {
-    mp_arg_check_num(n_args, n_kw, 1, 1, true);
-    cqueue_ByteQueue_obj_t *self = m_new_obj(cqueue_ByteQueue_obj_t);
-    self->base.type = &cqueue_ByteQueue_type;
-
-    self->size = mp_obj_get_int(args[0]);
-
-    ByteQueue_clear (self);
-
-    self->p_data = (byte*)(m_new(byte, sizeof(byte) * self->size));
-
-    return MP_OBJ_FROM_PTR(self);
+    if (p_ring->p_data == NULL)
+    {
+        // A closed queue has no room for anything
+        return 0;
+    }
+    size_t longest = (p_ring->size + 1) / 2 - CQUEUE_MSG_HEADER;
+    return (longest < CQUEUE_MSG_PAD) ? longest : CQUEUE_MSG_PAD - 1;
 }
 
 
-/** Return True if there are any items in the queue, False if it's empty
+/** Create a new MessageQueue. The arguments are
+ *  @c (capacity, *, spsc=False, overflow=None, arena=None), where the
+ *  capacity is a number of bytes, lengths and padding included.
  */
-STATIC mp_obj_t ByteQueue_any(mp_obj_t self_in)
+STATIC mp_obj_t MessageQueue_make_new(const mp_obj_type_t *type,
+                                      size_t n_args,
+                                      size_t n_kw,
+                                      const mp_obj_t *args)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_arg_val_t vals[MP_ARRAY_SIZE(cqueue_ring_make_new_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args,
+                              MP_ARRAY_SIZE(cqueue_ring_make_new_args),
+                              cqueue_ring_make_new_args, vals);
+    if (vals[0].u_int < (mp_int_t)(2 * CQUEUE_MSG_HEADER - 1))
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Queue size too small");
+    }
 
-    return mp_obj_new_bool (self->num_items > 0);
+    cqueue_MessageQueue_obj_t *self = cqueue_obj_new(sizeof(cqueue_MessageQueue_obj_t));
+    self->base.type = type;
+    cqueue_ring_init(&self->ring, vals[0].u_int, 'B', 1, vals[1].u_bool,
+                     vals[2].u_obj, vals[3].u_obj);
+
+    return MP_OBJ_FROM_PTR(self);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_any_obj, ByteQueue_any);
 
 
-/** Return @c True if the queue is full or @c False if there's still room for
- *  more items without overwriting old ones.
- *  @returns The Python constant @c True if the queue is full or @c False if not
+/** Print a MessageQueue's capacity and the number of bytes in use; it's used
+ *  for debugging.
  */
-STATIC mp_obj_t ByteQueue_full(mp_obj_t self_in)
+STATIC void MessageQueue_print(const mp_print_t *print,
+                               mp_obj_t self_in,
+                               mp_print_kind_t kind)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    return mp_obj_new_bool (self->num_items >= self->size);
+    (void)kind;
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "MessageQueue[%u]:%u bytes used",
+              (unsigned int)self->ring.size,
+              (unsigned int)cqueue_ring_count(&self->ring));
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_full_obj, ByteQueue_full);
 
 
-/** Put characters into the queue. Overwrite old data if queue is full.
- *  @param str_obj_in The characters to be put into the queue
+/** Put a message into the queue. Its bytes are copied with one call to
+ *  @c memcpy() and no memory is allocated, so this can be used in interrupt
+ *  callbacks. If there isn't room, the overflow policy decides whether the
+ *  oldest messages are thrown away to make room, the new message is dropped,
+ *  or @c OverflowError is raised; the counters count messages, not bytes.
+ *  @param buf_in A @c bytes, @c bytearray, string or other buffer holding the
+ *         message, which may be empty
  */
-STATIC mp_obj_t ByteQueue_put(mp_obj_t self_in, mp_obj_t str_obj_in)
+STATIC mp_obj_t MessageQueue_put(mp_obj_t self_in, mp_obj_t buf_in)
 {
-    // Ensure that the input is a valid type (prevents crashes)
-    if (!mp_obj_is_str_or_bytes(str_obj_in))
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_buffer_info_t bufinfo;
+    if (!mp_get_buffer(buf_in, &bufinfo, MP_BUFFER_READ))
     {
         mp_raise_TypeError((mp_rom_error_text_t)"Bytes or string required");
     }
+    if (p_ring->p_data == NULL)
+    {
+        cqueue_ring_raise_full(p_ring);
+    }
+    if (bufinfo.len > cqueue_msg_max_length(p_ring))
+    {
+        mp_raise_ValueError((mp_rom_error_text_t)"Message too long for queue");
+    }
 
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
-
-    // Get the length of the bytearray or string and a data pointer
-    GET_STR_DATA_LEN(str_obj_in, my_str, str_len);
+    mp_uint_t irq_state = 0;
+    if (!p_ring->spsc)
+    {
+        irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    }
+    size_t head = CQUEUE_LOAD_RELAXED(&p_ring->head);
+    size_t tail = CQUEUE_LOAD_ACQUIRE(&p_ring->tail);
+    size_t pad = cqueue_msg_pad_size(p_ring, head, bufinfo.len);
+    size_t needed = pad + CQUEUE_MSG_HEADER + bufinfo.len;
 
-    // Copy the data into the queue, overwriting old data if it's there
-    for (size_t index = 0; index < str_len; index++)
+    if (needed > p_ring->size - cqueue_ring_span(p_ring, head, tail))
     {
-        self->p_data[self->write_idx] = my_str[index];
-        self->write_idx++;
-        if (self->write_idx >= self->size)
+        if (p_ring->overflow != CQUEUE_OVERWRITE)
         {
-            self->write_idx = 0;
-        }
-        if (self->num_items >= self->size)     // If the queue is full before
-        {                                      // writing, move read pointer
-            self->read_idx++;                  // so we'll read old data,
-            if (self->read_idx >= self->size)  // not new data
+            p_ring->num_drops++;
+            if (!p_ring->spsc)
             {
-                self->read_idx = 0;
+                MICROPY_END_ATOMIC_SECTION(irq_state);
             }
+            if (p_ring->overflow == CQUEUE_RAISE)
+            {
+                cqueue_ring_raise_full(p_ring);
+            }
+            return mp_const_none;
         }
-        self->num_items++;                     // Now increase the fillage and
-        if (self->num_items >= self->size)     // check again if the queue is
-        {                                      // full
-            self->num_items = self->size;
-        }
-        if (self->num_items > self->max_full)
+
+        // Throw away the oldest messages until there's room for this one
+        do
         {
-            self->max_full = self->num_items;
+            tail = cqueue_msg_skip_pad(p_ring, tail, head);
+            tail = cqueue_ring_advance(p_ring, tail, CQUEUE_MSG_HEADER
+                                       + cqueue_msg_length(p_ring, tail));
+            p_ring->num_overwrites++;
         }
+        while (needed > p_ring->size - cqueue_ring_span(p_ring, head, tail));
+        CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    }
+
+    if (pad >= CQUEUE_MSG_HEADER)
+    {
+        uint16_t marker = CQUEUE_MSG_PAD;
+        memcpy(p_ring->p_data + cqueue_ring_index(p_ring, head), &marker,
+               CQUEUE_MSG_HEADER);
+    }
+    head = cqueue_ring_advance(p_ring, head, pad);
+
+    uint16_t length = (uint16_t)bufinfo.len;
+    byte* p_dest = p_ring->p_data + cqueue_ring_index(p_ring, head);
+    memcpy(p_dest, &length, CQUEUE_MSG_HEADER);
+    memcpy(p_dest + CQUEUE_MSG_HEADER, bufinfo.buf, bufinfo.len);
+    head = cqueue_ring_advance(p_ring, head, CQUEUE_MSG_HEADER + bufinfo.len);
+    CQUEUE_STORE_RELEASE(&p_ring->head, head);
+    p_ring->num_puts++;
+
+    size_t num_bytes = cqueue_ring_span(p_ring, head, tail);
+    if (num_bytes > p_ring->max_full)
+    {
+        p_ring->max_full = num_bytes;
+    }
+    if (!p_ring->spsc)
+    {
+        MICROPY_END_ATOMIC_SECTION(irq_state);
     }
 
     return mp_const_none;
 }
-MP_DEFINE_CONST_FUN_OBJ_2(ByteQueue_put_obj, ByteQueue_put);
+MP_DEFINE_CONST_FUN_OBJ_2(MessageQueue_put_obj, MessageQueue_put);
 
 
-/** Get an item from the queue; return @c None if the queue is empty.
- *  @returns The oldest data in the queue, or @c None if none is present
+/** Take the oldest message from the queue and copy it into a @c bytearray,
+ *  array or other writable buffer, so no memory is allocated. If the buffer
+ *  is too small, @c ValueError is raised and the message is left in the
+ *  queue; @c peek_len() tells how big a buffer is needed.
+ *  @param buf_in The buffer which receives the message
+ *  @returns The number of bytes in the message, or @c None if the queue is
+ *           empty
  */
-STATIC mp_obj_t ByteQueue_get(mp_obj_t self_in)
+STATIC mp_obj_t MessageQueue_get_into(mp_obj_t self_in, mp_obj_t buf_in)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
 
-    // Make sure there's something to get
-    if (self->num_items == 0)
+    mp_uint_t irq_state = 0;
+    if (!p_ring->spsc)
     {
-        return mp_const_none;
+        irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
     }
-
-    byte to_return = self->p_data[self->read_idx];
-
-    // If we get here, the queue has some data in it
-    self->read_idx++;
-    if (self->read_idx >= self->size)
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+    tail = cqueue_msg_skip_pad(p_ring, tail, head);
+    size_t length = 0;
+    bool got = false;
+    if (tail != head)
+    {
+        length = cqueue_msg_length(p_ring, tail);
+        if (length <= bufinfo.len)
+        {
+            memcpy(bufinfo.buf, p_ring->p_data
+                   + cqueue_ring_index(p_ring, tail) + CQUEUE_MSG_HEADER,
+                   length);
+            tail = cqueue_ring_advance(p_ring, tail,
+                                       CQUEUE_MSG_HEADER + length);
+            p_ring->num_gets++;
+            got = true;
+        }
+    }
+    CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    if (!p_ring->spsc)
     {
-        self->read_idx = 0;
+        MICROPY_END_ATOMIC_SECTION(irq_state);
     }
 
-    self->num_items--;
-    if ((int32_t)(self->num_items) <= 0)
+    if (got)
     {
-        self->num_items = 0;
+        return MP_OBJ_NEW_SMALL_INT(length);
     }
-    return mp_obj_new_bytes(&to_return, 1);
+    if (tail != head)
+    {
+        mp_raise_ValueError(
+            (mp_rom_error_text_t)"Buffer too small for message");
+    }
+    return mp_const_none;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_get_obj, ByteQueue_get);
+MP_DEFINE_CONST_FUN_OBJ_2(MessageQueue_get_into_obj, MessageQueue_get_into);
 
 
-/** Return the number of items in the queue.
- *  @return The number if items available to be read from the queue
+/** Find the length of the oldest message without taking it from the queue.
+ *  @returns The number of bytes in the message, or @c None if the queue is
+ *           empty
  */
-STATIC mp_obj_t ByteQueue_available(mp_obj_t self_in)
+STATIC mp_obj_t MessageQueue_peek_len(mp_obj_t self_in)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_ring_t* p_ring = &self->ring;
+
+    mp_uint_t irq_state = 0;
+    if (!p_ring->spsc)
+    {
+        irq_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    }
+    size_t tail = CQUEUE_LOAD_RELAXED(&p_ring->tail);
+    size_t head = CQUEUE_LOAD_ACQUIRE(&p_ring->head);
+    tail = cqueue_msg_skip_pad(p_ring, tail, head);
+    CQUEUE_STORE_RELEASE(&p_ring->tail, tail);
+    mp_obj_t length = mp_const_none;
+    if (tail != head)
+    {
+        length = MP_OBJ_NEW_SMALL_INT(cqueue_msg_length(p_ring, tail));
+    }
+    if (!p_ring->spsc)
+    {
+        MICROPY_END_ATOMIC_SECTION(irq_state);
+    }
 
-    return mp_obj_new_int (self->num_items);
+    return length;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_available_obj, ByteQueue_available);
+MP_DEFINE_CONST_FUN_OBJ_1(MessageQueue_peek_len_obj, MessageQueue_peek_len);
 
 
-/** Return the maximum number of items which have been in the queue since it
- *  was created or last cleared.
- *  @returns The largest number of items in the queue
+/** Check whether the queue has any messages in it.
+ *  @returns @c True if there's at least one message, @c False if not
  */
-STATIC mp_obj_t ByteQueue_max_full(mp_obj_t self_in)
+STATIC mp_obj_t MessageQueue_any(mp_obj_t self_in)
 {
-    cqueue_ByteQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(cqueue_ring_count(&self->ring) > 0);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(MessageQueue_any_obj, MessageQueue_any);
 
-    return mp_obj_new_int (self->max_full);
+
+/** Find the longest message which can be put into the queue.
+ *  @returns The number of bytes, a little less than half the capacity
+ */
+STATIC mp_obj_t MessageQueue_max_len(mp_obj_t self_in)
+{
+    cqueue_MessageQueue_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_int(cqueue_msg_max_length(&self->ring));
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ByteQueue_max_full_obj, ByteQueue_max_full);
+MP_DEFINE_CONST_FUN_OBJ_1(MessageQueue_max_len_obj, MessageQueue_max_len);
 
 
-/** A dictionary of names and functions which is used to register functions so
- *  they can be called from MicroPython.
+/** A dictionary of names and functions used to register the above functions
+ *  with MicroPython.
  */
-STATIC const mp_rom_map_elem_t ByteQueue_locals_dict_table[] =
+STATIC const mp_rom_map_elem_t MessageQueue_locals_dict_table[] =
 {
-    { MP_ROM_QSTR(MP_QSTR_clear),     MP_ROM_PTR(&ByteQueue_clear_obj) },
-    { MP_ROM_QSTR(MP_QSTR_any),       MP_ROM_PTR(&ByteQueue_any_obj) },
-    { MP_ROM_QSTR(MP_QSTR_full),      MP_ROM_PTR(&ByteQueue_full_obj) },
-    { MP_ROM_QSTR(MP_QSTR_put),       MP_ROM_PTR(&ByteQueue_put_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get),       MP_ROM_PTR(&ByteQueue_get_obj) },
-    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&ByteQueue_available_obj) },
-    { MP_ROM_QSTR(MP_QSTR_max_full),  MP_ROM_PTR(&ByteQueue_max_full_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put),      MP_ROM_PTR(&MessageQueue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into), MP_ROM_PTR(&MessageQueue_get_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_peek_len), MP_ROM_PTR(&MessageQueue_peek_len_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any),      MP_ROM_PTR(&MessageQueue_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max_len),  MP_ROM_PTR(&MessageQueue_max_len_obj) },
+    { MP_ROM_QSTR(MP_QSTR_counters), MP_ROM_PTR(&cqueue_counters_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close),    MP_ROM_PTR(&cqueue_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__),  MP_ROM_PTR(&cqueue_del_obj) },
 };
-STATIC MP_DEFINE_CONST_DICT(ByteQueue_locals_dict,
-                            ByteQueue_locals_dict_table);
+STATIC MP_DEFINE_CONST_DICT(MessageQueue_locals_dict,
+                            MessageQueue_locals_dict_table);
 
 
-/** A type which contains the components of the @c cqueue.ByteQueue class in
- *  MicroPython.
+/** A type which contains the components of the @c cqueue.MessageQueue class
+ *  in MicroPython.
  */
 STATIC MP_DEFINE_CONST_OBJ_TYPE(
-    cqueue_ByteQueue_type,
-    MP_QSTR_ByteQueue,
+    cqueue_MessageQueue_type,
+    MP_QSTR_MessageQueue,
     MP_TYPE_FLAG_NONE,
-    print, ByteQueue_print,
-    make_new, ByteQueue_make_new,
-    locals_dict, &ByteQueue_locals_dict
+    print, MessageQueue_print,
+    make_new, MessageQueue_make_new,
+    locals_dict, &MessageQueue_locals_dict
 );
 
 
 //=============================================================================
 
 // Designate a string for the version of this module
-STATIC MP_DEFINE_STR_OBJ(cqueue_version_obj, "0.6.2");
+STATIC MP_DEFINE_STR_OBJ(cqueue_version_obj, "0.7.0");
 
 // This table maps the symbols in the module to their names so Python can find
 // them
@@ -790,9 +7829,27 @@ STATIC const mp_rom_map_elem_t cqueue_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__),    MP_ROM_QSTR(MP_QSTR_cqueue) },
     { MP_ROM_QSTR(MP_QSTR___version__), MP_ROM_PTR(&cqueue_version_obj) },
 //     { MP_ROM_QSTR(MP_QSTR_floof),       MP_ROM_PTR(&floof_obj) },
+    { MP_ROM_QSTR(MP_QSTR_TypedQueue),  MP_ROM_PTR(&cqueue_TypedQueue_type) },
     { MP_ROM_QSTR(MP_QSTR_IntQueue),    MP_ROM_PTR(&cqueue_IntQueue_type) },
     { MP_ROM_QSTR(MP_QSTR_FloatQueue),  MP_ROM_PTR(&cqueue_FloatQueue_type) },
     { MP_ROM_QSTR(MP_QSTR_ByteQueue),   MP_ROM_PTR(&cqueue_ByteQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_TimedQueue),  MP_ROM_PTR(&cqueue_TimedQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_StructQueue), MP_ROM_PTR(&cqueue_StructQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_FilteredQueue), MP_ROM_PTR(&cqueue_FilteredQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_WindowQueue), MP_ROM_PTR(&cqueue_WindowQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_MedianQueue), MP_ROM_PTR(&cqueue_MedianQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_PackedIntQueue), MP_ROM_PTR(&cqueue_PackedIntQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_CompactQueue), MP_ROM_PTR(&cqueue_CompactQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_Share),       MP_ROM_PTR(&cqueue_Share_type) },
+    { MP_ROM_QSTR(MP_QSTR_TaskQueue),   MP_ROM_PTR(&cqueue_TaskQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_BroadcastQueue), MP_ROM_PTR(&cqueue_BroadcastQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_ThreadQueue), MP_ROM_PTR(&cqueue_ThreadQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_MessageQueue), MP_ROM_PTR(&cqueue_MessageQueue_type) },
+    { MP_ROM_QSTR(MP_QSTR_Arena),       MP_ROM_PTR(&cqueue_Arena_type) },
+    { MP_ROM_QSTR(MP_QSTR_data_arena),  MP_ROM_PTR(&cqueue_data_arena_obj) },
+    { MP_ROM_QSTR(MP_QSTR_OVERWRITE),   MP_ROM_INT(CQUEUE_OVERWRITE) },
+    { MP_ROM_QSTR(MP_QSTR_REJECT),      MP_ROM_INT(CQUEUE_REJECT) },
+    { MP_ROM_QSTR(MP_QSTR_RAISE),       MP_ROM_INT(CQUEUE_RAISE) },
 };
 
 // The table above seems to have been in some odd format; make it a dictionary
@@ -4,10 +4,14 @@ This file contains code to test the classes in the cqueue C module.
 
 This file must be used with a version of MicroPython 
 """
+import array
 import gc
 import cqueue
 import utime
 import random
+import struct
+import select
+import micropython
 from micropython import const
 
 TEST_SIZE = const (2000)
@@ -60,6 +64,364 @@ def main(run_number):
         if ((float (ink0) - foof0) / foof0) > 0.001:
             print (f"Error: {ink0} != {foof0}")
 
+    # Move the same data in bulk, through the buffer protocol
+    ints_in = array.array ('i', range (TEST_SIZE))
+    ints_out = array.array ('i', range (TEST_SIZE))
+    floats_out = array.array ('f', range (TEST_SIZE))
+    begin = utime.ticks_us ()
+    inky.put_many (ints_in)
+    foof.put_many (ints_in)
+    bulk_dur = utime.ticks_diff (utime.ticks_us (), begin)
+    if inky.get_into (ints_out) != TEST_SIZE or ints_out != ints_in:
+        print ("Error: IntQueue bulk data doesn't match")
+    if foof.get_into (floats_out) != TEST_SIZE \
+            or any (floats_out[n] != n for n in range (TEST_SIZE)):
+        print ("Error: FloatQueue bulk data doesn't match")
+
+    # Getting items one at a time into a preallocated array mustn't allocate
+    # any memory, even for floats, so it must work with the heap locked
+    slot = array.array ('f', [0.0])
+    for index in range (10):
+        foof.put (index * 0.25)
+    micropython.heap_lock ()
+    alloc_before = gc.mem_alloc ()
+    num_got = 0
+    while foof.get_into (slot, 0):
+        num_got += 1
+    alloc_after = gc.mem_alloc ()
+    micropython.heap_unlock ()
+    if num_got != 10 or alloc_after != alloc_before or slot[0] != 2.25:
+        print (f"Error: get_into(slot, 0) got {num_got} items and allocated "
+               + f"{alloc_after - alloc_before} bytes")
+
+    # A queue of 16-bit items holds the same data in half the memory
+    shorty = cqueue.TypedQueue ('h', TEST_SIZE)
+    for index in range (TEST_SIZE):
+        shorty.put (index - TEST_SIZE // 2)
+    for index in range (TEST_SIZE):
+        if shorty.get () != index - TEST_SIZE // 2:
+            print ("Error: TypedQueue('h') data doesn't match")
+            break
+
+    # Views of a wrapped queue must show the items in order, without copying
+    for index in range (TEST_SIZE + 7):
+        shorty.put (index)
+    viewed = [item for view in shorty.views () for item in view]
+    if viewed != list (range (7, TEST_SIZE + 7)) \
+            or list (shorty.linearize ()) != viewed \
+            or bytes (shorty) != bytes (array.array ('h', viewed)):
+        print ("Error: TypedQueue views don't match")
+    shorty.clear ()
+
+    # Time stamps from a TimedQueue should never go backwards
+    timed = cqueue.TimedQueue (TEST_SIZE)
+    begin = utime.ticks_us ()
+    for index in range (TEST_SIZE):
+        timed.put (index)
+    timed_dur = utime.ticks_diff (utime.ticks_us (), begin)
+    # Stamps are as wide as the port's ticks, which are wider than 32 bits on
+    # 64-bit ports such as the unix port
+    wide_ticks = utime.ticks_add (0, -1) >= 2 ** 32
+    times = array.array ('Q' if wide_ticks else 'I', range (TEST_SIZE))
+    if timed.get_into (times, ints_out) != TEST_SIZE \
+            or ints_out != ints_in \
+            or utime.ticks_diff (times[0], begin) < 0 \
+            or any (utime.ticks_diff (times[n + 1], times[n]) < 0
+                    for n in range (TEST_SIZE - 1)):
+        print ("Error: TimedQueue data or times don't match")
+
+    # Records with several fields go in with one call and come out packed
+    logger = cqueue.StructQueue ('<Iffh', TEST_SIZE)
+    record = bytearray (logger.record_size ())
+    for index in range (TEST_SIZE):
+        logger.put (index, index * 0.5, -index, index - TEST_SIZE // 2)
+    for index in range (TEST_SIZE):
+        if logger.get_into (record) != 1 or struct.unpack ('<Iffh', record) \
+                != (index, index * 0.5, -index, index - TEST_SIZE // 2):
+            print ("Error: StructQueue record doesn't match")
+            break
+
+    # Each overflow policy must keep the right items and count what it lost
+    for policy in (cqueue.OVERWRITE, cqueue.REJECT, cqueue.RAISE):
+        policed = cqueue.TypedQueue ('i', 10, overflow=policy)
+        raised = False
+        try:
+            policed.put_many (ints_in[:15])
+        except OverflowError:
+            raised = True
+        expected = {cqueue.OVERWRITE : (15, 0, 0, 5),
+                    cqueue.REJECT : (10, 0, 5, 0),
+                    cqueue.RAISE : (0, 0, 15, 0)}[policy]
+        if policed.counters (True) != expected \
+                or raised != (policy == cqueue.RAISE) \
+                or policed.counters () != (0, 0, 0, 0):
+            print (f"Error: overflow policy {policy} counts don't match")
+
+    # A block put into a queue must be counted as its items would be if they
+    # were put one at a time, whether it's copied or converted
+    for source in (ints_in[:25], array.array ('h', range (25))):
+        looped = cqueue.TypedQueue ('i', 10)
+        blocked = cqueue.TypedQueue ('i', 10)
+        for queue in (looped, blocked):
+            queue.put (-1)
+            queue.put (-2)
+        for value in source:
+            looped.put (value)
+        blocked.put_many (source)
+        if blocked.counters () != looped.counters () \
+                or [blocked.get () for n in range (10)] \
+                != [looped.get () for n in range (10)]:
+            print ("Error: put_many() and put() count items differently")
+
+    # An item which can't be converted mustn't push the oldest one out of a
+    # full queue or be counted as an overwrite
+    for policy in (cqueue.OVERWRITE, cqueue.REJECT, cqueue.RAISE):
+        policed = cqueue.TypedQueue ('h', 3, overflow=policy)
+        for index in range (3):
+            policed.put (index)
+        try:
+            policed.put ("not a number")
+            print (f"Error: overflow policy {policy} took a string")
+        except TypeError:
+            pass
+        if policed.counters () != (3, 0, 0, 0) \
+                or [policed.get () for _ in range (3)] != [0, 1, 2]:
+            print (f"Error: overflow policy {policy} lost an item to a bad one")
+
+    # Statistics kept in C must cover items which were overwritten too
+    measured = cqueue.FloatQueue (100, stats=True)
+    for index in range (TEST_SIZE):
+        measured.put (float (index))
+    count, mean, variance, low, high = measured.stats ()
+    if count != TEST_SIZE or abs (mean - (TEST_SIZE - 1) / 2) > 0.01 \
+            or abs (variance / (TEST_SIZE * (TEST_SIZE + 1) / 12) - 1) > 0.001 \
+            or low != 0.0 or high != TEST_SIZE - 1:
+        print (f"Error: FloatQueue statistics {measured.stats ()} are wrong")
+
+    # Statistics of items put in a block are those of the values stored, and
+    # cover items which were overwritten, as when they're put one at a time
+    measured = cqueue.TypedQueue ('b', 2, stats=True)
+    measured.put_many (array.array ('h', [1, 2, 300]))
+    if measured.stats ()[0] != 3 or measured.stats ()[3:] != (1.0, 44.0):
+        print (f"Error: put_many() statistics {measured.stats ()} are wrong")
+
+    # A moving average of a ramp, decimated, is the ramp delayed a bit
+    smoothed = cqueue.FilteredQueue (TEST_SIZE, fir=[0.25] * 4, decimate=5)
+    smoothed.put_many (ints_in)
+    if smoothed.available () != TEST_SIZE // 5 \
+            or any (abs (smoothed.get () - (5 * n + 2.5)) > 0.01
+                    for n in range (TEST_SIZE // 5)):
+        print ("Error: FilteredQueue output doesn't match")
+
+    # The window's statistics must match a scan of the last items put
+    windowed = cqueue.WindowQueue ('h', 16, window=50)
+    recent = []
+    for index in range (TEST_SIZE):
+        value = random.randint (-1000, 1000)
+        windowed.put (value)
+        recent = (recent + [value])[-50:]
+        if windowed.window_min () != min (recent) \
+                or windowed.window_max () != max (recent) \
+                or abs (windowed.window_mean () - sum (recent) / len (recent)) \
+                > 0.01:
+            print ("Error: WindowQueue statistics don't match")
+            break
+
+    # Encoder counts beyond the 24 bits of a float must come back exactly
+    counted = cqueue.WindowQueue ('q', 4, window=3)
+    for value in (2 ** 40 + 3, 2 ** 40 + 1, 2 ** 40 + 2):
+        counted.put (value)
+    if counted.window_min () != 2 ** 40 + 1 \
+            or counted.window_max () != 2 ** 40 + 3:
+        print ("Error: WindowQueue rounds large integers")
+
+    # Percentiles of the window must match those of the sorted recent items
+    sorter = cqueue.MedianQueue ('i', 16, window=51)
+    recent = []
+    for index in range (TEST_SIZE):
+        value = random.randint (-1000, 1000)
+        sorter.put (value)
+        recent = (recent + [value])[-51:]
+        ordered = sorted (recent)
+        if sorter.percentile (0) != ordered[0] \
+                or sorter.percentile (100) != ordered[-1] \
+                or (len (ordered) % 2
+                    and sorter.median () != ordered[len (ordered) // 2]):
+            print ("Error: MedianQueue percentiles don't match")
+            break
+
+    # A median filter removes single spikes from a signal
+    despiked = cqueue.MedianQueue ('h', 10, window=3, filter=True)
+    for value in (1, 2, 100, 4, 5, -90, 7, 8):
+        despiked.put (value)
+    if [despiked.get () for n in range (8)] != [1, 1, 2, 4, 5, 4, 5, 7]:
+        print ("Error: MedianQueue filter output doesn't match")
+
+    # A median filter of integers beyond the 24 bits of a float puts out only
+    # values which were put, and percentiles on a value are exact integers
+    despiked = cqueue.MedianQueue ('i', 10, window=3, filter=True)
+    for value in (2 ** 24 + 5, 2 ** 24 + 1, 2 ** 24 + 3):
+        despiked.put (value)
+    if [despiked.get () for n in range (3)] \
+            != [2 ** 24 + 5, 2 ** 24 + 1, 2 ** 24 + 3] \
+            or despiked.median () != 2 ** 24 + 3 \
+            or despiked.percentile (0) != 2 ** 24 + 1:
+        print ("Error: MedianQueue rounds large integers")
+
+    # Slowly changing counts must come back unchanged in far fewer bytes
+    packed = cqueue.PackedIntQueue (2 * TEST_SIZE)
+    counts = array.array ('i', range (TEST_SIZE))
+    for index in range (1, TEST_SIZE):
+        counts[index] = counts[index - 1] + random.randint (-20, 20)
+    packed.put_many (counts)
+    unpacked = array.array ('i', range (TEST_SIZE))
+    if packed.available () != TEST_SIZE \
+            or packed.bytes_used () > TEST_SIZE + TEST_SIZE // 8 \
+            or packed.get_into (unpacked) != TEST_SIZE or unpacked != counts:
+        print ("Error: PackedIntQueue data doesn't match")
+
+    # Compact formats must keep values to within one step and clip the rest
+    for format in ('q15', 'q31', 'f16'):
+        compact = cqueue.CompactQueue (format, TEST_SIZE + 1, scale=50.0)
+        for index in range (TEST_SIZE):
+            compact.put (index * 0.025 - 25.0)
+        compact.put (1000.0)
+        step = 50.0 / 1024 if format == 'f16' else compact.scale ()[1]
+        values = array.array ('f', range (TEST_SIZE))
+        if compact.get_into (values) != TEST_SIZE \
+                or any (abs (values[n] - (n * 0.025 - 25.0)) > step
+                        for n in range (TEST_SIZE)) \
+                or compact.get () < 49.9:
+            print (f"Error: CompactQueue('{format}') values don't match")
+
+    # A share's value, record and version must track what was put
+    shared = cqueue.Share ('<hIf')
+    for index in range (TEST_SIZE):
+        shared.put (-index, index, index * 0.5)
+    if shared.get () != (-(TEST_SIZE - 1), TEST_SIZE - 1, (TEST_SIZE - 1) * 0.5) \
+            or shared.version () != TEST_SIZE \
+            or shared.get_new (TEST_SIZE) is not None \
+            or shared.get_new (0)[0] != TEST_SIZE:
+        print ("Error: Share data or version doesn't match")
+
+    # A TaskQueue must act like task_share.Queue, full of 32-bit items
+    tasked = cqueue.TaskQueue ('L', 10, thread_protect=True, name="Test")
+    for index in range (15):
+        if not tasked.full ():
+            tasked.put (index * 100000)
+    if tasked.num_in () != 10 or tasked.empty () \
+            or [tasked.get () for n in range (10)] \
+            != [n * 100000 for n in range (10)] \
+            or not tasked.empty () or str (tasked).split ()[0] != "Test":
+        print ("Error: TaskQueue data doesn't match")
+
+    # Queue data goes into the data arena whenever there's room for it there
+    size, used, largest = cqueue.data_arena ()
+    if largest > 200:
+        arena_queue = cqueue.TypedQueue ('b', 100)
+        if cqueue.data_arena ()[1] < used + 100:
+            print ("Error: queue data isn't in the data arena")
+
+    # Queues made and closed over and over must give an arena all its memory
+    # back, whatever their sizes, so a big queue still fits afterward
+    arena = cqueue.Arena (16 * 1024)
+    sizes = (1000, 37, 500, 3, 250, 1500)
+    for index in range (100):
+        made = [cqueue.IntQueue (size, arena=arena) for size in sizes[:3]]
+        made.append (cqueue.TypedQueue ('d', sizes[index % 6] // 2,
+                                        arena=arena))
+        for queue in made:
+            queue.put (index)
+            queue.close ()
+    size, used, largest, num_blocks, max_used, num_fails = arena.stats ()
+    if used != 0 or num_blocks != 0 or num_fails != 0 \
+            or cqueue.IntQueue (2000, arena=arena).available () != 0:
+        print (f"Error: Arena stats {arena.stats ()} show memory wasn't freed")
+
+    # ByteQueues put and get many bytes at once, across the wrap point
+    byte_queue = cqueue.ByteQueue (8)
+    byte_queue.put ("abcdef")
+    byte_queue.get (4)
+    byte_queue.put (b"GHIJ")
+    into = bytearray (3)
+    if byte_queue.peek (3) != b"efG" or byte_queue.get () != b"e" \
+            or byte_queue.readinto (into) != 3 or into != b"fGH" \
+            or byte_queue.get (10) != b"IJ" or byte_queue.get (2) != b"":
+        print ("Error: ByteQueue bulk put or get failed")
+
+    # A ByteQueue is a stream which print() can write and select can poll
+    stream_queue = cqueue.ByteQueue (16, overflow=cqueue.REJECT)
+    poller = select.poll ()
+    poller.register (stream_queue, select.POLLIN)
+    if poller.poll (0):
+        print ("Error: an empty ByteQueue polls as readable")
+    print ("Run", run_number, file=stream_queue)
+    line = f"Run {run_number}\n".encode ()
+    if not poller.poll (0) or stream_queue.readline () != line \
+            or stream_queue.read () is not None:
+        print ("Error: ByteQueue doesn't work as a stream")
+
+    # Watermark callbacks are scheduled once as the queue fills past the high
+    # mark and once as it empties past the low one
+    fired = []
+    mark_queue = cqueue.IntQueue (8)
+    mark_queue.watermarks (high=4, on_high=fired.append, low=1,
+                           on_low=fired.append)
+    for index in range (6):
+        mark_queue.put (index)
+    while mark_queue.available () > 1:
+        mark_queue.get ()
+    # Scheduled callbacks run soon but not at once, so wait a little for them
+    deadline = utime.ticks_add (utime.ticks_ms (), 100)
+    while len (fired) < 2 \
+            and utime.ticks_diff (deadline, utime.ticks_ms ()) > 0:
+        utime.sleep_ms (1)
+    if len (fired) != 2 or fired[0] is not mark_queue:
+        print (f"Error: {len (fired)} watermark callbacks instead of 2")
+    mark_queue.watermarks (high=2, on_high=fired.append, arg="high")
+    mark_queue.put (6)
+    deadline = utime.ticks_add (utime.ticks_ms (), 100)
+    while len (fired) < 3 \
+            and utime.ticks_diff (deadline, utime.ticks_ms ()) > 0:
+        utime.sleep_ms (1)
+    if fired[2:] != ["high"]:
+        print ("Error: a watermark callback wasn't given its argument")
+
+    # Each reader of a BroadcastQueue gets every item; one which falls behind
+    # misses the oldest ones without holding up the others
+    broadcast = cqueue.BroadcastQueue ('h', 10, 2)
+    for index in range (15):
+        broadcast.put (index)
+        if broadcast.get (0) != index:
+            print ("Error: BroadcastQueue reader 0 missed an item")
+    into = array.array ('h', range (20))
+    if broadcast.get_into (1, into) != 10 or into[0] != 5 \
+            or broadcast.counters (1)[2] != 5 or broadcast.any (0):
+        print (f"Error: BroadcastQueue reader 1 got {into[:10]}")
+
+    # A ThreadQueue's size is rounded up to a power of two; a put into a full
+    # one or a get from an empty one gives up when its timeout runs out
+    shared = cqueue.ThreadQueue ('i', 6)
+    for index in range (8):
+        shared.put (index)
+    if not shared.full () or shared.put (8, 0) or shared.put (8, 5):
+        print ("Error: ThreadQueue put into a full queue")
+    if [shared.get () for _ in range (8)] != list (range (8)) \
+            or shared.get (0) is not None or shared.counters ()[2] != 2:
+        print ("Error: ThreadQueue items or counters are wrong")
+
+    # A MessageQueue keeps messages whole, throwing away the oldest ones
+    # when a new one doesn't fit
+    messages = cqueue.MessageQueue (24)
+    for text in (b"one", b"", b"three", b"four", b"five"):
+        messages.put (text)
+    into = bytearray (messages.max_len ())
+    got = []
+    while messages.peek_len () is not None:
+        got.append (bytes (into[:messages.get_into (into)]))
+    if got != [b"three", b"four", b"five"] or messages.counters ()[3] != 2:
+        print (f"Error: MessageQueue gave {got}")
+
     print (f"Memory after test run #{run_number}: {gc.mem_free ()}")
     print (f"Ints:   Num {len(int_durs)},"
            + f" Avg {sum(int_durs) / len(int_durs):.1f},"
@@ -70,6 +432,8 @@ def main(run_number):
     print (f"Nones:  Num {len(none_durs)},"
            + f" Avg {sum(none_durs) / len(none_durs):.1f},"
            + f" Max {max (none_durs)}")
+    print (f"Bulk:   Num {2 * TEST_SIZE}, Total {bulk_dur}")
+    print (f"Timed:  Num {TEST_SIZE}, Total {timed_dur}")
 
 
 for count in range (100):
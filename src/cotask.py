@@ -11,6 +11,7 @@
 #  @author JR Ridgely
 #  @date   2017-Jan-01 JRR Approximate date of creation of file
 #  @date   2021-Dec-18 JRR Docstrings modified to work without DoxyPyPy
+#  @date   2026-Oct-16 @c go() can be a cqueue watermark callback
 #  @copyright This program is copyright (c) 2017-2023 by JR Ridgely and
 #             released under the GNU Public License, version 3.0.
 # 
@@ -257,8 +258,11 @@ class Task:
 
     ## Method to set a flag so that this task indicates that it's ready to run.
     #  This method may be called from an interrupt service routine or from
-    #  another task which has data that this task needs to process soon.
-    def go(self):
+    #  another task which has data that this task needs to process soon. It
+    #  can also be given to a cqueue queue's @c watermarks() method, which
+    #  calls it with the queue as an argument that isn't needed here.
+    #  @param source The object which is waking the task, which is ignored
+    def go(self, source=None):
         self.go_flag = True
 
 
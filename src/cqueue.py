@@ -5,8 +5,9 @@ used in the ME405 library. These queues are faster than regular Python based
 queues and don't allocate memory.
 
 The code in this file is @b not the source code which makes the C queues work.
-That code is written in C as the file @c cqueues.c and compiled into the
-MicroPython image used in the ME405 course. 
+That code is written in C as the file @c cqueue.c, in directory
+@c custom_micropython/modules/cqueue, and compiled into the MicroPython image
+used in the ME405 course.
 
 @author JR Ridgely
 @date   2022-Feb-24 JRR Original file
@@ -30,15 +31,282 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 # directly documented by Doxygen.
 if __name__ == "__not_me__":
 
+    ## Overflow policy: putting into a full queue overwrites the oldest item
+    OVERWRITE = 0
+
+    ## Overflow policy: putting into a full queue drops the new item
+    REJECT = 1
+
+    ## Overflow policy: putting into a full queue raises an @c OverflowError
+    RAISE = 2
+
+    def data_arena() -> tuple:
+        """!
+        @brief   Report the use of the arena which holds the data of queues.
+        @details The data of queues is kept in a block of memory set aside
+                 for it, so the garbage collector doesn't spend time scanning
+                 samples or mistake them for pointers which keep garbage
+                 alive. A queue which doesn't fit in the arena keeps its data
+                 in the heap; its data is given back to the arena when the
+                 queue is collected. The arena's size is set when MicroPython
+                 is built, with @c MICROPY_CQUEUE_DATA_ARENA_SIZE. It's zero
+                 unless the board or build sets it, as memory set aside for
+                 the arena can't be used by the heap, even in programs which
+                 make no queues.
+        @returns A tuple @c (size, used, largest_free) in bytes, all zero if
+                 there's no arena
+        """
+
+    class TypedQueue:
+        """!
+        @brief   A fast, pre-allocated queue of numbers of any array type.
+        @details This class is written in C for speed. Its items are stored
+                 in the same format as those in an @c array.array with the
+                 same type code, so a queue of 16-bit ADC readings made with
+                 type code @c 'h' takes half the memory of an IntQueue. The
+                 type codes @c b, @c B, @c h, @c H, @c i, @c I, @c l, @c L,
+                 @c q, @c Q, @c f, and @c d are supported. IntQueue,
+                 FloatQueue, and ByteQueue are TypedQueues with type codes
+                 @c 'i', @c 'f', and @c 'B'.
+
+                 Writing into a full queue causes the oldest data to be erased
+                 unless the queue is made with another overflow policy.
+                 Integers which don't fit in the queue's type are truncated:
+                 @code
+                 adc_queue = cqueue.TypedQueue('H', 256)
+                 adc_queue.put(adc.read_u16())  # Or in an interrupt callback
+                 ...
+                 while adc_queue.any():
+                     print(adc_queue.get())
+                 @endcode
+        """
+
+        def __init__(self, typecode : str, size : int, *,
+                     spsc : bool = False, overflow : int = None,
+                     arena = None, stats : bool = False):
+            """!
+            @brief   Create a fast queue for numbers of the given type.
+            @details When the queue is created, memory is allocated for the
+                     given number of items. Putting items into the queue won't
+                     cause new memory to be allocated, so the queue can be used
+                     in interrupt callbacks and will run quickly. Queues whose
+                     sizes are powers of two are a bit faster.
+            @param   typecode A one character string with the @c array type
+                     code of the items, such as @c 'h' or @c 'f'
+            @param   size The maximum number of items that the queue can hold
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, which may be in different threads
+                     or interrupt callbacks, and no locking is needed. In this
+                     mode, putting items into a full queue drops the new items
+                     rather than overwriting the oldest ones
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            @param   stats If @c True, the count, mean, variance, minimum
+                     and maximum of the items put are kept in C; see
+                     @c stats()
+            """
+
+        def close():
+            """!
+            @brief   Give the queue's memory back to the Arena or the data
+                     arena it came from, now rather than when the queue is
+                     collected. The queue is left empty, and putting items
+                     into it raises @c ValueError. Every queue class has this
+                     method.
+            """
+
+        def watermarks(*, high : int = None, on_high = None, low : int = 0,
+                       on_low = None, arg = None):
+            """!
+            @brief   Set functions to be scheduled when the queue fills to a
+                     high watermark or empties to a low one.
+            @details When a put takes the number of items in the queue from
+                     below @c high to @c high or more, @c on_high is
+                     scheduled with @c micropython.schedule(); when a get
+                     takes it from above @c low to @c low or less, @c on_low
+                     is. Each function is called soon afterward, outside of
+                     any interrupt, with @c arg as its argument. A
+                     consumer task can then run only when there's a batch of
+                     data worth processing:
+                     @code
+                     queue.watermarks(high=32, on_high=consumer_task.go)
+                     @endcode
+                     If MicroPython's list of scheduled functions is full, a
+                     callback is missed. Calling this method with no
+                     callbacks turns them off. Every queue class has this
+                     method; a PackedIntQueue counts values, not bytes.
+            @param   high The high watermark, from 1 to the size of the queue,
+                     which is the default
+            @param   on_high A function to be scheduled at the high watermark,
+                     or @c None for none
+            @param   low The low watermark, which must be less than @c high
+            @param   on_low A function to be scheduled at the low watermark,
+                     or @c None for none
+            @param   arg The argument given to the functions, or @c None to
+                     give them the queue
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Checks if there are any items available in the queue.
+            @returns @c True if there is at least one item in the queue,
+                     @c False if not
+            """
+
+        def available() -> int:
+            """!
+            @brief   Checks how many items are available to be read from the
+                     queue.
+            @returns An integer containing the number of items in the queue
+            """
+
+        def put(data):
+            """!
+            @brief   Put a number into the queue.
+            @details If the queue is already full, the oldest data will be
+                     overwritten.
+            @param   data An integer or float to be put into the queue
+            """
+
+        def get():
+            """!
+            @brief   Get an item from the queue if one is available.
+            @returns The oldest item in the queue, or @c None if the queue
+                     is currently empty.
+            """
+
+        def clear():
+            """!
+            @brief   Empty the queue.
+            """
+
+        def full() -> bool:
+            """!
+            @brief   Check whether the queue is currently full.
+            @returns @c True if the queue is currently full or @c False if not
+            """
+
+        def max_full() -> int:
+            """!
+            @brief   Get the maximum number of unread items that have been in
+                     the queue since it was created or cleared.
+            @return  The maximum number of items that have been in the queue
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+        def stats() -> tuple:
+            """!
+            @brief   Get statistics of the items put into the queue.
+            @details The statistics are updated in C by @c put() and
+                     @c put_many(), so they cover every item put since the
+                     queue was made or @c reset_stats() was called, even
+                     items which were overwritten before being read. A
+                     monitoring task can get averages and extremes without
+                     calling @c get() on each item. The queue must have been
+                     made with @c stats=True.
+            @returns A tuple @c (count, mean, variance, min, max), where
+                     the variance is that of a sample; the last four are
+                     @c None if nothing has been put
+            """
+
+        def reset_stats():
+            """!
+            @brief   Start the statistics over from no items.
+            @details This should not be called while an interrupt callback
+                     may be putting items into the queue.
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put all the items from a buffer into the queue at once.
+            @details If the buffer is an @c array.array with the same type
+                     code as the queue, its items are copied with at most two
+                     calls to @c memcpy().
+            @param   buf An object supporting the buffer protocol
+            """
+
+        def get_into(buf, index : int = None) -> int:
+            """!
+            @brief   Move as many items as will fit from the queue into a
+                     preallocated buffer.
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array, which receives the oldest items
+            @param   index If given, only the oldest item is taken and it's
+                     written into @c buf at this index. This gets an item
+                     without allocating memory even for floats, so it can be
+                     used while the heap is locked:
+                     @code
+                     slot = array.array('f', [0.0])
+                     while my_queue.get_into(slot, 0):
+                         use(slot[0])
+                     @endcode
+            @returns The number of items which were put into the buffer
+            """
+
+        def views() -> tuple:
+            """!
+            @brief   Get memoryviews of the items in the queue without
+                     copying or removing them.
+            @details The items are usually in two pieces, one at the end of
+                     the queue's memory and one at the beginning, so up to two
+                     views are returned, oldest items first. Each can be given
+                     to @c ulab.numpy.frombuffer(). The views are only valid
+                     until more items are put into the queue, and only while
+                     the queue is kept. Unlike data in the heap, data in the
+                     data arena or an @c Arena isn't kept alive by a view;
+                     once the queue is collected or closed, its memory may be
+                     given to another queue:
+                     @code
+                     total = sum(sum(np.frombuffer(v, dtype=np.int16))
+                                 for v in adc_queue.views())
+                     @endcode
+            @returns A tuple of zero, one, or two memoryviews
+            """
+
+        def linearize() -> memoryview:
+            """!
+            @brief   Rearrange the queue's memory so that its items are in one
+                     block, oldest first, and get a view of them.
+            @details The queue is rotated in place, so no memory is needed
+                     for a copy. This must not be run while an interrupt
+                     callback or another thread may put items into the queue.
+                     A queue can also be passed directly to anything which
+                     accepts the buffer protocol, such as
+                     @c ulab.numpy.frombuffer(); it is linearized first.
+            @returns A memoryview of all the items in the queue
+            """
+
+
     class FloatQueue:
         """!
         @brief   A fast, pre-allocated queue of floats for MicroPython.
-        @details This class is written in C for speed. When a FloatQueue
-                 object is created, memory is allocated to hold the given
-                 number of items. Data is put into the queue with its put()
-                 method, and the oldest available data is retrieved with the
-                 get() method. Because running put() and get() doesn't
-                 allocate any memory, it can be used in interrupt callbacks. 
+        @details This class is written in C for speed; it is a TypedQueue
+                 with type code @c 'f'. When a FloatQueue object is created,
+                 memory is allocated to hold the given number of items. Data
+                 is put into the queue with its put() method, and the oldest
+                 available data is retrieved with the get() method. Because
+                 running put() and get() doesn't allocate any memory, it can
+                 be used in interrupt callbacks. 
 
                  When one creates a queue, one specifies the number of items
                  which can be stored at once in the queue. After creating a
@@ -59,14 +327,34 @@ if __name__ == "__not_me__":
                  @endcode
         """
 
-        def __init__(self, size : int):
+        def __init__(self, size : int, *, spsc : bool = False,
+                     overflow : int = None, arena = None,
+                     stats : bool = False):
             """!
             @brief   Create a fast queue for floats.
             @details When the queue is created, memory is allocated for the
                      given number of items. Putting items into the queue won't
                      cause new memory to be allocated, so the queue can be used
-                     in interrupt callbacks and will run quickly.
+                     in interrupt callbacks and will run quickly. Queues whose
+                     sizes are powers of two, such as 256 or 1024, are a bit
+                     faster, as their indices wrap around with a mask.
             @param   size The maximum number of floats that the queue can hold
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, which may be in different threads
+                     or interrupt callbacks, and no locking is needed. In this
+                     mode, putting items into a full queue drops the new items
+                     rather than overwriting the oldest ones
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            @param   stats If @c True, the count, mean, variance, minimum
+                     and maximum of the items put are kept in C; see
+                     @c stats()
             """
 
         def any() -> bool:
@@ -96,7 +384,10 @@ if __name__ == "__not_me__":
         def get() -> float:
             """!
             @brief   Get an item from the queue if one is available.
-            @details If the queue is empty, @c None will be returned.
+            @details If the queue is empty, @c None will be returned. Each
+                     float returned is a new object, so calling this
+                     allocates memory; use @c get_into(buf, index) to get
+                     items without allocating.
             @returns The oldest float in the queue, or @c None if the queue
                      is currently empty.
             """
@@ -127,16 +418,92 @@ if __name__ == "__not_me__":
             @return  The maximum number of items that have been in the queue
             """
 
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+        def stats() -> tuple:
+            """!
+            @brief   Get statistics of the items put into the queue.
+            @details The statistics are updated in C by @c put() and
+                     @c put_many(), so they cover every item put since the
+                     queue was made or @c reset_stats() was called, even
+                     items which were overwritten before being read. A
+                     monitoring task can get averages and extremes without
+                     calling @c get() on each item. The queue must have been
+                     made with @c stats=True.
+            @returns A tuple @c (count, mean, variance, min, max), where
+                     the variance is that of a sample; the last four are
+                     @c None if nothing has been put
+            """
+
+        def reset_stats():
+            """!
+            @brief   Start the statistics over from no items.
+            @details This should not be called while an interrupt callback
+                     may be putting items into the queue.
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put all the items from a buffer into the queue at once.
+            @details The buffer can be any object which supports the buffer
+                     protocol, such as an @c array.array, @c bytearray or
+                     ulab @c ndarray. If its items have the same layout as
+                     the queue's, they are copied with at most two calls to
+                     @c memcpy(); otherwise each one is converted. As with
+                     @c put(), the oldest data is overwritten if the queue
+                     becomes full.
+            @param   buf An object holding numbers to be put into the queue
+            """
+
+        def get_into(buf, index : int = None) -> int:
+            """!
+            @brief   Move as many items as will fit from the queue into a
+                     preallocated buffer.
+            @details This is much faster than calling @c get() once for each
+                     item, and no memory is allocated:
+                     @code
+                     samples = array.array('f', range(100))
+                     ...
+                     num_got = my_queue.get_into(samples)
+                     @endcode
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array, which receives the oldest items
+            @param   index If given, only the oldest item is taken and it's
+                     written into @c buf at this index. This gets an item
+                     without allocating memory even for floats, so it can be
+                     used while the heap is locked:
+                     @code
+                     slot = array.array('f', [0.0])
+                     while my_queue.get_into(slot, 0):
+                         use(slot[0])
+                     @endcode
+            @returns The number of items which were put into the buffer
+            """
+
 
     class IntQueue:
         """!
         @brief   A fast, pre-allocated queue of integers for MicroPython.
-        @details This class is written in C for speed. When an IntQueue
-                 object is created, memory is allocated to hold the given
-                 number of items. Data is put into the queue with its put()
-                 method, and the oldest available data is retrieved with the
-                 get() method. Because running put() and get() doesn't
-                 allocate any memory, it can be used in interrupt callbacks.
+        @details This class is written in C for speed; it is a TypedQueue
+                 with type code @c 'i'. When an IntQueue object is created,
+                 memory is allocated to hold the given number of items. Data
+                 is put into the queue with its put() method, and the oldest
+                 available data is retrieved with the get() method. Because
+                 running put() and get() doesn't allocate any memory, it can
+                 be used in interrupt callbacks.
                  
                  When one creates a queue, one specifies the number of items
                  which can be stored at once in the queue. After creating a
@@ -157,15 +524,35 @@ if __name__ == "__not_me__":
                  @endcode
         """
 
-        def __init__(self, size : int):
+        def __init__(self, size : int, *, spsc : bool = False,
+                     overflow : int = None, arena = None,
+                     stats : bool = False):
             """!
             @brief   Create a fast queue for integers.
             @details When the queue is created, memory is allocated for the
                      given number of items. Putting items into the queue won't
                      cause new memory to be allocated, so the queue can be used
-                     in interrupt callbacks and will run quickly.
+                     in interrupt callbacks and will run quickly. Queues whose
+                     sizes are powers of two, such as 256 or 1024, are a bit
+                     faster, as their indices wrap around with a mask.
             @param   size The maximum number of integers that the queue can
                      hold
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, which may be in different threads
+                     or interrupt callbacks, and no locking is needed. In this
+                     mode, putting items into a full queue drops the new items
+                     rather than overwriting the oldest ones
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            @param   stats If @c True, the count, mean, variance, minimum
+                     and maximum of the items put are kept in C; see
+                     @c stats()
             """
 
         def any() -> bool:
@@ -226,6 +613,81 @@ if __name__ == "__not_me__":
             @return  The maximum number of items that have been in the queue
             """
 
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+        def stats() -> tuple:
+            """!
+            @brief   Get statistics of the items put into the queue.
+            @details The statistics are updated in C by @c put() and
+                     @c put_many(), so they cover every item put since the
+                     queue was made or @c reset_stats() was called, even
+                     items which were overwritten before being read. A
+                     monitoring task can get averages and extremes without
+                     calling @c get() on each item. The queue must have been
+                     made with @c stats=True.
+            @returns A tuple @c (count, mean, variance, min, max), where
+                     the variance is that of a sample; the last four are
+                     @c None if nothing has been put
+            """
+
+        def reset_stats():
+            """!
+            @brief   Start the statistics over from no items.
+            @details This should not be called while an interrupt callback
+                     may be putting items into the queue.
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put all the items from a buffer into the queue at once.
+            @details The buffer can be any object which supports the buffer
+                     protocol, such as an @c array.array, @c bytearray or
+                     ulab @c ndarray. If its items have the same layout as
+                     the queue's, they are copied with at most two calls to
+                     @c memcpy(); otherwise each one is converted. As with
+                     @c put(), the oldest data is overwritten if the queue
+                     becomes full.
+            @param   buf An object holding integers to be put into the queue
+            """
+
+        def get_into(buf, index : int = None) -> int:
+            """!
+            @brief   Move as many items as will fit from the queue into a
+                     preallocated buffer.
+            @details This is much faster than calling @c get() once for each
+                     item, and no memory is allocated:
+                     @code
+                     samples = array.array('i', range(100))
+                     ...
+                     num_got = my_queue.get_into(samples)
+                     @endcode
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array, which receives the oldest items
+            @param   index If given, only the oldest item is taken and it's
+                     written into @c buf at this index. This gets an item
+                     without allocating memory even for floats, so it can be
+                     used while the heap is locked:
+                     @code
+                     slot = array.array('f', [0.0])
+                     while my_queue.get_into(slot, 0):
+                         use(slot[0])
+                     @endcode
+            @returns The number of items which were put into the buffer
+            """
+
     class ByteQueue:
         """!
         @brief   A fast, pre-allocated queue of characters for MicroPython.
@@ -257,15 +719,31 @@ if __name__ == "__not_me__":
                  @endcode
         """
 
-        def __init__(self, size : int):
+        def __init__(self, size : int, *, spsc : bool = False,
+                     overflow : int = None, arena = None):
             """!
             @brief   Create a fast queue for characters.
             @details When the queue is created, memory is allocated for the
                      given number of items. Putting items into the queue won't
                      cause new memory to be allocated, so the queue can be used
-                     in interrupt callbacks and will run quickly.
+                     in interrupt callbacks and will run quickly. Queues whose
+                     sizes are powers of two, such as 256 or 1024, are a bit
+                     faster, as their indices wrap around with a mask.
             @param   size The maximum number of integers that the queue can
                      hold
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, which may be in different threads
+                     or interrupt callbacks, and no locking is needed. In this
+                     mode, putting items into a full queue drops the new items
+                     rather than overwriting the oldest ones
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
             """
 
         def any() -> bool:
@@ -282,22 +760,88 @@ if __name__ == "__not_me__":
             @returns An integer containing the number of items in the queue
             """
 
-        def put(data : int):
+        def put(data):
             """!
             @brief   Put a character or string into the queue.
-            @details If the queue is already full, the oldest data will be
-                     overwritten. If this could cause problems, one can call
-                     @c full() to check if the queue is already full before
-                     writing the data.
-            @param   data An integer to be put into the back of the queue
+            @details The data can be a string or any object which supports
+                     the buffer protocol, such as @c bytes, a @c bytearray
+                     or a @c memoryview; it's copied into the queue with at
+                     most two calls to @c memcpy(). If the queue is already
+                     full, the oldest data will be overwritten, unless the
+                     overflow policy says otherwise; with @c RAISE, none of
+                     the data is put if it doesn't all fit.
+            @param   data The characters to be put into the back of the queue
             """
 
-        def get() -> int:
+        def get(n : int = None) -> bytes:
             """!
-            @brief   Get an item from the queue if one is available.
-            @details If the queue is empty, @c None will be returned.
-            @returns The oldest character in the queue, or @c None if the queue
-                     is currently empty.
+            @brief   Get one character, or up to @c n of them, from the queue.
+            @details With no argument, one character is taken, and @c None is
+                     returned if the queue is empty. Given @c n, up to @c n
+                     characters are taken at once, and an empty @c bytes
+                     object is returned if the queue is empty.
+            @param   n The largest number of characters to get, or @c None to
+                     get just one
+            @returns The oldest characters in the queue as a @c bytes object,
+                     or @c None if the queue is currently empty and @c n wasn't
+                     given
+            """
+
+        def peek(n : int) -> bytes:
+            """!
+            @brief   Look at up to @c n of the oldest characters in the queue
+                     without taking them out of it.
+            @param   n The largest number of characters to copy
+            @returns A @c bytes object, which is empty if the queue is
+            """
+
+        def readinto(buf, nbytes : int = None) -> int:
+            """!
+            @brief   Take characters from the queue and write them into a
+                     buffer, as a stream's @c readinto() does.
+            @details As many characters as are in the queue and will fit in
+                     the buffer are copied, with at most two calls to
+                     @c memcpy(), and no memory is allocated, so this method
+                     can be used in interrupt callbacks.
+            @param   buf A writable buffer such as a @c bytearray
+            @param   nbytes The largest number of characters to copy, or
+                     @c None to fill as much of the buffer as possible
+            @returns The number of characters copied into the buffer
+            """
+
+        def read(n : int = -1) -> bytes:
+            """!
+            @brief   Read up to @c n characters, as from a non-blocking stream.
+            @details A ByteQueue is a MicroPython stream, so it can be given
+                     to @c print(file=...), polled with @c select.poll, or
+                     read and written by @c asyncio streams. Reading an empty
+                     queue returns @c None; a closed queue reads as the end
+                     of the stream, @c b"".
+            @param   n The largest number of characters to read, or -1 to
+                     read everything in the queue
+            @returns The characters as a @c bytes object, or @c None if the
+                     queue is empty
+            """
+
+        def readline() -> bytes:
+            """!
+            @brief   Read characters up to and including a newline, as from
+                     a non-blocking stream.
+            @returns The characters which were read
+            """
+
+        def write(data) -> int:
+            """!
+            @brief   Write characters into the queue as into a non-blocking
+                     stream.
+            @details A queue which overwrites old data takes all the
+                     characters. Otherwise only those which fit are written,
+                     whatever the overflow policy, and nothing is dropped or
+                     raised; polling for @c select.POLLOUT shows when there's
+                     room for more.
+            @param   data A string or buffer holding the characters
+            @returns The number of characters written, or @c None if the
+                     queue is full
             """
 
         def clear():
@@ -326,6 +870,1277 @@ if __name__ == "__not_me__":
             @return  The maximum number of items that have been in the queue
             """
 
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put all the items from a buffer into the queue at once.
+            @details The buffer can be any object which supports the buffer
+                     protocol, such as an @c array.array, @c bytearray or
+                     ulab @c ndarray. If its items have the same layout as
+                     the queue's, they are copied with at most two calls to
+                     @c memcpy(); otherwise each one is converted. As with
+                     @c put(), the oldest data is overwritten if the queue
+                     becomes full.
+            @param   buf An object holding bytes to be put into the queue
+            """
+
+        def get_into(buf, index : int = None) -> int:
+            """!
+            @brief   Move as many items as will fit from the queue into a
+                     preallocated buffer.
+            @details This is much faster than calling @c get() once for each
+                     item, and no memory is allocated:
+                     @code
+                     samples = array.array('B', range(100))
+                     ...
+                     num_got = my_queue.get_into(samples)
+                     @endcode
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array, which receives the oldest items
+            @param   index If given, only the oldest item is taken and it's
+                     written into @c buf at this index. This gets an item
+                     without allocating memory even for floats, so it can be
+                     used while the heap is locked:
+                     @code
+                     slot = array.array('f', [0.0])
+                     while my_queue.get_into(slot, 0):
+                         use(slot[0])
+                     @endcode
+            @returns The number of items which were put into the buffer
+            """
+
+    class TimedQueue:
+        """!
+        @brief   A fast, pre-allocated queue which records the time at which
+                 each item was put into it.
+        @details This class is written in C for speed. Each call to put()
+                 stores the value along with the result of
+                 @c time.ticks_us() at that moment, read in C, so an
+                 interrupt callback needs only one call to save a value and
+                 its time. Times and values are kept together in one record,
+                 so they can't get out of step when old data is overwritten.
+                 Records are read back one at a time with get() or all at
+                 once, without allocating memory, with get_into():
+                 @code
+                 enc_queue = cqueue.TimedQueue(256)
+                 enc_queue.put(encoder.counter())  # In interrupt callback
+                 ...
+                 times = array.array('I', range(256))
+                 counts = array.array('i', range(256))
+                 num_got = enc_queue.get_into(times, counts)
+                 @endcode
+                 On a 64-bit port such as the unix port, the times need an
+                 array of type @c 'Q', as they are wider than 32 bits there.
+        """
+
+        def __init__(self, size : int, typecode : str = 'i', *,
+                     spsc : bool = False, overflow : int = None):
+            """!
+            @brief   Create a queue of time stamped values.
+            @details Each time stamp is an unsigned integer which wraps
+                     around with the same period as @c time.ticks_us() on the
+                     port, 2 ** 30 on a 32-bit board and 2 ** 62 on a 64-bit
+                     port, so use @c time.ticks_diff() to find time
+                     differences. A stamp takes one machine word, and each
+                     value takes as much memory as its stamp, so most records
+                     take eight bytes on a board.
+            @param   size The maximum number of records the queue can hold
+            @param   typecode The @c array type code of the values, such as
+                     @c 'i' or @c 'f'
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting a record into a full
+                     queue drops the new record
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(data):
+            """!
+            @brief   Put a value and the present time into the queue.
+            @details If the queue is already full, the oldest record will be
+                     overwritten.
+            @param   data A number to be put into the queue
+            """
+
+        def get() -> tuple:
+            """!
+            @brief   Get the oldest record from the queue.
+            @details This allocates a tuple, so it shouldn't be used in an
+                     interrupt callback; use get_into() if memory matters.
+            @returns A tuple @c (time, value), or @c None if the queue is empty
+            """
+
+        def get_into(times, values) -> int:
+            """!
+            @brief   Move as many records as will fit from the queue into two
+                     preallocated buffers.
+            @details Copying is fastest if @c times is an @c array.array of
+                     type @c 'I', or @c 'Q' on a 64-bit port, and @c values
+                     has the queue's type code. Stamps put into an array of
+                     narrower integers lose their high bits, and then can't be
+                     compared with @c time.ticks_diff().
+            @param   times A buffer, such as an @c array.array, which
+                     receives the time stamps
+            @param   values A buffer which receives the values
+            @returns The number of records which were read
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Checks if there are any records available in the queue.
+            @returns @c True if there is at least one record in the queue
+            """
+
+        def available() -> int:
+            """!
+            @brief   Checks how many records are in the queue.
+            @returns The number of records in the queue
+            """
+
+        def clear():
+            """!
+            @brief   Empty the queue.
+            """
+
+        def full() -> bool:
+            """!
+            @brief   Check whether the queue is currently full.
+            @returns @c True if the queue is currently full or @c False if not
+            """
+
+        def max_full() -> int:
+            """!
+            @brief   Get the maximum number of records that have been in the
+                     queue since it was created or cleared.
+            @return  The maximum number of records that have been in the queue
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+    class StructQueue:
+        """!
+        @brief   A fast, pre-allocated queue of records with several fields.
+        @details This class is written in C for speed. Each record is packed
+                 into the queue's memory as @c struct.pack() would pack it,
+                 so a record holding a time, a position, a velocity and a
+                 duty cycle is put with one call and can't get out of step
+                 with the others as separate queues could:
+                 @code
+                 log_queue = cqueue.StructQueue('Iffh', 500)
+                 log_queue.put(utime.ticks_us(), pos, vel, duty)
+                 ...
+                 record = bytearray(log_queue.record_size())
+                 while log_queue.get_into(record):
+                     print(struct.unpack('Iffh', record))
+                 @endcode
+        """
+
+        def __init__(self, format : str, size : int, *, spsc : bool = False,
+                     overflow : int = None):
+            """!
+            @brief   Create a queue of records with the given format.
+            @details The format is like that of the @c struct module: an
+                     optional byte order character, @c @, @c =, @c <, @c >,
+                     or @c !, followed by fields made of an optional repeat
+                     count and one of the type codes @c b, @c B, @c h, @c H,
+                     @c i, @c I, @c l, @c L, @c q, @c Q, @c f, or @c d. With
+                     native order, records are padded so each is aligned.
+            @param   format The format of each record, such as @c 'Iffh'
+            @param   size The maximum number of records the queue can hold
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting a record into a full
+                     queue drops the new record
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(*fields):
+            """!
+            @brief   Put one record into the queue.
+            @details If the queue is already full, the oldest record will be
+                     overwritten. No memory is allocated.
+            @param   fields The values of the record's fields, one argument
+                     for each field in the format
+            """
+
+        def get() -> tuple:
+            """!
+            @brief   Get the oldest record from the queue as a tuple.
+            @details This allocates a tuple, so it shouldn't be used in an
+                     interrupt callback.
+            @returns A tuple of the record's fields, or @c None if the queue
+                     is empty
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put packed records from a buffer into the queue.
+            @param   buf A @c bytearray or other buffer holding whole records
+                     packed with the queue's format
+            """
+
+        def get_into(buf) -> int:
+            """!
+            @brief   Move as many packed records as will fit into a buffer.
+            @details The records are copied in bulk and no memory is
+                     allocated. Use @c struct.unpack_from() to read fields.
+            @param   buf A @c bytearray or other writable buffer
+            @returns The number of records which were put into the buffer
+            """
+
+        def record_size() -> int:
+            """!
+            @brief   Get the number of bytes in each packed record.
+            @returns The size of one record in bytes
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Checks if there are any records available in the queue.
+            @returns @c True if there is at least one record in the queue
+            """
+
+        def available() -> int:
+            """!
+            @brief   Checks how many records are in the queue.
+            @returns The number of records in the queue
+            """
+
+        def clear():
+            """!
+            @brief   Empty the queue.
+            """
+
+        def full() -> bool:
+            """!
+            @brief   Check whether the queue is currently full.
+            @returns @c True if the queue is currently full or @c False if not
+            """
+
+        def max_full() -> int:
+            """!
+            @brief   Get the maximum number of records that have been in the
+                     queue since it was created or cleared.
+            @return  The maximum number of records that have been in the queue
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @details The counts are kept in C as items are put and taken, so
+                     checking them costs nothing until they're read. Drops are
+                     new items refused because the queue was full; overwrites
+                     are old items lost before being read. A block given to
+                     @c put_many() is counted as if its items were put one at
+                     a time. Unlike @c max_full(), the counts aren't reset by
+                     @c clear().
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+
+    class FilteredQueue:
+        """!
+        @brief   A queue which filters and decimates samples as they're put.
+        @details This class is written in C for speed. Each sample put into
+                 the queue goes through an FIR filter, then a chain of biquad
+                 IIR filter sections, and then only one result of every
+                 @c decimate is kept. The consumer sees only the filtered,
+                 slower stream, so less queue memory and less of the
+                 consumer's time are needed:
+                 @code
+                 vel_queue = cqueue.FilteredQueue(100, fir=[0.25] * 4,
+                                                  decimate=10)
+                 vel_queue.put(encoder_delta)   # In a timer callback
+                 ...
+                 while vel_queue.any():
+                     print(vel_queue.get())
+                 @endcode
+                 Filtered samples are stored as floats and are taken out with
+                 the same methods as those of a FloatQueue.
+        """
+
+        def __init__(self, size : int, *, fir = None, iir = None,
+                     decimate : int = 1, spsc : bool = False,
+                     overflow : int = None):
+            """!
+            @brief   Create a filtering queue.
+            @details The filter coefficients are copied into preallocated
+                     memory, so putting samples won't allocate memory and can
+                     be done in an interrupt callback.
+            @param   size The maximum number of filtered samples the queue can
+                     hold
+            @param   fir A list, tuple or array of FIR filter taps; the first
+                     multiplies the newest sample. If @c None, there's no FIR
+                     filter
+            @param   iir A list, tuple or array holding six coefficients for
+                     each biquad section, @c b0, @c b1, @c b2, @c a0, @c a1,
+                     @c a2, as in the flattened output of
+                     @c scipy.signal.butter(..., output='sos'). If @c None,
+                     there's no IIR filter
+            @param   decimate One filtered sample of every @c decimate is put
+                     into the queue
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting a sample into a full
+                     queue drops the new sample
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(data):
+            """!
+            @brief   Filter a sample and put the result into the queue unless
+                     it's decimated away.
+            @param   data An integer or float sample
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Filter all the samples in a buffer, putting the results
+                     which aren't decimated away into the queue.
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array of samples
+            """
+
+        def get() -> float:
+            """!
+            @brief   Get the oldest filtered sample from the queue.
+            @returns The oldest filtered sample, or @c None if the queue is
+                     empty
+            """
+
+        def get_into(buf, index : int = None) -> int:
+            """!
+            @brief   Move as many filtered samples as will fit from the queue
+                     into a preallocated buffer.
+            @param   buf An object supporting the buffer protocol, such as an
+                     @c array.array of type @c 'f'
+            @param   index If given, only the oldest sample is taken and it's
+                     written into @c buf at this index
+            @returns The number of samples which were put into the buffer
+            """
+
+        def clear():
+            """!
+            @brief   Empty the queue and forget the filters' past inputs.
+            @details The next sample put is filtered as if it were the first.
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Checks if there are any filtered samples in the queue.
+            @returns @c True if there is at least one sample in the queue
+            """
+
+        def available() -> int:
+            """!
+            @brief   Checks how many filtered samples are in the queue.
+            @returns The number of samples in the queue
+            """
+
+
+    class WindowQueue:
+        """!
+        @brief   A queue which keeps the mean, minimum and maximum of the last
+                 items put into it.
+        @details This class is written in C for speed. As each item is put,
+                 a running sum and two monotonic deques are updated, so the
+                 mean, minimum and maximum of the last @c window items can be
+                 read at any time without scanning or copying the items. The
+                 time taken doesn't depend on the size of the window, and no
+                 memory is allocated when items are put:
+                 @code
+                 current = cqueue.WindowQueue('h', 100, window=500)
+                 current.put(adc.read())        # In a timer callback
+                 ...
+                 if current.window_max() > LIMIT:
+                     motor.disable()
+                 @endcode
+                 The window holds the last items put whether or not they have
+                 been taken out of the queue with @c get(). Items are taken
+                 out with the same methods as those of a TypedQueue.
+        """
+
+        def __init__(self, typecode : str, size : int, *, window : int = None,
+                     spsc : bool = False, overflow : int = None):
+            """!
+            @brief   Create a queue with a sliding window of statistics.
+            @param   typecode A one character string with the @c array type
+                     code of the items, such as @c 'h' or @c 'f'
+            @param   size The maximum number of items that the queue can hold
+            @param   window The number of most recent items over which the
+                     mean, minimum and maximum are found; the queue's size if
+                     not given
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting an item into a full
+                     queue drops the new item; it still enters the window
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(data):
+            """!
+            @brief   Put a number into the queue and into the window.
+            @param   data An integer or float to be put into the queue
+            """
+
+        def window_mean() -> float:
+            """!
+            @brief   Get the mean of the items in the window. Integers are
+                     summed exactly, so the only rounding is in the float
+                     which is returned, as long as the sum fits in 64 bits.
+            @returns The mean, or @c None if nothing has been put
+            """
+
+        def window_min():
+            """!
+            @brief   Get the smallest item in the window. Integers are kept
+                     exactly, even beyond the range a float holds exactly.
+            @returns The minimum, an integer for integer type codes, or
+                     @c None if nothing has been put
+            """
+
+        def window_max():
+            """!
+            @brief   Get the largest item in the window.
+            @returns The maximum, an integer for integer type codes, or
+                     @c None if nothing has been put
+            """
+
+        def clear():
+            """!
+            @brief   Empty both the queue and the window.
+            """
+
+
+    class MedianQueue:
+        """!
+        @brief   A queue which finds the median and other percentiles of the
+                 last items put into it.
+        @details This class is written in C for speed. The last @c window
+                 items are kept in sorted order in an indexable skip list, so
+                 each @c put(), @c median() and @c percentile() takes
+                 O(log N) time. All memory is allocated when the queue is
+                 made, so items can be put in an interrupt callback. With
+                 @c filter=True, each call to @c put() puts the median of the
+                 window into the queue instead of the item, making a median
+                 filter which removes spikes from noisy sensor data:
+                 @code
+                 distance = cqueue.MedianQueue('H', 50, window=5, filter=True)
+                 distance.put(sonar.read())     # In a timer callback
+                 ...
+                 print(distance.get(), distance.percentile(90))
+                 @endcode
+                 The window holds the last items put whether or not they have
+                 been taken out of the queue with @c get(). Items are taken
+                 out with the same methods as those of a TypedQueue.
+        """
+
+        def __init__(self, typecode : str, size : int, *, window : int = None,
+                     filter : bool = False, spsc : bool = False,
+                     overflow : int = None):
+            """!
+            @brief   Create a queue with a sliding window of sorted items.
+            @param   typecode A one character string with the @c array type
+                     code of the items, such as @c 'h' or @c 'f'
+            @param   size The maximum number of items that the queue can hold
+            @param   window The number of most recent items whose median and
+                     percentiles are found; the queue's size if not given
+            @param   filter If @c True, each @c put() puts the median of the
+                     window into the queue rather than the item. When the
+                     window holds an even number of items, the lower of the
+                     two middle ones is used, so the output is always one of
+                     the items put
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting an item into a full
+                     queue drops the new item; it still enters the window
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(data):
+            """!
+            @brief   Put a number into the window, and it or the running
+                     median into the queue.
+            @param   data An integer or float to be put into the queue
+            """
+
+        def median():
+            """!
+            @brief   Get the median of the items in the window. If there are
+                     an even number, it's the mean of the two middle ones.
+            @returns The median, or @c None if nothing has been put. For
+                     integer type codes it's an exact integer if it's one of
+                     the items, as Python's @c statistics.median() gives, and
+                     a float if it's between two of them
+            """
+
+        def percentile(percent : float):
+            """!
+            @brief   Get a percentile of the items in the window, interpolating
+                     between the nearest two as @c numpy.percentile() does.
+            @param   percent The percentile, from 0 for the smallest item to
+                     100 for the largest
+            @returns The percentile, or @c None if nothing has been put. For
+                     integer type codes it's an exact integer if it falls on
+                     one of the items and a float if it's between two of them
+            """
+
+        def clear():
+            """!
+            @brief   Empty both the queue and the window.
+            """
+
+
+    class PackedIntQueue:
+        """!
+        @brief   A queue of integers which are packed into fewer bytes when
+                 they change slowly.
+        @details This class is written in C for speed. Each 32-bit integer is
+                 stored as the difference from the one before it, in a
+                 variable length code which takes one byte for differences
+                 from -32 to 31 and at most five bytes for any value. Data
+                 such as encoder counts and time stamps then take about a
+                 quarter of the memory they would in an IntQueue. Every
+                 @c keyframe items, a whole value is stored so that when old
+                 items are overwritten, reading can start again from there.
+                 Items can only be taken out in order, oldest first:
+                 @code
+                 counts = cqueue.PackedIntQueue(4000)   # 4000 bytes
+                 counts.put(encoder.read())     # In a timer callback
+                 ...
+                 while counts.any():
+                     print(counts.get())
+                 @endcode
+        """
+
+        def __init__(self, size : int, *, keyframe : int = 32,
+                     spsc : bool = False, overflow : int = None):
+            """!
+            @brief   Create a packed queue of integers.
+            @param   size The number of bytes of memory to hold the items,
+                     at least 5; a queue of @c N bytes holds from @c N/5 to
+                     @c N items, depending on how fast they change
+            @param   keyframe The most items put between one whole value and
+                     the next. Smaller numbers lose fewer items when the queue
+                     overflows but pack the data less tightly
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting an item into a full
+                     queue drops the new item
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest items, back to the
+                     next whole value, @c REJECT the new one, or @c RAISE an
+                     @c OverflowError. The default, @c None, overwrites except
+                     in SPSC mode, where it rejects
+            """
+
+        def put(data : int):
+            """!
+            @brief   Put an integer into the queue. It's kept as a 32-bit
+                     integer, as in an IntQueue.
+            @param   data The integer to be put into the queue
+            """
+
+        def put_many(data):
+            """!
+            @brief   Put all the integers in an @c array.array or other object
+                     which supports the buffer protocol into the queue.
+            @param   data The object holding the integers to be put
+            """
+
+        def get() -> int:
+            """!
+            @brief   Take the oldest integer out of the queue.
+            @returns The integer, or @c None if the queue is empty
+            """
+
+        def get_into(buffer) -> int:
+            """!
+            @brief   Take integers out of the queue into an @c array.array or
+                     other object which supports the buffer protocol, without
+                     allocating memory.
+            @param   buffer The object which receives the integers
+            @returns The number of integers taken out of the queue
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Check whether there are any integers in the queue.
+            @returns @c True if there's something to get
+            """
+
+        def full() -> bool:
+            """!
+            @brief   Check whether the queue might not have room for another
+                     integer, that is, fewer than 5 bytes are free.
+            @returns @c True if the next integer put may not fit
+            """
+
+        def available() -> int:
+            """!
+            @brief   Get the number of integers in the queue.
+            @returns The number of integers which can be taken out
+            """
+
+        def bytes_used() -> int:
+            """!
+            @brief   Get the number of bytes used by the integers in the queue.
+            @returns The number of bytes in use, which can be compared with
+                     4 bytes per item in an IntQueue
+            """
+
+        def max_full() -> int:
+            """!
+            @brief   Get the largest number of integers the queue has held.
+            @returns The most integers which have been in the queue at once
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get the numbers of integers put into the queue, taken out,
+                     dropped because it was full, and overwritten.
+            @param   reset If @c True, set the counters to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites)
+            """
+
+        def clear():
+            """!
+            @brief   Empty the queue.
+            """
+
+
+    class CompactQueue:
+        """!
+        @brief   A queue which stores floats in 16 or 32 bit fixed point
+                 numbers or in half precision floats.
+        @details This class is written in C for speed. Bounded data such as
+                 duty cycles, normalized errors and temperatures doesn't need
+                 the range of a 32-bit float, so it can be stored in less
+                 memory as Q15 fixed point numbers, which take 2 bytes each
+                 and hold values from @c -scale to just under @c scale, or as
+                 half precision floats, which also take 2 bytes. Q31 numbers
+                 take 4 bytes but are more precise than floats of the same
+                 size. Values are converted in C as they are put and taken
+                 out, and can be exported either as floats or in packed form:
+                 @code
+                 duty = cqueue.CompactQueue('q15', 20000, scale=100.0)
+                 duty.put(motor.duty())          # In a timer callback
+                 ...
+                 packed = duty.linearize()       # Memoryview of 'h' items
+                 step = duty.scale()[1]          # Value of one count
+                 @endcode
+                 The views, linearized data and buffer of the queue hold the
+                 numbers in packed form: @c 'h' items for Q15, @c 'i' for
+                 Q31, and @c 'H' items holding the bits of half precision
+                 floats.
+        """
+
+        def __init__(self, format : str, size : int, *, scale : float = 1.0,
+                     saturate : bool = True, spsc : bool = False,
+                     overflow : int = None):
+            """!
+            @brief   Create a queue of floats in a compact format.
+            @param   format @c 'q15', @c 'q31' or @c 'f16'
+            @param   size The maximum number of items that the queue can hold
+            @param   scale For fixed point formats, the value of a full scale
+                     number, so values from @c -scale to just under @c scale
+                     can be stored. For @c 'f16', values are divided by it
+                     before being stored, so up to @c 65504*scale can be held
+            @param   saturate If @c True, values beyond the range of the
+                     format are stored as the nearest end of the range; if
+                     @c False, putting one raises an @c OverflowError
+            @param   spsc If @c True, the queue is set up for a single producer
+                     and a single consumer, and putting an item into a full
+                     queue drops the new item
+            @param   overflow What to do when an item is put into a full
+                     queue: @c cqueue.OVERWRITE the oldest item, @c REJECT
+                     the new one, or @c RAISE an @c OverflowError. The
+                     default, @c None, overwrites except in SPSC mode, where
+                     it rejects
+            """
+
+        def put(data : float):
+            """!
+            @brief   Put a number into the queue, converting it to the queue's
+                     format. No memory is allocated.
+            @param   data An integer or float to be put into the queue
+            """
+
+        def put_many(data):
+            """!
+            @brief   Put all the numbers in an @c array.array or other object
+                     which supports the buffer protocol into the queue.
+            @param   data An array of floats, which are converted, or an array
+                     of integers in the queue's packed form, which are copied
+            """
+
+        def get() -> float:
+            """!
+            @brief   Take the oldest value out of the queue.
+            @returns The value as a float, or @c None if the queue is empty
+            """
+
+        def get_into(buffer, index : int = None) -> int:
+            """!
+            @brief   Take values out of the queue into an @c array.array or
+                     other object which supports the buffer protocol, without
+                     allocating memory.
+            @param   buffer An array of floats, which receives the values, or
+                     an array of integers the same size as the stored numbers,
+                     which receives them in packed form
+            @param   index If given, take one value and write it at this index
+            @returns The number of values taken out of the queue
+            """
+
+        def scale() -> tuple:
+            """!
+            @brief   Get the numbers needed to convert packed data to values.
+            @returns A tuple @c (scale, step), in which @c step is the value
+                     of one count of a fixed point number, or of the smallest
+                     half precision float
+            """
+
+
+    class Share:
+        """!
+        @brief   A value or record shared between tasks and interrupt
+                 callbacks without disabling interrupts.
+        @details This class is written in C for speed. It replaces
+                 @c task_share.Share where the shared value is written in an
+                 interrupt callback. Instead of disabling interrupts, it uses
+                 a sequence lock with two copies of the data: a writer never
+                 waits, and a reader which finds that the data changed while
+                 it was being read simply reads it again. As there's always a
+                 copy which isn't being written, a reader in an interrupt
+                 callback never has to wait either. A version number counts
+                 the puts, so a task can cheaply skip values it has seen:
+                 @code
+                 speed = cqueue.Share('f')
+                 pose = cqueue.Share('<ffh')     # Several fields at once
+                 speed.put(rpm)                  # In a timer callback
+                 pose.put(x, y, heading)
+                 ...
+                 seen = 0
+                 new = speed.get_new(seen)       # In a task
+                 if new is not None:
+                     seen, value = new
+                 @endcode
+        """
+
+        def __init__(self, format : str):
+            """!
+            @brief   Create a shared value or record, holding zeros to start.
+            @param   format A type code such as @c 'f' for a single value, or
+                     a @c struct format such as @c '<hhf' for a record of
+                     several fields, which are put and got together. Records
+                     may be up to 256 bytes long
+            """
+
+        def put(*values):
+            """!
+            @brief   Put a value, or all the fields of a record, into the
+                     share. No memory is allocated, so this can be called in
+                     an interrupt callback.
+            @param   values The value, or one value for each field
+            """
+
+        def get():
+            """!
+            @brief   Get the value or record in the share.
+            @returns The value, or a tuple of values for a record
+            """
+
+        def get_into(buffer) -> int:
+            """!
+            @brief   Copy the packed record into a @c bytearray or other
+                     object which supports the buffer protocol, without
+                     allocating memory.
+            @param   buffer An object of at least @c record_size() bytes
+            @returns The version of the record which was copied
+            """
+
+        def get_new(version : int):
+            """!
+            @brief   Get the value or record only if it has been put since a
+                     given version.
+            @param   version A version from @c version() or @c get_new()
+            @returns A tuple @c (version, value), or @c None if nothing has
+                     been put since the given version
+            """
+
+        def version() -> int:
+            """!
+            @brief   Get the number of times a value has been put, which wraps
+                     around to zero when it gets too big for a small integer.
+            @returns The version of the value in the share
+            """
+
+        def record_size() -> int:
+            """!
+            @brief   Get the number of bytes in the share's packed record.
+            @returns The size of the record, as from @c struct.calcsize()
+            """
+
+    class TaskQueue:
+        """!
+        @brief   A queue with the parameters and methods of
+                 @c task_share.Queue, written in C.
+        @details This class is written in C for speed. It has the same
+                 constructor parameters and the same @c put(), @c get(),
+                 @c any(), @c empty(), @c full(), @c num_in(), and @c clear()
+                 methods as @c task_share.Queue, and prints the same line of
+                 diagnostic information. When the cqueue module is built into
+                 MicroPython, @c task_share.Queue is a subclass of this class
+                 which adds each queue to @c task_share.share_list, so tasks
+                 written for the Python queue run unchanged. Items are also
+                 moved with the @c put_many(), @c get_into(), and
+                 @c counters() methods of a TypedQueue.
+        """
+
+        def __init__(self, type_code : str, size : int,
+                     thread_protect : bool = False, overwrite : bool = False,
+                     name = None):
+            """!
+            @brief   Create a queue to carry data between tasks.
+            @param   type_code The @c array type code of the items, one of
+                     @c b, @c B, @c h, @c H, @c i, @c I, @c l, @c L, @c q,
+                     @c Q, @c f, or @c d
+            @param   size The maximum number of items the queue can hold
+            @param   thread_protect If @c True, interrupts are disabled in a
+                     task while an item is copied in or out
+            @param   overwrite If @c True, the oldest item is overwritten
+                     when a task puts an item into a full queue; if
+                     @c False, the task waits for room
+            @param   name A name for diagnostic printouts, default @c Queue
+            """
+
+        def put(item, in_ISR : bool = False):
+            """!
+            @brief   Put an item into the queue.
+            @details If the queue is full, an interrupt callback drops the
+                     item and counts it as dropped; a task waits for room
+                     unless the queue was made to overwrite old data.
+            @param   item The item to be put into the queue
+            @param   in_ISR Set this to @c True if calling from an interrupt
+                     callback
+            """
+
+        def get(in_ISR : bool = False):
+            """!
+            @brief   Take the oldest item out of the queue, waiting for one if
+                     the queue is empty.
+            @param   in_ISR Set this to @c True if calling from an interrupt
+                     callback
+            @returns The item
+            """
+
+        def empty() -> bool:
+            """!
+            @brief   Check whether the queue is empty.
+            @returns @c True if there are no items in the queue
+            """
+
+        def num_in() -> int:
+            """!
+            @brief   Get the number of items in the queue.
+            @returns The number of items in the queue
+            """
+
+    class Arena:
+        """!
+        @brief   A block of memory from which queues are made and to which
+                 they give their memory back when they're closed.
+        @details This class is written in C. Programs which tear down and
+                 make queues of different sizes, as when switching modes,
+                 slowly fragment the heap until a big queue no longer fits.
+                 Queues made from an Arena are kept together in one block of
+                 memory, which is split into halves as needed and joined back
+                 together as queues are closed, so the same memory can be used
+                 over and over. Making or closing a queue takes a bounded,
+                 short time. Every queue class takes an @c arena keyword
+                 argument and has a @c close() method:
+                 @code
+                 arena = cqueue.Arena(32 * 1024)
+                 samples = cqueue.IntQueue(2000, arena=arena)
+                 ...
+                 samples.close()                 # When the mode changes
+                 samples = cqueue.FloatQueue(1000, arena=arena)
+                 print(arena.stats())
+                 @endcode
+                 Each queue takes the power of two number of bytes which
+                 holds its data and an 8 byte header. Putting items into a
+                 closed queue raises @c ValueError.
+        """
+
+        def __init__(self, num_bytes : int):
+            """!
+            @brief   Create an arena of the given size.
+            @details The memory is taken from cqueue's data arena if there's
+                     room there, so the garbage collector doesn't scan it, or
+                     else from the heap, once.
+            @param   num_bytes The number of bytes in the arena
+            """
+
+        def stats() -> tuple:
+            """!
+            @brief   Report how the arena is being used.
+            @returns A tuple @c (size, used, largest_free, num_blocks,
+                     max_used, num_fails) with the number of bytes in the
+                     arena, the bytes in blocks holding queues, the size of
+                     the biggest queue data which would fit, the number of
+                     queues using the arena, the most bytes ever used, and
+                     the number of queues which didn't fit
+            """
+
+    class BroadcastQueue:
+        """!
+        @brief   A queue with one writer and several readers, each of which
+                 gets every item put into it.
+        @details This class is written in C for speed. When the same data
+                 goes to several consumers, such as a controller, a data
+                 logger and a telemetry printer, one BroadcastQueue replaces
+                 a queue for each of them: the item is converted and stored
+                 once, in one array, and each reader keeps its own place.
+                 Readers are numbered from zero, and each reader's number is
+                 given to @c get(), @c available() and the other reading
+                 methods:
+                 @code
+                 encoder_queue = cqueue.BroadcastQueue('i', 64, 3)
+                 encoder_queue.put(position)       # In an interrupt callback
+                 ...
+                 while encoder_queue.any(LOGGER):  # In the logger task
+                     log(encoder_queue.get(LOGGER))
+                 @endcode
+                 The writer never waits for a slow reader. If a reader falls
+                 more than @c size items behind, the items it missed are
+                 skipped and counted as overruns, which @c counters() shows;
+                 the other readers aren't affected. Each reader must be used
+                 by only one task or thread, but readers need no locking
+                 against the writer or each other, and @c put() allocates no
+                 memory, so it can be used in interrupt callbacks.
+        """
+
+        def __init__(self, type_code : str, size : int, readers : int, *,
+                     arena = None):
+            """!
+            @brief   Create a queue whose items go to several readers.
+            @param   type_code The @c array type code of the items, one of
+                     @c b, @c B, @c h, @c H, @c i, @c I, @c l, @c L, @c q,
+                     @c Q, @c f, or @c d
+            @param   size The number of items each reader can have waiting
+            @param   readers The number of readers
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            """
+
+        def put(item):
+            """!
+            @brief   Put an item into the queue for every reader.
+            @details If a reader already has @c size items waiting, its
+                     oldest one is overwritten.
+            @param   item The item to be put into the queue
+            """
+
+        def put_many(buf):
+            """!
+            @brief   Put all the items from a buffer, such as an
+                     @c array.array, into the queue for every reader.
+            @param   buf An object holding the items, which are converted in
+                     C if their type differs from the queue's
+            """
+
+        def get(reader : int):
+            """!
+            @brief   Get the oldest item which a reader hasn't read.
+            @param   reader The number of the reader
+            @returns The item, or @c None if the reader has read every item
+            """
+
+        def get_into(reader : int, buf) -> int:
+            """!
+            @brief   Get as many of a reader's items as there are and will
+                     fit into a buffer such as an @c array.array.
+            @param   reader The number of the reader
+            @param   buf The buffer which receives the items
+            @returns The number of items copied into the buffer
+            """
+
+        def available(reader : int) -> int:
+            """!
+            @brief   Find how many items a reader has waiting.
+            @param   reader The number of the reader
+            @returns The number of items the reader can get, at most @c size
+            """
+
+        def any(reader : int) -> bool:
+            """!
+            @brief   Check whether a reader has any items waiting.
+            @param   reader The number of the reader
+            @returns @c True if the reader can get an item, @c False if not
+            """
+
+        def counters(reader : int, reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items put into the queue and of those
+                     a reader has taken or missed.
+            @param   reader The number of the reader
+            @param   reset If @c True, set the reader's counts to zero after
+                     reading them
+            @returns A tuple @c (puts, gets, overruns); overruns are items
+                     which were overwritten before the reader took them
+            """
+
+        def close():
+            """!
+            @brief   Give the queue's memory back to the Arena or the data
+                     arena it came from. The readers are left with nothing to
+                     get, and putting items raises @c ValueError.
+            """
+    class ThreadQueue:
+        """!
+        @brief   A queue which any number of threads can put items into and
+                 get items from at the same time.
+        @details This class is written in C for speed. It's meant for ports
+                 with the @c _thread module, such as the unix port and the
+                 ESP32, where several producer threads and several consumer
+                 threads share one queue:
+                 @code
+                 jobs = cqueue.ThreadQueue('i', 64)
+                 jobs.put(job_number)                 # In any thread
+                 ...
+                 job_number = jobs.get(timeout_ms=100)  # In any other thread
+                 if job_number is not None:
+                     do_job(job_number)
+                 @endcode
+                 No lock is taken to put or get an item; each thread claims
+                 its place in the queue with one atomic compare and swap, so
+                 a thread which is paused in the middle of a put or get holds
+                 up only the item it's working on. When the queue is full,
+                 @c put() waits for room, and when it's empty @c get() waits
+                 for an item; while waiting, the GIL is released so other
+                 threads can run. The size is rounded up to a power of two.
+        """
+
+        def __init__(self, type_code : str, size : int, *, arena = None):
+            """!
+            @brief   Create a queue to be shared by threads.
+            @param   type_code The @c array type code of the items, one of
+                     @c b, @c B, @c h, @c H, @c i, @c I, @c l, @c L, @c q,
+                     @c Q, @c f, or @c d
+            @param   size The number of items the queue can hold, which is
+                     rounded up to a power of two
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            """
+
+        def put(item, timeout_ms : int = None) -> bool:
+            """!
+            @brief   Put an item into the queue, waiting for room if the
+                     queue is full.
+            @details With a timeout of zero, @c put() never waits or
+                     allocates memory, so it can be used in interrupt
+                     callbacks. Puts which time out are counted as drops by
+                     @c counters().
+            @param   item The item to be put into the queue
+            @param   timeout_ms The longest time to wait in milliseconds, or
+                     @c None to wait as long as it takes
+            @returns @c True if the item was put, or @c False if time ran out
+            """
+
+        def get(timeout_ms : int = None):
+            """!
+            @brief   Get the oldest item from the queue, waiting for one if
+                     the queue is empty.
+            @param   timeout_ms The longest time to wait in milliseconds, or
+                     @c None to wait as long as it takes
+            @returns The item, or @c None if time ran out or the queue has
+                     been closed
+            """
+
+        def available() -> int:
+            """!
+            @brief   Find how many items are in the queue. Other threads may
+                     have changed the number by the time it's used.
+            @returns The number of items in the queue
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Check whether the queue has any items in it.
+            @returns @c True if there's at least one item, @c False if not
+            """
+
+        def full() -> bool:
+            """!
+            @brief   Check whether the queue is full.
+            @returns @c True if there's no room for another item
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the items which have passed through the
+                     queue.
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites); drops are
+                     puts which timed out, and there are never overwrites
+            """
+
+        def close():
+            """!
+            @brief   Give the queue's memory back to the Arena or the data
+                     arena it came from. Threads waiting in @c put() get a
+                     @c ValueError, and those waiting in @c get() get
+                     @c None.
+            """
+    class MessageQueue:
+        """!
+        @brief   A queue of messages of different lengths, such as command
+                 strings or packets, which are kept whole.
+        @details This class is written in C for speed. A ByteQueue loses the
+                 boundaries between messages, and framing them in Python is
+                 slow; a MessageQueue stores each message in one piece behind
+                 its length, so @c get_into() returns exactly what one
+                 @c put() put:
+                 @code
+                 commands = cqueue.MessageQueue(256)
+                 commands.put(b"GO 1500")          # In one task
+                 ...
+                 buf = bytearray(commands.max_len())
+                 n = commands.get_into(buf)        # In another task
+                 if n is not None:
+                     run_command(buf[:n])
+                 @endcode
+                 No memory is allocated for each message, so messages can be
+                 put in interrupt callbacks. When there isn't room for a new
+                 message, the overflow policy decides as in other queues, but
+                 whole messages are thrown away or refused, never parts of
+                 them. A message can be up to about half the capacity long,
+                 as one which doesn't fit before the end of the memory goes
+                 at the beginning, skipping the space in between.
+        """
+
+        def __init__(self, capacity : int, *, spsc : bool = False,
+                     overflow : int = None, arena = None):
+            """!
+            @brief   Create a queue for messages.
+            @param   capacity The number of bytes of memory for messages;
+                     each message takes two bytes more than its length
+            @param   spsc If @c True, one interrupt callback or thread may
+                     put while another gets with no locking; otherwise puts
+                     and gets briefly disable interrupts
+            @param   overflow What to do with a message when there's no room
+                     for it: @c cqueue.OVERWRITE throws away the oldest
+                     messages (not allowed with @c spsc), @c cqueue.REJECT
+                     drops the new one, and @c cqueue.RAISE raises
+                     @c OverflowError. The default is @c OVERWRITE, or
+                     @c REJECT in SPSC mode
+            @param   arena A cqueue.Arena from which the queue's memory is
+                     taken, or @c None to take it from the data arena or the
+                     heap
+            """
+
+        def put(buf):
+            """!
+            @brief   Put a copy of a message into the queue.
+            @details A message longer than @c max_len() raises
+                     @c ValueError.
+            @param   buf A @c bytes, @c bytearray, string or other buffer
+                     holding the message, which may be empty
+            """
+
+        def get_into(buf) -> int:
+            """!
+            @brief   Take the oldest message from the queue and copy it into
+                     a @c bytearray or other writable buffer.
+            @param   buf The buffer which receives the message. If it's too
+                     small, @c ValueError is raised and the message is left
+                     in the queue
+            @returns The number of bytes in the message, or @c None if the
+                     queue is empty
+            """
+
+        def peek_len() -> int:
+            """!
+            @brief   Find the length of the oldest message without taking it
+                     from the queue.
+            @returns The number of bytes in the message, or @c None if the
+                     queue is empty
+            """
+
+        def any() -> bool:
+            """!
+            @brief   Check whether the queue has any messages in it.
+            @returns @c True if there's at least one message, @c False if not
+            """
+
+        def max_len() -> int:
+            """!
+            @brief   Find the longest message which can be put into the
+                     queue.
+            @returns The number of bytes, a little less than half the
+                     capacity
+            """
+
+        def counters(reset : bool = False) -> tuple:
+            """!
+            @brief   Get counts of the messages which have passed through the
+                     queue.
+            @param   reset If @c True, set the counts to zero after reading
+            @returns A tuple @c (puts, gets, drops, overwrites), in messages
+            """
+
+        def close():
+            """!
+            @brief   Give the queue's memory back to the Arena or the data
+                     arena it came from. Putting messages then raises
+                     @c ValueError.
+            """
+
 
 import utime
 import cqueue
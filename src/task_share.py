@@ -5,6 +5,7 @@
 #  @author JR Ridgely
 #  @date   2017-Jan-01 JRR Approximate date of creation of file
 #  @date   2021-Dec-18 JRR Docstrings changed to work without DoxyPyPy
+#  @date   2026-Oct-16 Queue uses @c cqueue.TaskQueue when it's available
 #  @copyright This program is copyright (c) 2017-2023 by JR Ridgely and released
 #             under the GNU Public License, version 3.0. 
 # 
@@ -26,6 +27,12 @@ import gc
 import pyb
 import micropython
 
+# A queue written in C is used if the cqueue module is built into MicroPython
+try:
+    import cqueue
+except ImportError:
+    cqueue = None
+
 
 ## This is a system-wide list of all the queues and shared variables. It is
 #  used to create diagnostic printouts. 
@@ -299,6 +306,60 @@ class Queue (BaseShare):
                 type_code_strings[self._type_code], self._max_full, self._size))
 
 
+## The queue written in Python, which is used as @c Queue when the @c cqueue
+#  module isn't built into MicroPython.
+PyQueue = Queue
+
+
+if cqueue is not None and hasattr (cqueue, 'TaskQueue'):
+
+    ## A queue which is used to transfer data from one task to another, with
+    #  its data and methods in C for speed.
+    #
+    #  This class is used in place of the Python queue when the @c cqueue
+    #  module is available. It is created with the same parameters and has
+    #  the same methods, @c put(), @c get(), @c any(), @c empty(), @c full(),
+    #  @c num_in(), and @c clear(), so task code needn't be changed. Its buffer
+    #  is allocated in C rather than filled from a @c range, so it's quick to
+    #  create, and each @c put() or @c get() is one call into C. 
+    class Queue (cqueue.TaskQueue):
+
+        ## A counter used to give serial numbers to queues for diagnostic use.
+        ser_num = 0
+
+        ## Initialize a queue object to carry and buffer data between tasks.
+        #
+        #  @param type_code The type of data items which the queue can hold
+        #  @param size The maximum number of items which the queue can hold
+        #  @param thread_protect @c True if mutual exclusion protection is used
+        #  @param overwrite If @c True, oldest data will be overwritten with
+        #         new data if the queue becomes full 
+        #  @param name A short name for the queue, default @c QueueN where
+        #         @c N is a serial number for the queue
+        def __init__ (self, type_code, size, thread_protect = False, 
+                      overwrite = False, name = None):
+            if name == None:
+                name = 'Queue' + str (Queue.ser_num)
+            Queue.ser_num += 1
+            super ().__init__ (type_code, size, thread_protect, overwrite,
+                               name)
+
+            # Add this queue to the global share and queue list
+            share_list.append (self)
+
+
+        ## Set functions to be scheduled when this queue fills to a high
+        #  watermark or empties to a low one.
+        #
+        #  This method takes the same keyword arguments as the one in
+        #  @c cqueue.TaskQueue, but unless an @c arg is given, the functions
+        #  are called with this queue rather than the C object inside it.
+        #  @param kwargs Keyword arguments for @c cqueue.TaskQueue.watermarks()
+        def watermarks (self, **kwargs):
+            kwargs.setdefault ('arg', self)
+            super ().watermarks (**kwargs)
+
+
 # ============================================================================
 
 ## An item which holds data to be shared between tasks.